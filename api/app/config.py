@@ -87,6 +87,16 @@ class Settings:
             return str(Path(env_val).resolve())
         return str(Path(self.DATA_DIR) / "snapshots")
 
+    @property
+    def ENGINE_TRANSPORT(self) -> str:
+        """Engine IPC: "pipe" (stdin/stdout, default) or "shm" (shared memory, Linux)."""
+        return os.getenv("ENGINE_TRANSPORT", "pipe").lower()
+
+    @property
+    def ENGINE_SOCKET(self) -> str:
+        """UNIX socket of a shared engine started with --listen; empty spawns a private engine."""
+        return os.getenv("ENGINE_SOCKET", "")
+
     # Rate limiting settings
     @property
     def RATE_LIMIT_REQUESTS(self) -> int:
@@ -122,6 +132,7 @@ class Settings:
         print(f"DATA_DIR:        {self.DATA_DIR}")
         print(f"EVENT_LOG_PATH:  {self.EVENT_LOG_PATH}")
         print(f"SNAPSHOT_DIR:    {self.SNAPSHOT_DIR}")
+        print(f"ENGINE_TRANSPORT: {self.ENGINE_TRANSPORT}")
 
 
 # Global settings instance
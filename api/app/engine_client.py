@@ -2,14 +2,19 @@
 
 import asyncio
 import json
+import os
+import socket
 import subprocess
 from pathlib import Path
-from typing import Any
+from typing import TYPE_CHECKING, Any
 from uuid import uuid4
 
 from app.config import settings
 from app.logging_config import logger
 
+if TYPE_CHECKING:
+    from app.shm_transport import ShmChannel
+
 
 class EngineClient:
     """Manages communication with the matching engine subprocess."""
@@ -18,12 +23,29 @@ class EngineClient:
         self.process: subprocess.Popen | None = None
         self._lock = asyncio.Lock()
         self._started = False
+        self._shm: ShmChannel | None = None
+        self._sock: socket.socket | None = None
+        self._sock_file = None
 
     async def start(self) -> None:
-        """Start the engine subprocess."""
+        """Start the engine subprocess, or attach to a shared engine socket."""
         if self._started:
             return
 
+        if settings.ENGINE_SOCKET:
+            # Engine runs separately with --listen; several API workers share it
+            sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+            try:
+                sock.connect(settings.ENGINE_SOCKET)
+            except OSError as e:
+                sock.close()
+                raise RuntimeError(f"Engine socket {settings.ENGINE_SOCKET} unavailable: {e}")
+            self._sock = sock
+            self._sock_file = sock.makefile("r", encoding="utf-8")
+            self._started = True
+            logger.info("Connected to engine", extra={"socket": settings.ENGINE_SOCKET})
+            return
+
         engine_path = Path(settings.ENGINE_PATH)
         if not engine_path.exists():
             raise RuntimeError(f"Engine binary not found at {engine_path}")
@@ -40,6 +62,11 @@ class EngineClient:
             settings.SNAPSHOT_DIR,
         ]
 
+        shm_name = None
+        if settings.ENGINE_TRANSPORT == "shm":
+            shm_name = f"aztec-engine-{os.getpid()}"
+            cmd += ["--shm", shm_name]
+
         logger.info("Starting engine", extra={"cmd": cmd})
 
         self.process = subprocess.Popen(
@@ -52,8 +79,23 @@ class EngineClient:
             bufsize=1,
         )
 
+        if shm_name:
+            from app.shm_transport import HELPER_LIBRARY, ShmChannel
+
+            channel = ShmChannel(shm_name, str(engine_path.parent / HELPER_LIBRARY))
+            try:
+                channel.connect()
+            except RuntimeError:
+                self.process.terminate()
+                self.process = None
+                raise
+            self._shm = channel
+
         self._started = True
-        logger.info("Engine started", extra={"pid": self.process.pid})
+        logger.info(
+            "Engine started",
+            extra={"pid": self.process.pid, "transport": settings.ENGINE_TRANSPORT},
+        )
 
     async def stop(self) -> None:
         """Stop the engine subprocess.
@@ -62,6 +104,16 @@ class EngineClient:
         On Windows the pipe can already be closed when we try to send 'shutdown',
         so we must never crash during teardown.
         """
+        if self._sock:
+            # A shared engine outlives this worker: disconnect, don't shut it down
+            self._sock_file.close()
+            self._sock.close()
+            self._sock = None
+            self._sock_file = None
+            self._started = False
+            logger.info("Disconnected from engine")
+            return
+
         proc = self.process
         if not proc:
             self._started = False
@@ -75,6 +127,10 @@ class EngineClient:
                 except Exception as e:
                     logger.warning("Graceful engine shutdown failed (ignored)", extra={"error": str(e)})
         finally:
+            if self._shm:
+                self._shm.close()
+                self._shm = None
+
             # Always force terminate as a fallback
             try:
                 if proc.poll() is None:
@@ -89,6 +145,9 @@ class EngineClient:
 
     async def send_command(self, command: dict[str, Any]) -> dict[str, Any]:
         """Send a command to the engine and get the response."""
+        if self._sock:
+            return await self._send_socket_command(command)
+
         proc = self.process
         if not proc or not proc.stdin or not proc.stdout:
             raise RuntimeError("Engine not running")
@@ -100,15 +159,26 @@ class EngineClient:
             cmd_json = json.dumps(command)
             logger.debug("Sending to engine", extra={"command": command})
 
-            try:
-                proc.stdin.write(cmd_json + "\n")
-                proc.stdin.flush()
-            except (BrokenPipeError, OSError, ValueError) as e:
-                raise RuntimeError(f"Engine stdin write failed: {e}")
+            if self._shm:
+                # The spin-then-futex wait blocks, so it runs off the event loop
+                loop = asyncio.get_running_loop()
+                try:
+                    response = await loop.run_in_executor(
+                        None, self._shm.request, cmd_json.encode(), 5.0
+                    )
+                    response_line = response.decode()
+                except TimeoutError as e:
+                    raise RuntimeError(f"Engine shared memory request failed: {e}")
+            else:
+                try:
+                    proc.stdin.write(cmd_json + "\n")
+                    proc.stdin.flush()
+                except (BrokenPipeError, OSError, ValueError) as e:
+                    raise RuntimeError(f"Engine stdin write failed: {e}")
 
-            response_line = proc.stdout.readline()
-            if not response_line:
-                raise RuntimeError("Engine closed connection (no response)")
+                response_line = proc.stdout.readline()
+                if not response_line:
+                    raise RuntimeError("Engine closed connection (no response)")
 
             try:
                 response = json.loads(response_line)
@@ -118,6 +188,20 @@ class EngineClient:
             logger.debug("Received from engine", extra={"response": response})
             return response
 
+    async def _send_socket_command(self, command: dict[str, Any]) -> dict[str, Any]:
+        async with self._lock:
+            try:
+                self._sock.sendall((json.dumps(command) + "\n").encode())
+                response_line = self._sock_file.readline()
+            except OSError as e:
+                raise RuntimeError(f"Engine socket request failed: {e}")
+            if not response_line:
+                raise RuntimeError("Engine closed connection (no response)")
+            try:
+                return json.loads(response_line)
+            except json.JSONDecodeError as e:
+                raise RuntimeError(f"Engine returned invalid JSON: {e}; line={response_line!r}")
+
     async def place_order(self, order: dict[str, Any]) -> dict[str, Any]:
         return await self.send_command({"cmd": "place_order", "req_id": str(uuid4()), "order": order})
 
@@ -133,6 +217,21 @@ class EngineClient:
     async def get_order(self, order_id: int) -> dict[str, Any]:
         return await self.send_command({"cmd": "get_order", "req_id": str(uuid4()), "order_id": order_id})
 
+    async def get_order_by_client_id(self, account_id: str, client_order_id: str) -> dict[str, Any]:
+        return await self.send_command({"cmd": "get_order", "req_id": str(uuid4()),
+                                        "account_id": account_id, "client_order_id": client_order_id})
+
+    async def cancel_order_by_client_id(self, account_id: str, client_order_id: str) -> dict[str, Any]:
+        return await self.send_command({"cmd": "cancel_order", "req_id": str(uuid4()),
+                                        "account_id": account_id, "client_order_id": client_order_id})
+
+    async def get_open_orders(self, account_id: str, symbol: str | None = None) -> dict[str, Any]:
+        command: dict[str, Any] = {"cmd": "get_open_orders", "req_id": str(uuid4()),
+                                   "account_id": account_id}
+        if symbol is not None:
+            command["symbol"] = symbol
+        return await self.send_command(command)
+
     async def get_stats(self) -> dict[str, Any]:
         return await self.send_command({"cmd": "get_stats", "req_id": str(uuid4())})
 
@@ -14,6 +14,24 @@ class Side(str, Enum):
 class OrderType(str, Enum):
     LIMIT = "LIMIT"
     MARKET = "MARKET"
+    STOP = "STOP"
+    STOP_LIMIT = "STOP_LIMIT"
+
+
+class TimeInForce(str, Enum):
+    GTC = "GTC"
+    IOC = "IOC"
+    FOK = "FOK"
+    POST_ONLY = "POST_ONLY"
+    POST_ONLY_SLIDE = "POST_ONLY_SLIDE"
+
+
+class SelfTradePrevention(str, Enum):
+    CANCEL_INCOMING = "CANCEL_INCOMING"
+    CANCEL_RESTING = "CANCEL_RESTING"
+    CANCEL_BOTH = "CANCEL_BOTH"
+    DECREMENT_AND_CANCEL = "DECREMENT_AND_CANCEL"
+    SKIP = "SKIP"
 
 
 class OrderStatus(str, Enum):
@@ -22,17 +40,23 @@ class OrderStatus(str, Enum):
     FILLED = "FILLED"
     CANCELLED = "CANCELLED"
     REJECTED = "REJECTED"
+    EXPIRED = "EXPIRED"
 
 
 class PlaceOrderRequest(BaseModel):
     """Request to place a new order."""
 
     account_id: str = Field(..., min_length=1, max_length=64)
-    symbol: str = Field(..., pattern=r"^[A-Z]+-[A-Z]+$")
+    symbol: str = Field(..., max_length=13, pattern=r"^[A-Z]+-[A-Z]+$")
     side: Side
     type: OrderType
+    time_in_force: TimeInForce = TimeInForce.GTC
+    self_trade_prevention: SelfTradePrevention = SelfTradePrevention.CANCEL_INCOMING
     price: int = Field(0, ge=0, description="Price in fixed-point (1e8 = 1.0)")
+    stop_price: int = Field(0, ge=0, description="Trigger price for STOP and STOP_LIMIT")
     quantity: int = Field(..., gt=0, description="Quantity in fixed-point")
+    display_qty: int = Field(0, ge=0, description="Iceberg peak shown in the book, 0 = all")
+    expire_ts_ns: int = Field(0, ge=0, description="Good-till-time deadline in ns, 0 = none")
     idempotency_key: str | None = Field(None, max_length=64)
     client_order_id: str | None = Field(None, max_length=64)
 
@@ -57,10 +81,16 @@ class Order(BaseModel):
     symbol: str
     side: Side
     type: OrderType
+    time_in_force: TimeInForce = TimeInForce.GTC
+    self_trade_prevention: SelfTradePrevention = SelfTradePrevention.CANCEL_INCOMING
     price: int
+    stop_price: int = 0
     quantity: int
     remaining_qty: int
+    display_qty: int = 0
+    visible_qty: int = 0
     timestamp_ns: int
+    expire_ts_ns: int = 0
     status: OrderStatus
     idempotency_key: str | None = None
     client_order_id: str | None = None
@@ -103,6 +133,13 @@ class PlaceOrderResponse(BaseModel):
     trades: list[Trade]
 
 
+class OpenOrdersResponse(BaseModel):
+    """An account's open orders."""
+
+    account_id: str
+    orders: list[Order]
+
+
 class TradesResponse(BaseModel):
     """Recent trades response."""
 
@@ -118,6 +155,9 @@ class StatsResponse(BaseModel):
     total_cancels: int
     total_rejects: int
     event_sequence: int
+    idempotency_keys: int = 0
+    idempotency_bytes: int = 0
+    self_trade_prevented: dict[str, int] = {}
 
 
 class HealthResponse(BaseModel):
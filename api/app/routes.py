@@ -9,6 +9,7 @@ from app.logging_config import generate_request_id, logger, request_id_var
 from app.models import (
     BookLevel,
     HealthResponse,
+    OpenOrdersResponse,
     Order,
     OrderBookResponse,
     PlaceOrderRequest,
@@ -74,10 +75,18 @@ async def place_order(
         "symbol": order.symbol,
         "side": order.side.value,
         "type": order.type.value,
+        "time_in_force": order.time_in_force.value,
+        "self_trade_prevention": order.self_trade_prevention.value,
         "price": order.price,
         "quantity": order.quantity,
     }
     
+    if order.stop_price:
+        order_dict["stop_price"] = order.stop_price
+    if order.display_qty:
+        order_dict["display_qty"] = order.display_qty
+    if order.expire_ts_ns:
+        order_dict["expire_ts_ns"] = order.expire_ts_ns
     if order.idempotency_key is not None:
         order_dict["idempotency_key"] = order.idempotency_key
     if order.client_order_id is not None:
@@ -91,7 +100,10 @@ async def place_order(
     if not result.get("success"):
         error = result.get("error", {})
         error_code = error.get("code", "UNKNOWN_ERROR")
-        record_order_rejected(error_code)
+        # A retried idempotency key gets the original result again, which
+        # was counted the first time
+        if not result.get("duplicate"):
+            record_order_rejected(error_code)
         raise HTTPException(
             status_code=status.HTTP_400_BAD_REQUEST,
             detail=f"{error_code}: {error.get('message', 'Order failed')}",
@@ -102,9 +114,10 @@ async def place_order(
     trades = [Trade(**t) for t in data.get("trades", [])]
     
     # Record metrics
-    record_order(order.side.value, order.type.value, order_response.status.value)
-    for trade in trades:
-        record_trade(order.symbol, trade.quantity)
+    if not result.get("duplicate"):
+        record_order(order.side.value, order.type.value, order_response.status.value)
+        for trade in trades:
+            record_trade(order.symbol, trade.quantity)
     
     return PlaceOrderResponse(order=order_response, trades=trades)
 
@@ -170,6 +183,102 @@ async def cancel_order(
     return Order(**result["data"]["order"])
 
 
+@router.get(
+    "/accounts/{account_id}/orders",
+    response_model=OpenOrdersResponse,
+    summary="List open orders",
+    description="An account's resting orders and untriggered stops, optionally for one symbol.",
+    responses={
+        200: {"description": "Open orders, oldest first"},
+        401: {"description": "Invalid API key"},
+    },
+)
+async def get_open_orders(
+    account_id: str,
+    symbol: str | None = None,
+    _api_key: str = Depends(verify_api_key),
+    req_id: str = Depends(set_request_id),
+) -> OpenOrdersResponse:
+    """List an account's open orders."""
+    result = await engine_client.get_open_orders(account_id, symbol)
+
+    if not result.get("success"):
+        raise HTTPException(
+            status_code=status.HTTP_500_INTERNAL_SERVER_ERROR,
+            detail="Failed to retrieve open orders"
+        )
+
+    data = result["data"]
+    return OpenOrdersResponse(
+        account_id=data["account_id"],
+        orders=[Order(**o) for o in data["orders"]],
+    )
+
+
+@router.get(
+    "/accounts/{account_id}/orders/{client_order_id}",
+    response_model=Order,
+    summary="Get an open order by client order ID",
+    description="Look up an account's open order by the client_order_id it was placed with.",
+    responses={
+        200: {"description": "Order found"},
+        404: {"description": "No open order with that client order ID"},
+        401: {"description": "Invalid API key"},
+    },
+)
+async def get_order_by_client_id(
+    account_id: str,
+    client_order_id: str,
+    _api_key: str = Depends(verify_api_key),
+    req_id: str = Depends(set_request_id),
+) -> Order:
+    """Get an open order by account and client order ID."""
+    result = await engine_client.get_order_by_client_id(account_id, client_order_id)
+
+    if not result.get("success"):
+        raise HTTPException(
+            status_code=status.HTTP_404_NOT_FOUND,
+            detail="Order not found"
+        )
+
+    return Order(**result["data"]["order"])
+
+
+@router.delete(
+    "/accounts/{account_id}/orders/{client_order_id}",
+    response_model=Order,
+    summary="Cancel an order by client order ID",
+    description="Cancel an account's open order by the client_order_id it was placed with.",
+    responses={
+        200: {"description": "Order cancelled"},
+        404: {"description": "No open order with that client order ID"},
+        401: {"description": "Invalid API key"},
+        429: {"description": "Rate limit exceeded"},
+    },
+)
+async def cancel_order_by_client_id(
+    account_id: str,
+    client_order_id: str,
+    _api_key: str = Depends(verify_api_key),
+    _rate_limit: None = Depends(rate_limit_dependency),
+    req_id: str = Depends(set_request_id),
+) -> Order:
+    """Cancel an open order by account and client order ID."""
+    logger.info("Cancelling order",
+                extra={"account_id": account_id, "client_order_id": client_order_id})
+
+    result = await engine_client.cancel_order_by_client_id(account_id, client_order_id)
+
+    if not result.get("success"):
+        error = result.get("error", {})
+        raise HTTPException(
+            status_code=status.HTTP_404_NOT_FOUND,
+            detail=error.get("message", "Order not found or cannot be cancelled"),
+        )
+
+    return Order(**result["data"]["order"])
+
+
 # =============================================================================
 # Market Data Endpoints (Public)
 # =============================================================================
@@ -0,0 +1,231 @@
+"""Client side of the engine's shared-memory transport (engine --shm <name>).
+
+The layout mirrors engine/include/exchange/shm_transport.hpp: a 64-byte file
+header followed by a request ring (client -> engine) and a response ring
+(engine -> client). Each ring header holds head (u64, +0), tail (u64, +64),
+a futex word seq (u32, +128) and a waiting flag (u32, +132); data starts at
++192. Messages are a u32 length followed by the payload, wrapping at the end.
+
+Index loads and stores go through ctypes so each is a single aligned machine
+access. The wakeup handshake also needs a store followed by a load of another
+word to stay in that order, which plain stores do not give: the seq bump and
+the waiting flag go through exchange_shm_fetch_add and exchange_shm_store,
+sequentially consistent atomics in a small library built with the engine
+(engine/src/shm_client.cpp, libexchange_shm_client.so next to the engine
+binary). Linux only.
+"""
+
+import ctypes
+import mmap
+import os
+import platform
+import struct
+import time
+
+MAGIC = 0x31304D4853545A41  # "AZTSHM01"
+VERSION = 1
+
+FILE_HEADER_BYTES = 64
+RING_HEADER_BYTES = 192
+
+# Spinning only pays off when the engine can run on another core
+SPIN_ITERATIONS = 2000 if len(os.sched_getaffinity(0)) > 1 else 0
+WAIT_TIMEOUT_NS = 100_000_000
+
+_SYS_FUTEX = {"x86_64": 202, "aarch64": 98}[platform.machine()]
+_FUTEX_WAIT = 0
+_FUTEX_WAKE = 1
+
+
+class _Timespec(ctypes.Structure):
+    _fields_ = [("tv_sec", ctypes.c_long), ("tv_nsec", ctypes.c_long)]
+
+
+_libc = ctypes.CDLL(None, use_errno=True)
+_libc.syscall.restype = ctypes.c_long
+
+HELPER_LIBRARY = "libexchange_shm_client.so"
+
+
+class _Atomics:
+    """Sequentially consistent operations on u32 words of the mapping."""
+
+    def __init__(self, path: str) -> None:
+        lib = ctypes.CDLL(path)
+        lib.exchange_shm_fetch_add.restype = ctypes.c_uint32
+        lib.exchange_shm_fetch_add.argtypes = [ctypes.c_void_p, ctypes.c_uint32]
+        lib.exchange_shm_store.restype = None
+        lib.exchange_shm_store.argtypes = [ctypes.c_void_p, ctypes.c_uint32]
+        self._fetch_add = lib.exchange_shm_fetch_add
+        self._store = lib.exchange_shm_store
+
+    def fetch_add(self, word: ctypes.c_uint32, value: int) -> int:
+        return self._fetch_add(ctypes.addressof(word), value)
+
+    def store(self, word: ctypes.c_uint32, value: int) -> None:
+        self._store(ctypes.addressof(word), value)
+
+
+class _Ring:
+    """One direction of the transport."""
+
+    def __init__(self, buf: mmap.mmap, offset: int, size: int, atomics: _Atomics) -> None:
+        self.size = size
+        self.atomics = atomics
+        self.head = ctypes.c_uint64.from_buffer(buf, offset)
+        self.tail = ctypes.c_uint64.from_buffer(buf, offset + 64)
+        self.seq = ctypes.c_uint32.from_buffer(buf, offset + 128)
+        self.waiting = ctypes.c_uint32.from_buffer(buf, offset + 132)
+        self.data_offset = offset + RING_HEADER_BYTES
+        self.buf = buf
+
+    def _copy_in(self, pos: int, payload: bytes) -> None:
+        off = pos % self.size
+        first = min(len(payload), self.size - off)
+        start = self.data_offset + off
+        self.buf[start : start + first] = payload[:first]
+        rest = len(payload) - first
+        if rest:
+            self.buf[self.data_offset : self.data_offset + rest] = payload[first:]
+
+    def _copy_out(self, pos: int, length: int) -> bytes:
+        off = pos % self.size
+        first = min(length, self.size - off)
+        start = self.data_offset + off
+        out = self.buf[start : start + first]
+        rest = length - first
+        if rest:
+            out += self.buf[self.data_offset : self.data_offset + rest]
+        return out
+
+    def write(self, payload: bytes) -> None:
+        needed = 4 + len(payload)
+        if needed > self.size:
+            raise RuntimeError(f"Message of {len(payload)} bytes exceeds ring size {self.size}")
+
+        head = self.head.value
+        while head + needed - self.tail.value > self.size:
+            time.sleep(0)
+
+        self._copy_in(head, struct.pack("<I", len(payload)))
+        self._copy_in(head + 4, payload)
+        self.head.value = head + needed
+
+        # The bump must be visible before waiting is read
+        self.atomics.fetch_add(self.seq, 1)
+        if self.waiting.value:
+            _futex(self.seq, _FUTEX_WAKE, 1)
+
+    def try_read(self) -> bytes | None:
+        tail = self.tail.value
+        available = self.head.value - tail
+        if available == 0:
+            return None
+        # The engine owns this ring; a record that does not fit in what it
+        # published means the mapping is corrupt, not a message to slice out
+        if available < 4 or available > self.size:
+            raise RuntimeError(f"Corrupt shared memory ring: {available} bytes published")
+        (length,) = struct.unpack("<I", self._copy_out(tail, 4))
+        if length > available - 4:
+            raise RuntimeError(f"Corrupt shared memory ring: record of {length} bytes")
+        payload = self._copy_out(tail + 4, length)
+        self.tail.value = tail + 4 + length
+        return payload
+
+    def read(self, timeout: float | None = None) -> bytes:
+        deadline = None if timeout is None else time.monotonic() + timeout
+        while True:
+            for _ in range(SPIN_ITERATIONS):
+                msg = self.try_read()
+                if msg is not None:
+                    return msg
+
+            seq = self.seq.value
+            # waiting must be visible before head is read again
+            self.atomics.store(self.waiting, 1)
+            msg = self.try_read()
+            if msg is not None:
+                self.waiting.value = 0
+                return msg
+            _futex(self.seq, _FUTEX_WAIT, seq, WAIT_TIMEOUT_NS)
+            self.waiting.value = 0
+
+            if deadline is not None and time.monotonic() > deadline:
+                raise TimeoutError("Timed out waiting for engine response")
+
+
+def _futex(word: ctypes.c_uint32, op: int, val: int, timeout_ns: int | None = None) -> None:
+    ts = None
+    if timeout_ns is not None:
+        ts = ctypes.byref(_Timespec(timeout_ns // 1_000_000_000, timeout_ns % 1_000_000_000))
+    _libc.syscall(_SYS_FUTEX, ctypes.byref(word), op, val, ts, None, 0)
+
+
+class ShmChannel:
+    """Request/response channel to an engine started with --shm <name>."""
+
+    def __init__(self, name: str, helper: str) -> None:
+        """helper is the path of libexchange_shm_client.so from the engine build."""
+        self.name = name
+        self.helper = helper
+        self._mm: mmap.mmap | None = None
+        self._requests: _Ring | None = None
+        self._responses: _Ring | None = None
+        self._closed_flag: ctypes.c_uint32 | None = None
+
+    def connect(self, timeout: float = 5.0) -> None:
+        """Map the engine's shared object, waiting for it to become ready."""
+        path = f"/dev/shm/{self.name}"
+        deadline = time.monotonic() + timeout
+        while True:
+            if os.path.exists(path) and os.path.getsize(path) >= FILE_HEADER_BYTES:
+                with open(path, "r+b") as f:
+                    mm = mmap.mmap(f.fileno(), 0)
+                magic, version, ring_bytes = struct.unpack_from("<QII", mm, 0)
+                if magic == MAGIC:
+                    break
+                mm.close()
+            if time.monotonic() > deadline:
+                raise RuntimeError(f"Shared memory transport {path} not ready")
+            time.sleep(0.01)
+
+        if version != VERSION:
+            mm.close()
+            raise RuntimeError(f"Unsupported shared memory transport version {version}")
+
+        try:
+            atomics = _Atomics(self.helper)
+        except OSError as e:
+            mm.close()
+            raise RuntimeError(f"Shared memory client library unavailable: {e}")
+
+        self._mm = mm
+        self._closed_flag = ctypes.c_uint32.from_buffer(mm, 16)
+        self._requests = _Ring(mm, FILE_HEADER_BYTES, ring_bytes, atomics)
+        self._responses = _Ring(
+            mm, FILE_HEADER_BYTES + RING_HEADER_BYTES + ring_bytes, ring_bytes, atomics
+        )
+
+    def request(self, payload: bytes, timeout: float | None = None) -> bytes:
+        if not self._requests or not self._responses:
+            raise RuntimeError("Shared memory transport not connected")
+        self._requests.write(payload)
+        return self._responses.read(timeout)
+
+    def close(self) -> None:
+        """Tell the engine this side is gone and unmap."""
+        if not self._mm:
+            return
+        if self._closed_flag is not None:
+            self._closed_flag.value = 1
+            if self._requests:
+                _futex(self._requests.seq, _FUTEX_WAKE, 1)
+        # ctypes views pin the buffer; drop them before closing the mapping
+        self._closed_flag = None
+        self._requests = None
+        self._responses = None
+        try:
+            self._mm.close()
+        except BufferError:
+            pass
+        self._mm = None
@@ -0,0 +1,503 @@
+// In-process benchmarks for MatchingEngine.
+//
+// Each benchmark builds its own engine, runs untimed warmup operations, then
+// times every measured operation individually into a log-linear histogram.
+// Results print as a table and, with --json, as machine-readable JSON.
+//
+// Usage: exchange_benchmark [--iterations N] [--warmup N] [--filter NAME]
+//                           [--json PATH|-] [--trace PATH] [--seed N]
+//        exchange_benchmark --write-trace PATH [--trace-ops N] [--seed N]
+//
+// The trace_replay benchmark and the replay log are driven by the workload
+// generator, or by a recorded trace given with --trace.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "exchange/clock.hpp"
+#include "exchange/latency_histogram.hpp"
+#include "exchange/matching_engine.hpp"
+#include "exchange/workload.hpp"
+
+using namespace exchange;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int64_t MID_PRICE = 10000 * PRICE_SCALE;
+constexpr int64_t TICK = PRICE_SCALE / 100;
+const std::string SYMBOL = "BTC-USD";
+
+struct Config {
+    size_t iterations = 100000;
+    size_t warmup = 10000;
+    std::string filter;
+    std::string json_path;
+    std::string trace_path;
+    std::string write_trace_path;
+    size_t trace_ops = 1000000;
+    uint64_t seed = 1;
+};
+
+// The recorded trace if one was given, else a fresh one from the generator
+Trace load_workload(const Config& cfg, size_t ops) {
+    if (!cfg.trace_path.empty()) {
+        if (auto t = read_trace(cfg.trace_path)) return *t;
+        std::cerr << "[BENCH] Could not read trace " << cfg.trace_path << ", generating\n";
+    }
+    WorkloadConfig wc;
+    wc.seed = cfg.seed;
+    return WorkloadGenerator(wc).generate(ops);
+}
+
+struct BenchResult {
+    explicit BenchResult(std::string n, std::string u = "op")
+        : name(std::move(n)), unit(std::move(u)) {}
+
+    std::string name;
+    std::string unit;
+    LatencyHistogram latency;  // ns per unit
+    double elapsed_s = 0;      // measured time only
+    nlohmann::json extra = nlohmann::json::object();
+};
+
+Order make_order(const std::string& account, Side side, int64_t price, int64_t qty,
+                 OrderType type = OrderType::LIMIT) {
+    Order o;
+    o.account_id = account;
+    o.symbol = SYMBOL;
+    o.side = side;
+    o.type = type;
+    o.price = price;
+    o.quantity = qty;
+    return o;
+}
+
+// Times one call of fn into the result's histogram
+template <typename Fn>
+void timed(BenchResult& r, Fn&& fn) {
+    auto t0 = Clock::now();
+    fn();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+    r.latency.record(static_cast<uint64_t>(ns));
+    r.elapsed_s += static_cast<double>(ns) / 1e9;
+}
+
+// Fills both sides with `levels` price levels of `per_level` orders each,
+// without crossing
+void seed_book(MatchingEngine& engine, size_t levels, size_t per_level) {
+    for (size_t l = 1; l <= levels; ++l) {
+        for (size_t k = 0; k < per_level; ++k) {
+            auto offset = static_cast<int64_t>(l) * TICK;
+            (void)engine.place_order(make_order("maker-b", Side::BUY, MID_PRICE - offset, 10));
+            (void)engine.place_order(make_order("maker-s", Side::SELL, MID_PRICE + offset, 10));
+        }
+    }
+}
+
+// Resting limit orders on both sides, spread over 100 levels
+BenchResult bench_place(const Config& cfg) {
+    BenchResult r("place");
+    MatchingEngine engine;
+    std::mt19937_64 rng(1);
+    std::uniform_int_distribution<int64_t> level(1, 100);
+
+    auto place_one = [&](size_t i) {
+        Side side = (i & 1) ? Side::BUY : Side::SELL;
+        int64_t offset = level(rng) * TICK;
+        int64_t price = side == Side::BUY ? MID_PRICE - offset : MID_PRICE + offset;
+        return make_order(side == Side::BUY ? "buyer" : "seller", side, price, 10);
+    };
+
+    for (size_t i = 0; i < cfg.warmup; ++i) (void)engine.place_order(place_one(i));
+    for (size_t i = 0; i < cfg.iterations; ++i) {
+        Order o = place_one(i);
+        timed(r, [&] { (void)engine.place_order(std::move(o)); });
+    }
+    return r;
+}
+
+// A market order sweeping 10 levels x 5 orders; the book is rebuilt untimed
+// before each sweep
+BenchResult bench_match_sweep(const Config& cfg) {
+    constexpr size_t LEVELS = 10;
+    constexpr size_t PER_LEVEL = 5;
+    BenchResult r("match_sweep", "sweep");
+    MatchingEngine engine;
+    size_t fills = 0;
+
+    auto rebuild = [&] {
+        for (size_t l = 1; l <= LEVELS; ++l) {
+            for (size_t k = 0; k < PER_LEVEL; ++k) {
+                auto price = MID_PRICE + static_cast<int64_t>(l) * TICK;
+                (void)engine.place_order(make_order("maker", Side::SELL, price, 10));
+            }
+        }
+    };
+    auto sweep = make_order("taker", Side::BUY, 0, LEVELS * PER_LEVEL * 10, OrderType::MARKET);
+
+    size_t rounds = std::max<size_t>(1, cfg.iterations / 50);
+    for (size_t i = 0; i < cfg.warmup / 50; ++i) {
+        rebuild();
+        (void)engine.place_order(sweep);
+    }
+    for (size_t i = 0; i < rounds; ++i) {
+        rebuild();
+        timed(r, [&] { fills += engine.place_order(sweep).trades.size(); });
+    }
+    double per_sweep = static_cast<double>(fills) / static_cast<double>(rounds);
+    r.extra["fills_per_sweep"] = per_sweep;
+    r.extra["ns_per_fill"] = r.latency.mean() / per_sweep;
+    return r;
+}
+
+// Cancels resting orders in random order out of a 100-level book
+BenchResult bench_cancel(const Config& cfg) {
+    BenchResult r("cancel");
+    MatchingEngine engine;
+    std::vector<uint64_t> ids;
+    ids.reserve(cfg.warmup + cfg.iterations);
+    for (size_t i = 0; i < cfg.warmup + cfg.iterations; ++i) {
+        auto offset = static_cast<int64_t>(1 + i % 100) * TICK;
+        ids.push_back(
+            engine.place_order(make_order("maker", Side::BUY, MID_PRICE - offset, 10)).order.id);
+    }
+    std::shuffle(ids.begin(), ids.end(), std::mt19937_64(2));
+
+    for (size_t i = 0; i < cfg.warmup; ++i) (void)engine.cancel_order(ids[i]);
+    for (size_t i = cfg.warmup; i < ids.size(); ++i) {
+        timed(r, [&] { (void)engine.cancel_order(ids[i]); });
+    }
+    return r;
+}
+
+// Inserts at random prices into a book already 10,000 levels deep per side
+BenchResult bench_deep_book_insert(const Config& cfg) {
+    constexpr int64_t DEPTH = 10000;
+    BenchResult r("deep_book_insert");
+    MatchingEngine engine;
+    seed_book(engine, DEPTH, 1);
+
+    std::mt19937_64 rng(3);
+    std::uniform_int_distribution<int64_t> level(1, DEPTH);
+    auto next = [&](size_t i) {
+        Side side = (i & 1) ? Side::BUY : Side::SELL;
+        int64_t offset = level(rng) * TICK;
+        int64_t price = side == Side::BUY ? MID_PRICE - offset : MID_PRICE + offset;
+        return make_order("maker", side, price, 10);
+    };
+
+    for (size_t i = 0; i < cfg.warmup; ++i) (void)engine.place_order(next(i));
+    for (size_t i = 0; i < cfg.iterations; ++i) {
+        Order o = next(i);
+        timed(r, [&] { (void)engine.place_order(std::move(o)); });
+    }
+    r.extra["levels_per_side"] = DEPTH;
+    return r;
+}
+
+// Top-10 L2 levels per side, as served by the get_book command
+BenchResult bench_get_book(const Config& cfg) {
+    BenchResult r("get_book");
+    MatchingEngine engine;
+    seed_book(engine, 1000, 4);
+    size_t sink = 0;
+
+    auto query = [&] {
+        auto* book = engine.get_book(SYMBOL);
+        sink += book->get_bid_levels(10).size() + book->get_ask_levels(10).size();
+    };
+    for (size_t i = 0; i < cfg.warmup; ++i) query();
+    for (size_t i = 0; i < cfg.iterations; ++i) timed(r, query);
+    r.extra["levels_returned"] = sink / (cfg.warmup + cfg.iterations);
+    return r;
+}
+
+// Last 100 trades for a symbol out of a 100,000-trade history
+BenchResult bench_get_trades(const Config& cfg) {
+    constexpr size_t HISTORY = 100000;
+    BenchResult r("get_trades");
+    MatchingEngine engine;
+    for (size_t i = 0; i < HISTORY; ++i) {
+        (void)engine.place_order(make_order("maker", Side::SELL, MID_PRICE, 10));
+        (void)engine.place_order(make_order("taker", Side::BUY, MID_PRICE, 10));
+    }
+
+    size_t rounds = std::max<size_t>(1, cfg.iterations / 10);
+    size_t sink = 0;
+    for (size_t i = 0; i < cfg.warmup / 10; ++i) sink += engine.get_trades(SYMBOL, 100).size();
+    for (size_t i = 0; i < rounds; ++i) {
+        timed(r, [&] { sink += engine.get_trades(SYMBOL, 100).size(); });
+    }
+    r.extra["history_trades"] = HISTORY;
+    r.extra["returned"] = sink / (cfg.warmup / 10 + rounds);
+    return r;
+}
+
+// Recovery from an event log; latency is per replayed event
+BenchResult bench_replay(const Config& cfg, const std::filesystem::path& dir) {
+    BenchResult r("replay", "event");
+    auto log_path = (dir / "replay_events.jsonl").string();
+
+    size_t events = 0;
+    {
+        MatchingEngine writer(log_path);
+        Trace trace = load_workload(cfg, cfg.iterations / 10);
+        TraceRunner(writer, trace).run();
+        events = writer.event_log().current_sequence();
+    }
+
+    constexpr size_t RUNS = 5;
+    double total_s = 0;
+    for (size_t run = 0; run < RUNS + 1; ++run) {
+        auto t0 = Clock::now();
+        MatchingEngine engine(log_path);
+        (void)engine.recover();
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+        if (run == 0) continue;  // warmup: page cache, allocator
+        r.latency.record(static_cast<uint64_t>(ns) / std::max<size_t>(events, 1));
+        total_s += static_cast<double>(ns) / 1e9;
+    }
+    r.elapsed_s = total_s;
+    r.extra["events"] = events;
+    r.extra["runs"] = RUNS;
+    r.extra["events_per_sec"] = static_cast<double>(events * RUNS) / total_s;
+    return r;
+}
+
+// Realistic mixed flow (places, cancels, replaces, sweeps) op by op
+BenchResult bench_trace_replay(const Config& cfg) {
+    BenchResult r("trace_replay");
+    MatchingEngine engine;
+    Trace trace = load_workload(cfg, cfg.warmup + cfg.iterations);
+    TraceRunner runner(engine, trace);
+
+    size_t warm = std::min(cfg.warmup, trace.ops.size());
+    while (runner.position() < warm) runner.step();
+    while (runner.position() < trace.ops.size()) timed(r, [&] { runner.step(); });
+
+    r.extra["ops"] = trace.ops.size();
+    r.extra["stats"] = runner.stats();
+    return r;
+}
+
+// Cost of one timestamp: the system clock the engine used to read for every
+// order, trade and event, against the TSC clock now read once per command.
+// Each fill used to take two reads (trade and its event), so the saving per
+// fill is twice the system clock cost.
+BenchResult bench_clock(const Config& cfg) {
+    constexpr size_t BATCH = 1000;
+    BenchResult r("clock", "read");
+    size_t rounds = std::max<size_t>(1, cfg.iterations / BATCH);
+    uint64_t sink = 0;
+
+    auto system_read = [] {
+        return static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+    };
+    LatencyHistogram system;
+    double system_s = 0;
+    for (size_t i = 0; i < rounds; ++i) {
+        auto t0 = Clock::now();
+        for (size_t k = 0; k < BATCH; ++k) sink += system_read();
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+        system.record(static_cast<uint64_t>(ns) / BATCH);
+        system_s += static_cast<double>(ns) / 1e9;
+    }
+
+    sink += now_ns();  // first read calibrates
+    for (size_t i = 0; i < rounds; ++i) {
+        auto t0 = Clock::now();
+        for (size_t k = 0; k < BATCH; ++k) sink += now_ns();
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+        r.latency.record(static_cast<uint64_t>(ns) / BATCH);
+        r.elapsed_s += static_cast<double>(ns) / 1e9 / BATCH;
+    }
+
+    double sys_ns = system_s * 1e9 / static_cast<double>(rounds * BATCH);
+    double tsc_ns = r.elapsed_s * 1e9 / static_cast<double>(rounds);
+    r.extra["source"] = TscClock::instance().using_tsc() ? "tsc" : "system";
+    r.extra["system_clock_ns"] = sys_ns;
+    r.extra["engine_clock_ns"] = tsc_ns;
+    r.extra["clock_reads_saved_per_fill"] = 2;
+    r.extra["saved_ns_per_fill"] = 2 * sys_ns;
+    r.extra["sink"] = sink & 1;
+    return r;
+}
+
+// RiskChecker::check_order alone over a mix of passing orders for 64
+// configured symbols; calls are timed in batches since one is below the
+// clock's resolution
+BenchResult bench_risk_check(const Config& cfg) {
+    constexpr size_t BATCH = 1000;
+    BenchResult r("risk_check", "order");
+    RiskLimits limits;
+    for (int i = 0; i < 64; ++i) {
+        SymbolRiskConfig c;
+        c.symbol = "SYM" + std::to_string(i) + "-USD";
+        c.tick_size = TICK;
+        c.max_price = 2 * MID_PRICE;
+        limits.symbols.push_back(c);
+    }
+    RiskChecker checker(limits);
+
+    std::vector<Order> orders;
+    for (size_t i = 0; i < BATCH; ++i) {
+        Order o = make_order("acct", Side::BUY, MID_PRICE - static_cast<int64_t>(i % 100) * TICK,
+                             10 + static_cast<int64_t>(i));
+        o.symbol = limits.symbols[i % limits.symbols.size()].symbol;
+        orders.push_back(o);
+    }
+
+    size_t rounds = std::max<size_t>(1, cfg.iterations / BATCH);
+    size_t passed = 0;
+    for (const auto& o : orders) passed += checker.check_order(o).passed;
+    for (size_t i = 0; i < rounds; ++i) {
+        auto t0 = Clock::now();
+        for (const auto& o : orders) passed += checker.check_order(o).passed;
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+        r.latency.record(static_cast<uint64_t>(ns) / BATCH);
+        r.elapsed_s += static_cast<double>(ns) / 1e9 / BATCH;
+    }
+    r.extra["symbols"] = limits.symbols.size() + limits.allowed_symbols.size();
+    r.extra["passed"] = passed;
+    return r;
+}
+
+// create_snapshot plus JSON serialization with 20,000 resting orders
+BenchResult bench_snapshot(const Config& cfg) {
+    BenchResult r("snapshot", "snapshot");
+    MatchingEngine engine;
+    seed_book(engine, 1000, 10);
+
+    size_t rounds = std::max<size_t>(1, cfg.iterations / 1000);
+    size_t bytes = 0;
+    auto take = [&] {
+        nlohmann::json j = engine.create_snapshot();
+        bytes = j.dump().size();
+    };
+    take();
+    for (size_t i = 0; i < rounds; ++i) timed(r, take);
+    r.extra["resting_orders"] = 20000;
+    r.extra["bytes"] = bytes;
+    return r;
+}
+
+nlohmann::json to_json_result(const BenchResult& r) {
+    uint64_t n = r.latency.count();
+    nlohmann::json j = {
+        {"name", r.name},
+        {"unit", r.unit},
+        {"count", n},
+        {"ops_per_sec", r.elapsed_s > 0 ? static_cast<double>(n) / r.elapsed_s : 0.0},
+        {"latency_ns", r.latency},
+    };
+    if (!r.extra.empty()) j["extra"] = r.extra;
+    return j;
+}
+
+void print_table(const std::vector<BenchResult>& results) {
+    std::printf("%-18s %-9s %9s %12s %9s %9s %9s %9s %10s\n", "benchmark", "unit", "count",
+                "ops/sec", "p50 ns", "p99 ns", "p99.9 ns", "max ns", "mean ns");
+    for (const auto& r : results) {
+        const auto& h = r.latency;
+        double ops = r.elapsed_s > 0 ? static_cast<double>(h.count()) / r.elapsed_s : 0.0;
+        std::printf("%-18s %-9s %9llu %12.0f %9llu %9llu %9llu %9llu %10.1f\n", r.name.c_str(),
+                    r.unit.c_str(), static_cast<unsigned long long>(h.count()), ops,
+                    static_cast<unsigned long long>(h.percentile(0.50)),
+                    static_cast<unsigned long long>(h.percentile(0.99)),
+                    static_cast<unsigned long long>(h.percentile(0.999)),
+                    static_cast<unsigned long long>(h.max()), h.mean());
+    }
+}
+
+bool parse_args(int argc, char** argv, Config& cfg) {
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--iterations" && i + 1 < argc) cfg.iterations = std::stoull(argv[++i]);
+        else if (a == "--warmup" && i + 1 < argc) cfg.warmup = std::stoull(argv[++i]);
+        else if (a == "--filter" && i + 1 < argc) cfg.filter = argv[++i];
+        else if (a == "--json" && i + 1 < argc) cfg.json_path = argv[++i];
+        else if (a == "--trace" && i + 1 < argc) cfg.trace_path = argv[++i];
+        else if (a == "--write-trace" && i + 1 < argc) cfg.write_trace_path = argv[++i];
+        else if (a == "--trace-ops" && i + 1 < argc) cfg.trace_ops = std::stoull(argv[++i]);
+        else if (a == "--seed" && i + 1 < argc) cfg.seed = std::stoull(argv[++i]);
+        else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--iterations N] [--warmup N] [--filter NAME] [--json PATH|-]"
+                         " [--trace PATH] [--seed N]\n"
+                      << "       " << argv[0] << " --write-trace PATH [--trace-ops N] [--seed N]\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Config cfg;
+    if (!parse_args(argc, argv, cfg)) return 1;
+
+    if (!cfg.write_trace_path.empty()) {
+        WorkloadConfig wc;
+        wc.seed = cfg.seed;
+        Trace trace = WorkloadGenerator(wc).generate(cfg.trace_ops);
+        if (!write_trace(cfg.write_trace_path, trace)) {
+            std::cerr << "[BENCH] Could not write " << cfg.write_trace_path << std::endl;
+            return 1;
+        }
+        std::cerr << "[BENCH] Wrote " << trace.ops.size() << " ops to " << cfg.write_trace_path
+                  << std::endl;
+        return 0;
+    }
+
+    auto dir = std::filesystem::temp_directory_path() /
+               ("aztec_bench_" + std::to_string(Clock::now().time_since_epoch().count()));
+    std::filesystem::create_directories(dir);
+
+    const std::vector<std::pair<std::string, std::function<BenchResult()>>> benches = {
+        {"place", [&] { return bench_place(cfg); }},
+        {"match_sweep", [&] { return bench_match_sweep(cfg); }},
+        {"cancel", [&] { return bench_cancel(cfg); }},
+        {"deep_book_insert", [&] { return bench_deep_book_insert(cfg); }},
+        {"get_book", [&] { return bench_get_book(cfg); }},
+        {"get_trades", [&] { return bench_get_trades(cfg); }},
+        {"trace_replay", [&] { return bench_trace_replay(cfg); }},
+        {"replay", [&] { return bench_replay(cfg, dir); }},
+        {"snapshot", [&] { return bench_snapshot(cfg); }},
+        {"clock", [&] { return bench_clock(cfg); }},
+        {"risk_check", [&] { return bench_risk_check(cfg); }},
+    };
+
+    std::vector<BenchResult> results;
+    for (const auto& [name, run] : benches) {
+        if (!cfg.filter.empty() && name.find(cfg.filter) == std::string::npos) continue;
+        std::cerr << "[BENCH] " << name << "..." << std::endl;
+        results.push_back(run());
+    }
+    std::filesystem::remove_all(dir);
+
+    print_table(results);
+
+    if (!cfg.json_path.empty()) {
+        nlohmann::json out = {{"iterations", cfg.iterations},
+                              {"warmup", cfg.warmup},
+                              {"results", nlohmann::json::array()}};
+        for (const auto& r : results) out["results"].push_back(to_json_result(r));
+        if (cfg.json_path == "-") {
+            std::cout << out.dump(2) << std::endl;
+        } else {
+            std::ofstream(cfg.json_path) << out.dump(2) << "\n";
+        }
+    }
+    return 0;
+}
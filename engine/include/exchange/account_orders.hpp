@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+
+#include "exchange/types.hpp"
+
+namespace exchange {
+
+// One account's open orders (resting or untriggered stops) as an intrusive
+// doubly linked list threaded through Order::account_prev/account_next.
+// Orders are kept by id, i.e. in placement order, whenever they were linked,
+// so an order re-linked after a modify or a stop firing keeps its place and
+// a list rebuilt on recovery comes out the same. Adding the newest order and
+// removing any order are O(1) with no allocation, and walking the list
+// touches only the account's own orders.
+class AccountOrders {
+public:
+    class Iterator {
+    public:
+        explicit Iterator(Order* o) : o_(o) {}
+        Order* operator*() const { return o_; }
+        Iterator& operator++() {
+            o_ = o_->account_next;
+            return *this;
+        }
+        bool operator!=(const Iterator& other) const { return o_ != other.o_; }
+
+    private:
+        Order* o_;
+    };
+
+    // Links o after the last order with a lower id, searching from the back
+    void insert(Order* o) {
+        Order* prev = tail_;
+        while (prev && prev->id > o->id) prev = prev->account_prev;
+        Order* next = prev ? prev->account_next : head_;
+        o->account_prev = prev;
+        o->account_next = next;
+        (prev ? prev->account_next : head_) = o;
+        (next ? next->account_prev : tail_) = o;
+        ++size_;
+    }
+
+    // False if the order is not in the list
+    bool erase(Order* o) {
+        if (!o->account_prev && head_ != o) return false;
+        if (o->account_prev) {
+            o->account_prev->account_next = o->account_next;
+        } else {
+            head_ = o->account_next;
+        }
+        if (o->account_next) {
+            o->account_next->account_prev = o->account_prev;
+        } else {
+            tail_ = o->account_prev;
+        }
+        o->account_prev = o->account_next = nullptr;
+        --size_;
+        return true;
+    }
+
+    [[nodiscard]] Iterator begin() const { return Iterator(head_); }
+    [[nodiscard]] Iterator end() const { return Iterator(nullptr); }
+    [[nodiscard]] size_t size() const { return size_; }
+    [[nodiscard]] bool empty() const { return size_ == 0; }
+
+private:
+    Order* head_ = nullptr;
+    Order* tail_ = nullptr;
+    size_t size_ = 0;
+};
+
+}  // namespace exchange
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace exchange {
+
+// Wall-clock nanoseconds derived from the CPU timestamp counter.
+//
+// When the TSC is invariant (constant rate across P/C-states), now_ns() is
+// one rdtsc plus a multiply: base_ns + (tsc - base_tsc) * ns_per_tick. The
+// rate starts from a short calibration and is refined against
+// CLOCK_MONOTONIC_RAW at every re-sync, which happens inline once
+// RESYNC_INTERVAL_NS has passed and also re-anchors base_ns to CLOCK_REALTIME.
+// Without an invariant TSC it reads the system clock instead. Either way
+// reads by a single caller (the matching thread) never go backwards, even if
+// the system clock is stepped.
+class TscClock {
+public:
+    static constexpr uint64_t RESYNC_INTERVAL_NS = 1000000000;  // 1s
+
+    static TscClock& instance();
+
+    [[nodiscard]] uint64_t now_ns();
+
+    // Re-anchor to CLOCK_REALTIME and refine the tick rate against
+    // CLOCK_MONOTONIC_RAW
+    void resync();
+
+    [[nodiscard]] bool using_tsc() const { return use_tsc_; }
+    [[nodiscard]] double ns_per_tick() const {
+        return ns_per_tick_.load(std::memory_order_relaxed);
+    }
+    [[nodiscard]] uint64_t resync_count() const {
+        return resyncs_.load(std::memory_order_relaxed);
+    }
+
+private:
+    TscClock();
+
+    bool use_tsc_ = false;
+
+    // TSC and raw monotonic time at first sync; the rate is measured over
+    // the whole span since
+    uint64_t origin_tsc_ = 0;
+    uint64_t origin_raw_ns_ = 0;
+
+    // Current anchor, published under a seqlock (odd = update in progress)
+    std::atomic<uint32_t> seq_{0};
+    std::atomic<uint64_t> base_tsc_{0};
+    std::atomic<uint64_t> base_ns_{0};
+    std::atomic<double> ns_per_tick_{1.0};
+    std::atomic<uint64_t> next_resync_tsc_{0};
+
+    std::atomic<uint64_t> last_ns_{0};
+    std::atomic<uint64_t> resyncs_{0};
+    std::atomic<bool> resyncing_{false};
+
+    uint64_t monotonic(uint64_t ns);
+};
+
+// True if the CPU advertises an invariant TSC (x86 CPUID 0x80000007 EDX[8]);
+// the ARM generic timer always runs at a fixed rate
+[[nodiscard]] bool has_invariant_tsc();
+
+}  // namespace exchange
@@ -9,23 +9,41 @@
 
 namespace exchange {
 
+// Append-only JSONL journal. append() only buffers; flush() writes everything
+// buffered since the last flush with a single write, so a command that emits
+// several events costs one syscall instead of one per event.
 class EventLog {
 public:
     explicit EventLog(const std::string& path = "");
+    ~EventLog();
 
     void append(const Event& event);
+    void flush();
     [[nodiscard]] std::vector<Event> read_all() const;
     [[nodiscard]] std::vector<Event> read_from(uint64_t start_sequence) const;
 
     [[nodiscard]] uint64_t current_sequence() const { return sequence_; }
     uint64_t next_sequence();
 
+    // Hand writing over to an I/O backend (e.g. io_uring) that batches the
+    // journal with its socket writes: flush() becomes a no-op and the backend
+    // collects the bytes with take_pending().
+    void set_external_writer(bool external) { external_writer_ = external; }
+    [[nodiscard]] std::string take_pending();
+
+    [[nodiscard]] bool enabled() const { return enabled_; }
+    [[nodiscard]] const std::string& path() const { return path_; }
+    [[nodiscard]] uint64_t write_calls() const { return write_calls_; }
+
 private:
     std::string path_;
     std::ofstream file_;
+    std::string pending_;
     uint64_t sequence_ = 0;
+    uint64_t write_calls_ = 0;
     mutable std::mutex mutex_;
     bool enabled_ = false;
+    bool external_writer_ = false;
 };
 
 }  // namespace exchange
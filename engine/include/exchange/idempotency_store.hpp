@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "exchange/types.hpp"
+
+namespace exchange {
+
+// 128-bit fingerprint of an idempotency key, stored in place of the key
+struct KeyFingerprint {
+    uint64_t hi = 0;
+    uint64_t lo = 0;
+
+    bool operator==(const KeyFingerprint& o) const { return hi == o.hi && lo == o.lo; }
+};
+
+struct KeyFingerprintHash {
+    size_t operator()(const KeyFingerprint& f) const { return static_cast<size_t>(f.lo); }
+};
+
+// Idempotency keys seen recently, each with the order that first used it
+// and what placing it returned, so a retry gets the same answer. Entries are
+// fixed-size fingerprints kept in arrival order and evicted oldest first,
+// once older than the TTL or when the store is at capacity, so memory is
+// bounded whatever the key lengths or traffic. Times are command timestamps,
+// which makes eviction replay deterministically from the journal.
+class IdempotencyStore {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 1 << 20;
+    static constexpr uint64_t DEFAULT_TTL_NS = 24ULL * 3600 * 1000000000;  // 1 day
+
+    // The placement's result: the order as its command left it and the
+    // trades it made. order.id is 0 until the command has finished.
+    struct Response {
+        bool success = false;
+        ErrorCode error_code = ErrorCode::NONE;
+        Order order;
+        std::vector<Trade> trades;
+    };
+
+    struct Entry {
+        KeyFingerprint key;
+        uint64_t order_id = 0;
+        uint64_t timestamp_ns = 0;
+        Response response;
+    };
+
+    explicit IdempotencyStore(size_t capacity = DEFAULT_CAPACITY,
+                              uint64_t ttl_ns = DEFAULT_TTL_NS)
+        : capacity_(capacity), ttl_ns_(ttl_ns) {}
+
+    // Two independent 64-bit hashes of the key; not cryptographic
+    [[nodiscard]] static KeyFingerprint fingerprint(std::string_view key);
+
+    // The key's entry, nullptr if unseen or evicted. Expires entries older
+    // than the TTL at now_ns first.
+    const Entry* find(const KeyFingerprint& key, uint64_t now_ns);
+    // Records a key not already present, evicting to stay within capacity
+    void insert(const KeyFingerprint& key, uint64_t order_id, uint64_t now_ns);
+    // Attaches the placement's result once its command finishes; ignored if
+    // the key is not held
+    void set_response(const KeyFingerprint& key, Response response);
+    void clear();
+
+    // Oldest first, for snapshots; restore() takes them back in that order
+    [[nodiscard]] const std::deque<Entry>& entries() const { return entries_; }
+    void restore(const std::deque<Entry>& entries);
+
+    [[nodiscard]] size_t size() const { return entries_.size(); }
+    [[nodiscard]] size_t capacity() const { return capacity_; }
+    [[nodiscard]] uint64_t ttl_ns() const { return ttl_ns_; }
+    // Approximate heap use of the index, the eviction queue and the cached
+    // responses
+    [[nodiscard]] size_t memory_bytes() const;
+
+private:
+    size_t capacity_;
+    uint64_t ttl_ns_;
+    // Points into entries_; a deque keeps them valid as it grows and pops
+    std::unordered_map<KeyFingerprint, Entry*, KeyFingerprintHash> index_;
+    std::deque<Entry> entries_;
+    size_t response_bytes_ = 0;
+
+    void expire(uint64_t now_ns);
+    void pop_oldest();
+};
+
+}  // namespace exchange
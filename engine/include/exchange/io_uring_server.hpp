@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "exchange/event_log.hpp"
+#include "exchange/protocol.hpp"
+
+namespace exchange {
+
+struct IoUringServerStats {
+    uint64_t connections_accepted = 0;
+    uint64_t requests = 0;
+    uint64_t submit_syscalls = 0;  // io_uring_enter calls; the only syscalls on the hot path
+    uint64_t log_writes = 0;
+};
+
+// io_uring backend for the UNIX socket server. Each loop iteration is one
+// matching cycle: every completed recv is handled, the journal bytes the
+// cycle produced become a single write SQE, and responses are queued as sends
+// once that write has completed, so nothing is acknowledged before it is in
+// the log. All queued SQEs go to the kernel in one io_uring_submit_and_wait.
+//
+// Only functional when built with liburing (EXCHANGE_HAVE_IO_URING);
+// otherwise available() is false and listen() fails.
+class IoUringServer {
+public:
+    IoUringServer(ProtocolHandler& handler, EventLog& log, std::string path);
+    ~IoUringServer();
+
+    IoUringServer(const IoUringServer&) = delete;
+    IoUringServer& operator=(const IoUringServer&) = delete;
+
+    [[nodiscard]] static bool available();
+
+    bool listen();
+    // Runs until a shutdown command is handled
+    void run();
+
+    [[nodiscard]] const IoUringServerStats& stats() const { return stats_; }
+
+private:
+    struct Impl;
+
+    ProtocolHandler& handler_;
+    EventLog& log_;
+    std::string path_;
+    std::unique_ptr<Impl> impl_;
+    IoUringServerStats stats_;
+};
+
+}  // namespace exchange
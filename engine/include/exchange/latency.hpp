@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "exchange/latency_histogram.hpp"
+#include "exchange/tsc.hpp"
+
+namespace exchange {
+
+// Stages of a command through the engine. handle and place_order are
+// end-to-end totals; the others are exclusive of each other.
+enum class LatencyStage : uint8_t {
+    PARSE,        // JSON text -> json value
+    DECODE,       // json value -> Order
+    RISK_CHECK,
+    MATCH,        // excluding the trade events it journals
+    EVENT_LOG,    // per command: building and appending events, then the write
+    SERIALIZE,    // building and dumping the response
+    PLACE_ORDER,  // MatchingEngine::place_order total
+    HANDLE,       // ProtocolHandler::handle total
+    COUNT
+};
+
+constexpr std::array<const char*, static_cast<size_t>(LatencyStage::COUNT)> LATENCY_STAGE_NAMES =
+    {"parse", "decode", "risk_check", "match", "event_log", "serialize", "place_order", "handle"};
+
+// Per-stage histograms of rdtsc() ticks, reported in nanoseconds. Stages that
+// happen in several pieces per command (event log, serialize) accrue into a
+// pending total that commit() records as one sample. Single-threaded, like
+// the engine.
+class LatencyRecorder {
+public:
+    LatencyRecorder() : histograms_(static_cast<size_t>(LatencyStage::COUNT)) {}
+
+    void record(LatencyStage stage, uint64_t ticks) { histograms_[idx(stage)].record(ticks); }
+
+    void accrue(LatencyStage stage, uint64_t ticks) {
+        pending_[idx(stage)] += ticks;
+        nested_ticks_ += ticks;
+    }
+
+    void commit(LatencyStage stage) {
+        auto& p = pending_[idx(stage)];
+        if (p == 0) return;
+        record(stage, p);
+        p = 0;
+    }
+
+    [[nodiscard]] uint64_t pending(LatencyStage stage) const { return pending_[idx(stage)]; }
+
+    // Running total of accrued ticks, so an enclosing stage can exclude them
+    [[nodiscard]] uint64_t nested_ticks() const { return nested_ticks_; }
+
+    [[nodiscard]] const LatencyHistogram& histogram(LatencyStage stage) const {
+        return histograms_[idx(stage)];
+    }
+
+    void reset() {
+        for (auto& h : histograms_) h.reset();
+        pending_.fill(0);
+    }
+
+private:
+    static constexpr size_t idx(LatencyStage s) { return static_cast<size_t>(s); }
+
+    std::vector<LatencyHistogram> histograms_;  // heap: each is ~15KB
+    std::array<uint64_t, static_cast<size_t>(LatencyStage::COUNT)> pending_{};
+    uint64_t nested_ticks_ = 0;
+};
+
+// {"enabled", "ns_per_tick", "stages": {name: {count, min, mean, p50, p90,
+// p99, p999, max}}}, all values in nanoseconds
+void to_json(nlohmann::json& j, const LatencyRecorder& r);
+
+// Records the enclosing scope's full duration
+class LatencyScope {
+public:
+    LatencyScope(LatencyRecorder& recorder, LatencyStage stage)
+        : recorder_(recorder), stage_(stage), start_(rdtsc()) {}
+    ~LatencyScope() { recorder_.record(stage_, rdtsc() - start_); }
+
+    LatencyScope(const LatencyScope&) = delete;
+    LatencyScope& operator=(const LatencyScope&) = delete;
+
+private:
+    LatencyRecorder& recorder_;
+    LatencyStage stage_;
+    uint64_t start_;
+};
+
+}  // namespace exchange
+
+// Instrumentation macros. With ENABLE_LATENCY_STATS off they expand to
+// nothing, so the hot path carries no timestamp reads at all.
+#ifdef EXCHANGE_LATENCY_STATS
+#define EXCHANGE_LATENCY_BEGIN(rec, name)                  \
+    [[maybe_unused]] const uint64_t name = ::exchange::rdtsc(); \
+    [[maybe_unused]] const uint64_t name##_nested = (rec).nested_ticks()
+#define EXCHANGE_LATENCY_END(rec, stage, name) \
+    (rec).record((stage), ::exchange::rdtsc() - name - ((rec).nested_ticks() - name##_nested))
+#define EXCHANGE_LATENCY_ACCRUE(rec, stage, name) \
+    (rec).accrue((stage), ::exchange::rdtsc() - name)
+#define EXCHANGE_LATENCY_COMMIT(rec, stage) (rec).commit(stage)
+#define EXCHANGE_LATENCY_SCOPE(rec, stage) \
+    ::exchange::LatencyScope exchange_latency_scope_{(rec), (stage)}
+#else
+#define EXCHANGE_LATENCY_BEGIN(rec, name) ((void)0)
+#define EXCHANGE_LATENCY_END(rec, stage, name) ((void)0)
+#define EXCHANGE_LATENCY_ACCRUE(rec, stage, name) ((void)0)
+#define EXCHANGE_LATENCY_COMMIT(rec, stage) ((void)0)
+#define EXCHANGE_LATENCY_SCOPE(rec, stage) ((void)0)
+#endif
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+
+#include <nlohmann/json.hpp>
+
+namespace exchange {
+
+// Log-linear (HDR-style) histogram of non-negative integer samples,
+// typically nanoseconds. Values below 2^SUB_BITS get their own bucket; each
+// power-of-two range above that is split into 2^SUB_BITS linear buckets, so
+// any reported percentile is within 1/2^SUB_BITS (~3%) of the true value.
+// Fixed size, no allocation, O(1) record.
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BITS = 5;
+    static constexpr uint64_t SUB_COUNT = uint64_t{1} << SUB_BITS;
+    static constexpr size_t BUCKETS = (64 - SUB_BITS + 1) * SUB_COUNT;
+
+    void record(uint64_t value) {
+        buckets_[bucket_index(value)]++;
+        count_++;
+        sum_ += value;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < BUCKETS; ++i) buckets_[i] += other.buckets_[i];
+        count_ += other.count_;
+        sum_ += other.sum_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    void reset() { *this = LatencyHistogram{}; }
+
+    [[nodiscard]] uint64_t count() const { return count_; }
+    [[nodiscard]] uint64_t min() const { return count_ ? min_ : 0; }
+    [[nodiscard]] uint64_t max() const { return max_; }
+    [[nodiscard]] double mean() const {
+        return count_ ? static_cast<double>(sum_) / static_cast<double>(count_) : 0.0;
+    }
+
+    // Smallest bucket upper bound covering fraction p (0..1) of the samples,
+    // clamped to the observed max
+    [[nodiscard]] uint64_t percentile(double p) const {
+        if (count_ == 0) return 0;
+        auto rank = static_cast<uint64_t>(p * static_cast<double>(count_) + 0.5);
+        rank = std::clamp<uint64_t>(rank, 1, count_);
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            seen += buckets_[i];
+            if (seen >= rank) return std::min(bucket_upper(i), max_);
+        }
+        return max_;
+    }
+
+    static constexpr size_t bucket_index(uint64_t value) {
+        if (value < SUB_COUNT) return static_cast<size_t>(value);
+        unsigned top = 63 - static_cast<unsigned>(std::countl_zero(value));
+        unsigned shift = top - SUB_BITS;
+        uint64_t sub = (value >> shift) & (SUB_COUNT - 1);
+        return static_cast<size_t>((shift + 1) * SUB_COUNT + sub);
+    }
+
+    static constexpr uint64_t bucket_upper(size_t index) {
+        if (index < SUB_COUNT) return index;
+        uint64_t shift = index / SUB_COUNT - 1;
+        uint64_t sub = index % SUB_COUNT;
+        uint64_t lower = (SUB_COUNT + sub) << shift;
+        return lower + ((uint64_t{1} << shift) - 1);
+    }
+
+private:
+    std::array<uint64_t, BUCKETS> buckets_{};
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t min_ = std::numeric_limits<uint64_t>::max();
+    uint64_t max_ = 0;
+};
+
+inline void to_json(nlohmann::json& j, const LatencyHistogram& h) {
+    j = nlohmann::json{
+        {"count", h.count()},
+        {"min", h.min()},
+        {"mean", h.mean()},
+        {"p50", h.percentile(0.50)},
+        {"p90", h.percentile(0.90)},
+        {"p99", h.percentile(0.99)},
+        {"p999", h.percentile(0.999)},
+        {"max", h.max()}
+    };
+}
+
+}  // namespace exchange
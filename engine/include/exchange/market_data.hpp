@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include "exchange/spsc_ring.hpp"
+#include "exchange/types.hpp"
+
+namespace exchange {
+
+// Order-by-order (L3) market data. Consumers rebuild the full queue by
+// applying these to a get_book_l3 snapshot taken at a known sequence.
+enum class L3MessageType : uint8_t { ADD, MODIFY, EXECUTE, DELETE };
+
+NLOHMANN_JSON_SERIALIZE_ENUM(L3MessageType, {
+    {L3MessageType::ADD, "ADD"},
+    {L3MessageType::MODIFY, "MODIFY"},
+    {L3MessageType::EXECUTE, "EXECUTE"},
+    {L3MessageType::DELETE, "DELETE"}
+})
+
+// Fixed-size record (one cache line) so publishing never allocates on the
+// matching thread
+struct L3Message {
+    uint64_t sequence = 0;
+    uint64_t timestamp_ns = 0;
+    uint64_t order_id = 0;
+    uint64_t trade_id = 0;  // EXECUTE only
+    int64_t price = 0;
+    int64_t quantity = 0;   // ADD/MODIFY: resting qty, EXECUTE: filled qty
+    L3MessageType type = L3MessageType::ADD;
+    Side side = Side::BUY;
+    char symbol[MAX_SYMBOL_LEN + 1] = {};  // books only exist for symbols that fit
+};
+static_assert(sizeof(L3Message) == 64);
+
+void to_json(nlohmann::json& j, const L3Message& m);
+
+// Publication side of the L3 feed. publish() is called from the matching
+// thread and only copies into a lock-free ring; a consumer thread drains the
+// ring to a file or, for "unix:<path>" sinks, a connected UNIX stream socket.
+class MarketDataFeed {
+public:
+    static constexpr size_t RING_CAPACITY = 1 << 16;
+
+    explicit MarketDataFeed(std::string sink);
+    ~MarketDataFeed();
+
+    MarketDataFeed(const MarketDataFeed&) = delete;
+    MarketDataFeed& operator=(const MarketDataFeed&) = delete;
+
+    bool start();
+    // Drains everything published so far, then joins the consumer thread
+    void stop();
+
+    void publish(L3MessageType type, const Order& order, int64_t quantity,
+                 uint64_t trade_id = 0);
+
+    // Timestamp stamped on messages published from here on; the engine sets
+    // it once per command instead of each message reading the clock
+    void set_timestamp(uint64_t ts_ns) { timestamp_ns_ = ts_ns; }
+
+    [[nodiscard]] uint64_t current_sequence() const { return sequence_; }
+    [[nodiscard]] uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    std::string sink_;
+    int fd_ = -1;
+    bool is_socket_ = false;
+
+    SpscRing<L3Message, RING_CAPACITY> ring_;
+    std::thread consumer_;
+    std::atomic<bool> running_{false};
+
+    uint64_t sequence_ = 0;
+    uint64_t timestamp_ns_ = 0;
+    std::atomic<uint64_t> dropped_{0};
+
+    void run();
+    bool write_all(const std::string& data);
+};
+
+}  // namespace exchange
@@ -1,14 +1,25 @@
 #pragma once
 
+#include <array>
+#include <functional>
+#include <map>
 #include <memory>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include "exchange/account_orders.hpp"
 #include "exchange/event_log.hpp"
+#include "exchange/idempotency_store.hpp"
+#include "exchange/latency.hpp"
+#include "exchange/market_data.hpp"
 #include "exchange/order_book.hpp"
 #include "exchange/risk_checks.hpp"
 #include "exchange/snapshot.hpp"
+#include "exchange/stop_book.hpp"
+#include "exchange/symbol_table.hpp"
+#include "exchange/timer_wheel.hpp"
 #include "exchange/types.hpp"
 
 namespace exchange {
@@ -18,6 +29,7 @@ struct PlaceOrderResult {
     ErrorCode error_code = ErrorCode::NONE;
     Order order;
     std::vector<Trade> trades;
+    bool duplicate = false;  // a retried idempotency key, answered from the cache
 };
 
 struct CancelOrderResult {
@@ -26,12 +38,39 @@ struct CancelOrderResult {
     Order order{};
 };
 
+// Cancels every resting order matching both filters; empty means any
+struct MassCancelRequest {
+    std::string account_id;
+    std::string symbol;
+    bool block = false;  // also reject new orders from account_id until unblocked
+};
+
+struct MassCancelResult {
+    bool success = false;
+    ErrorCode error_code = ErrorCode::NONE;
+    std::vector<uint64_t> order_ids;  // ascending
+};
+
+// A symbol state change; uncross and trades are set when it opened the
+// symbol by uncrossing a crossed book
+struct SymbolStateResult {
+    bool success = false;
+    ErrorCode error_code = ErrorCode::NONE;
+    SymbolState state = SymbolState::CONTINUOUS;
+    AuctionPrice uncross;
+    std::vector<Trade> trades;
+};
+
 struct EngineStats {
     uint64_t total_orders = 0;
     uint64_t total_trades = 0;
     uint64_t total_cancels = 0;
     uint64_t total_rejects = 0;
     uint64_t event_sequence = 0;
+    uint64_t idempotency_keys = 0;   // keys currently remembered
+    uint64_t idempotency_bytes = 0;  // approximate memory they use
+    // Self-trade prevention firings, indexed by SelfTradePrevention mode
+    std::array<uint64_t, SELF_TRADE_PREVENTION_MODES> self_trade_prevented{};
 };
 
 // JSON serialization for EngineStats
@@ -41,18 +80,66 @@ inline void to_json(nlohmann::json& j, const EngineStats& s) {
         {"total_trades", s.total_trades},
         {"total_cancels", s.total_cancels},
         {"total_rejects", s.total_rejects},
-        {"event_sequence", s.event_sequence}
+        {"event_sequence", s.event_sequence},
+        {"idempotency_keys", s.idempotency_keys},
+        {"idempotency_bytes", s.idempotency_bytes}
     };
+    auto& stp = j["self_trade_prevented"] = nlohmann::json::object();
+    for (size_t i = 0; i < s.self_trade_prevented.size(); ++i) {
+        stp[nlohmann::json(static_cast<SelfTradePrevention>(i)).get<std::string>()] =
+            s.self_trade_prevented[i];
+    }
 }
 
+// Called with the new top of book whenever a command changes it, stamped with
+// the command's timestamp like its trades and events
+using BboListener =
+    std::function<void(const std::string& symbol, const Bbo& bbo, uint64_t timestamp_ns)>;
+
 class MatchingEngine {
 public:
     MatchingEngine(const std::string& event_log_path = "",
                    const std::string& snapshot_path = "",
                    uint64_t snapshot_interval = 1000);
 
+    // A reused idempotency key still remembered is answered with the result
+    // its first placement returned (success or error, the order as that
+    // command left it, its trades), marked duplicate, and places nothing
     PlaceOrderResult place_order(Order order);
     CancelOrderResult cancel_order(uint64_t order_id);
+    // By the account's client_order_id, which names at most one open order
+    // of the account at a time; closed orders are no longer found
+    CancelOrderResult cancel_order(const std::string& account_id,
+                                   const std::string& client_order_id);
+    // Cancel-replace of a resting limit order in one step. new_quantity is the
+    // new total size, filled quantity included. Reducing the size at the same
+    // price keeps queue position; any other change loses it and the order
+    // is matched again like a new one, keeping its id. A replacement that
+    // would be refused outright (post-only crossing, self-trade prevention)
+    // is rejected and the original keeps resting with its priority.
+    PlaceOrderResult modify_order(uint64_t order_id, int64_t new_price, int64_t new_quantity);
+    MassCancelResult mass_cancel(const MassCancelRequest& request);
+    // False if the account was not blocked
+    bool unblock_account(const std::string& account_id);
+    [[nodiscard]] bool is_blocked(const std::string& account_id) const {
+        return blocked_accounts_.count(account_id) > 0;
+    }
+    // Moves an allowed symbol to a new trading phase, journaled as
+    // SYMBOL_STATE_CHANGED. While PRE_OPEN or AUCTION, limit orders rest
+    // without matching, even crossed, and market, IOC, FOK and post-only
+    // orders are refused with SYMBOL_IN_AUCTION. Moving to CONTINUOUS
+    // uncrosses the book: everything that can trade does, at one price.
+    SymbolStateResult set_symbol_state(const std::string& symbol, SymbolState state);
+    // Symbols never moved are CONTINUOUS, at no cost while none has been
+    [[nodiscard]] SymbolState symbol_state(std::string_view symbol) const {
+        uint32_t id = state_ids_.find(symbol);
+        return id == SymbolTable::NOT_FOUND ? SymbolState::CONTINUOUS : symbol_states_[id];
+    }
+    // Bounds the idempotency store by entry count and age; clears it, so
+    // call before recover()
+    void set_idempotency_limits(size_t capacity, uint64_t ttl_ns) {
+        idempotency_ = IdempotencyStore(capacity, ttl_ns);
+    }
     bool recover();
     
     // Snapshot support
@@ -60,29 +147,130 @@ public:
     void replay_events(const std::vector<Event>& events);
 
     [[nodiscard]] OrderBook* get_book(const std::string& symbol);
+    // Untriggered stops for the symbol; nullptr if it never had any trade or stop
+    [[nodiscard]] const StopBook* get_stop_book(const std::string& symbol) const;
     [[nodiscard]] std::optional<Order> get_order(uint64_t order_id) const;
+    [[nodiscard]] std::optional<Order> get_order(const std::string& account_id,
+                                                 const std::string& client_order_id) const;
+    // The account's open orders, resting or untriggered stops, optionally in
+    // one symbol; O(k) in the account's open orders, in placement (id) order
+    [[nodiscard]] std::vector<Order> get_open_orders(const std::string& account_id,
+                                                     const std::string& symbol = "") const;
     [[nodiscard]] std::vector<Trade> get_trades(const std::string& symbol, size_t limit) const;
     [[nodiscard]] EngineStats get_stats() const;
+    [[nodiscard]] EventLog& event_log() { return event_log_; }
+
+    // Recompiles the risk table and rebuilds account exposure from the
+    // current orders and trades
+    void set_risk_limits(RiskLimits limits);
+    [[nodiscard]] const RiskChecker& risk_checker() const { return risk_checker_; }
+
+    // Per-stage timings; only populated when built with ENABLE_LATENCY_STATS
+    [[nodiscard]] LatencyRecorder& latency() { return latency_; }
+
+    // flush, if set, runs once at the end of each command that called the
+    // listener, so a writer can batch a command's changes into one write
+    void set_bbo_listener(BboListener listener, std::function<void()> flush = {}) {
+        bbo_listener_ = std::move(listener);
+        bbo_flush_ = std::move(flush);
+    }
+    // L3 feed for all current and future books; the engine does not own it
+    void set_market_data_feed(MarketDataFeed* feed);
+    [[nodiscard]] uint64_t market_data_sequence() const {
+        return feed_ ? feed_->current_sequence() : 0;
+    }
 
 private:
     std::unordered_map<std::string, std::unique_ptr<OrderBook>> books_;
     std::unordered_map<uint64_t, std::unique_ptr<Order>> orders_;
     std::vector<Trade> trades_;
-    std::unordered_set<std::string> idempotency_keys_;
+    // Positions and last trade prices as of the snapshot recovered from;
+    // trades_ only holds the trades since
+    Snapshot::Positions snapshot_positions_;
+    std::map<std::string, int64_t> snapshot_last_prices_;
+    IdempotencyStore idempotency_;
+    std::unordered_map<std::string, StopBook> stop_books_;
+    // Stops triggered during the current command, fired in this order
+    std::vector<Order*> triggered_stops_;
+    // Scratch for allocate_level, kept to avoid allocating per level
+    std::vector<Order*> level_orders_;
+    std::vector<int64_t> level_alloc_;
+    // Open orders (resting or untriggered stops) per account, so mass cancel
+    // and open order queries never scan other accounts
+    std::unordered_map<std::string, AccountOrders> account_orders_;
+    // Open orders with a client_order_id, per account: client id -> order id
+    std::unordered_map<std::string, std::unordered_map<std::string, uint64_t>> client_order_ids_;
+    std::unordered_set<std::string> blocked_accounts_;
+    // Trading phase per symbol, indexed by dense id
+    SymbolTable state_ids_;
+    std::vector<SymbolState> symbol_states_;
+    // Good-till-time deadlines of open orders, keyed by order id; entries for
+    // orders that closed first are skipped when they fire
+    TimerWheel expiries_;
+    std::vector<uint64_t> expired_;
 
     uint64_t next_order_id_ = 1;
     uint64_t next_trade_id_ = 1;
 
+    // Read once at the start of each command; stamps its orders, trades,
+    // events and feed messages
+    uint64_t command_ts_ = 0;
+    // Why match() stopped short of the order's limit: PRICE_OUT_OF_BAND for a
+    // market order at the collar, or the time-in-force check that refused it
+    ErrorCode match_stop_ = ErrorCode::NONE;
+
     EventLog event_log_;
     SnapshotManager snapshot_manager_;
     RiskChecker risk_checker_;
     
     // Statistics tracking
     EngineStats stats_;
+    LatencyRecorder latency_;
+
+    BboListener bbo_listener_;
+    std::function<void()> bbo_flush_;
+    bool bbo_published_ = false;  // by the current command
+    MarketDataFeed* feed_ = nullptr;
 
     std::vector<Trade> match(Order* incoming);
+    const Trade& record_trade(StopBook& stops, const std::string& symbol, Order* buy,
+                              Order* sell, int64_t price, int64_t qty,
+                              std::vector<Trade>& trades);
+    void fill(OrderBook& book, StopBook& stops, Order* incoming, Order* resting, int64_t qty,
+              std::vector<Trade>& trades);
+    int64_t allocate_level(OrderBook& book, StopBook& stops, const PriceLevel& level,
+                           Order* incoming, Allocation allocation, int64_t lot,
+                           size_t& skipped, std::vector<Trade>& trades);
+    void execute(Order* raw, PlaceOrderResult& r, SymbolState state = SymbolState::CONTINUOUS);
+    bool admit_time_in_force(OrderBook& book, Order* incoming, const PriceCollar& collar);
+    ErrorCode admit_replacement(const OrderBook& book, const Order& candidate) const;
+    void reject_placed(OrderBook& book, Order* raw, PlaceOrderResult& r, ErrorCode code);
+    void cancel_remainder(Order* raw);
+    void arm_stop(Order* raw, PlaceOrderResult& r, SymbolState state);
+    ErrorCode admit_state(const Order& order, SymbolState state) const;
+    void apply_symbol_state(const std::string& symbol, SymbolState state);
+    void uncross(OrderBook& book, SymbolStateResult& res);
+    void trigger_stop(Order* order);
+    void fire_stops();
+    bool prevent_self_trade(OrderBook& book, Order* incoming, Order* resting);
     OrderBook& get_or_create_book(const std::string& symbol);
-    void log_event(EventType type, const nlohmann::json& payload);
+    void begin_command();
+    void expire_orders();
+    template <typename Payload>
+    void log_event(EventType type, const Payload& payload);
+    void publish_bbo(OrderBook& book);
+    void rest_order(OrderBook& book, Order* order);
+    bool remove_resting(OrderBook& book, Order& order);
+    bool remove_open(Order& order);
+    void index_order(Order& order);
+    void unindex_order(Order& order);
+    [[nodiscard]] uint64_t find_client_order(const std::string& account_id,
+                                             const std::string& client_order_id) const;
+    void cache_response(const KeyFingerprint& key, const Order& order,
+                        const PlaceOrderResult& r);
+    void trade_totals(Snapshot::Positions& positions,
+                      std::map<std::string, int64_t>& last_prices) const;
+    void rebuild_resting_state();
 };
 
 }  // namespace exchange
\ No newline at end of file
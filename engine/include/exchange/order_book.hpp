@@ -1,5 +1,6 @@
 #pragma once
 
+#include <deque>
 #include <map>
 #include <optional>
 #include <string>
@@ -10,6 +11,26 @@
 
 namespace exchange {
 
+class MarketDataFeed;
+
+// Orders resting at one price, in time priority, with their cached totals.
+// total_qty counts displayed quantity only; iceberg reserves are kept apart.
+// A deque so a refilled iceberg moves from the front to the back in O(1).
+struct PriceLevel {
+    std::deque<Order*> orders;
+    int64_t total_qty = 0;
+    int64_t hidden_qty = 0;
+};
+
+// Where a crossed book uncrosses in a call auction: the price executing the
+// most volume, then leaving the smallest imbalance, then nearest the
+// reference price, then the lowest. Zero volume if the book is not crossed.
+struct AuctionPrice {
+    int64_t price = 0;
+    int64_t volume = 0;
+    int64_t imbalance = 0;  // bids minus asks that could trade at price
+};
+
 // Order book for a single symbol
 class OrderBook {
 public:
@@ -17,7 +38,12 @@ public:
 
     void add_order(Order* order);
     bool remove_order(uint64_t order_id);
+    // Applies a fill. An iceberg whose slice is used up shows the next one
+    // and goes to the back of its level.
     void update_order_qty(uint64_t order_id, int64_t new_remaining_qty);
+    // Shrinks a resting order in place, keeping its queue position; false if
+    // the order is not resting or new_remaining_qty is not a reduction
+    bool reduce_order_qty(uint64_t order_id, int64_t new_remaining_qty);
 
     [[nodiscard]] std::optional<int64_t> best_bid_price() const;
     [[nodiscard]] std::optional<int64_t> best_ask_price() const;
@@ -25,15 +51,44 @@ public:
     [[nodiscard]] std::vector<Order*> get_bids_at_best() const;
     [[nodiscard]] std::vector<Order*> get_asks_at_best() const;
 
+    // First level on side at price or further from the touch; nullptr if
+    // none. Never empty: levels are erased with their last order.
+    [[nodiscard]] const PriceLevel* level_from(Side side, int64_t price) const;
+
+    // Quantity an incoming order on taker_side could trade at prices up to
+    // (buy) or down to (sell) limit_price, hidden reserves included, summed
+    // from level totals and
+    // stopping once it reaches needed. With own_account set, levels are
+    // walked order by order and that account's orders are not counted: the
+    // count ends at the first one, or passes over them with pass_own.
+    [[nodiscard]] int64_t fillable_qty(Side taker_side, int64_t limit_price, int64_t needed,
+                                       const std::string* own_account = nullptr,
+                                       bool pass_own = false) const;
+
+    // One ascending sweep over the levels inside the cross, keeping running
+    // totals of asks at or below and bids at or above each price. Hidden
+    // iceberg reserves take part.
+    [[nodiscard]] AuctionPrice auction_price(int64_t reference_price = 0) const;
+
     [[nodiscard]] std::vector<Order*> get_all_bids() const;
     [[nodiscard]] std::vector<Order*> get_all_asks() const;
 
     [[nodiscard]] std::vector<BookLevel> get_bid_levels(size_t depth = 10) const;
     [[nodiscard]] std::vector<BookLevel> get_ask_levels(size_t depth = 10) const;
 
+    // Cached top of book, kept current on every add, fill and cancel
+    [[nodiscard]] const Bbo& bbo() const { return bbo_; }
+
+    // True if the top of book differs from the last call; marks it as seen
+    bool poll_bbo_change();
+
     [[nodiscard]] bool is_crossed() const;
     [[nodiscard]] Order* get_order(uint64_t order_id) const;
 
+    // Book mutations are published as L3 ADD/MODIFY/DELETE messages when set
+    void set_feed(MarketDataFeed* feed) { feed_ = feed; }
+    [[nodiscard]] MarketDataFeed* feed() const { return feed_; }
+
     [[nodiscard]] const std::string& symbol() const { return symbol_; }
     [[nodiscard]] size_t bid_count() const { return bid_orders_.size(); }
     [[nodiscard]] size_t ask_count() const { return ask_orders_.size(); }
@@ -41,13 +96,22 @@ public:
 private:
     std::string symbol_;
 
-    std::map<int64_t, std::vector<Order*>, std::greater<>> bids_;
-    std::map<int64_t, std::vector<Order*>, std::less<>> asks_;
+    std::map<int64_t, PriceLevel, std::greater<>> bids_;
+    std::map<int64_t, PriceLevel, std::less<>> asks_;
 
     std::unordered_map<uint64_t, Order*> bid_orders_;
     std::unordered_map<uint64_t, Order*> ask_orders_;
 
+    Bbo bbo_;
+    Bbo published_bbo_;
+
+    MarketDataFeed* feed_ = nullptr;
+
+    Order* erase_order(uint64_t order_id);
+    PriceLevel* find_level(const Order* order);
     void remove_from_price_level(Order* order);
+    void requeue(PriceLevel& level, Order* order);
+    void refresh_bbo(Side side);
 };
 
 }  // namespace exchange
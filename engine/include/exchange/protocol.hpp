@@ -11,8 +11,12 @@ public:
     explicit ProtocolHandler(MatchingEngine& engine);
     [[nodiscard]] std::string handle(const std::string& json);
 
+    // Set once a shutdown/exit/quit command has been handled
+    [[nodiscard]] bool shutdown_requested() const { return shutdown_requested_; }
+
 private:
     MatchingEngine& engine_;
+    bool shutdown_requested_ = false;
 };
 
 }  // namespace exchange
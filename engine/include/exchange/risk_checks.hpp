@@ -1,28 +1,205 @@
 #pragma once
 
+#include <optional>
+
+#include "exchange/symbol_table.hpp"
 #include "exchange/types.hpp"
 
 namespace exchange {
 
+// Per-symbol trading rules, all in fixed-point units. Zero means "use the
+// global limit" for max_qty and max_notional and "unbounded" for the band.
+struct SymbolRiskConfig {
+    std::string symbol;
+    int64_t tick_size = 1;     // limit prices must be a multiple
+    int64_t lot_size = 1;      // quantities must be a multiple
+    int64_t min_qty = 1;
+    int64_t max_qty = 0;
+    int64_t min_price = 0;     // limit price band
+    int64_t max_price = 0;
+    int64_t max_notional = 0;
+    int64_t price_band_bps = 0;  // collar around the reference price
+    Allocation allocation = Allocation::FIFO;
+};
+
+void to_json(nlohmann::json& j, const SymbolRiskConfig& c);
+void from_json(const nlohmann::json& j, SymbolRiskConfig& c);
+
+// Per-account exposure limits. Zero means "use the global limit".
+struct AccountRiskConfig {
+    std::string account;
+    int64_t max_open_orders = 0;
+    int64_t max_open_notional = 0;
+    int64_t max_position = 0;
+};
+
+void to_json(nlohmann::json& j, const AccountRiskConfig& c);
+void from_json(const nlohmann::json& j, AccountRiskConfig& c);
+
 struct RiskLimits {
     int64_t max_order_size = 1000 * PRICE_SCALE;
     int64_t max_notional = 10000000 * PRICE_SCALE;
     std::vector<std::string> allowed_symbols = {"BTC-USD", "ETH-USD"};
+    // Overrides for individual symbols; listed symbols are allowed too
+    std::vector<SymbolRiskConfig> symbols;
+
+    // Fat-finger collar: limit prices more than this many basis points from
+    // the symbol's reference price (last trade, else book mid) are rejected
+    // and market orders stop sweeping at the same bound. 0 = off.
+    int64_t price_band_bps = 0;
+
+    // Exposure limits for every account, 0 = unlimited. Open orders and
+    // notional count resting limit orders and parked stops; the position
+    // limit bounds the net position per symbol if every open order on that
+    // side filled.
+    int64_t max_open_orders = 0;
+    int64_t max_open_notional = 0;
+    int64_t max_position = 0;
+    std::vector<AccountRiskConfig> accounts;
+};
+
+void to_json(nlohmann::json& j, const RiskLimits& l);
+void from_json(const nlohmann::json& j, RiskLimits& l);
+
+// Reads RiskLimits from a JSON file; nullopt if missing or malformed, or if
+// a symbol is longer than MAX_SYMBOL_LEN. A "symbols" list without
+// "allowed_symbols" defines the whole symbol set.
+[[nodiscard]] std::optional<RiskLimits> load_risk_config(const std::string& path);
+
+// Exact price * quantity products and their sums
+struct UInt128 {
+    uint64_t hi = 0;
+    uint64_t lo = 0;
+};
+
+// Full 64x64 -> 128-bit product
+[[nodiscard]] UInt128 mul_u64(uint64_t a, uint64_t b);
+// Quotient of v / d, saturating at INT64_MAX
+[[nodiscard]] int64_t div_u64(UInt128 v, uint64_t d);
+
+// RiskLimits compiled for one symbol: fallbacks resolved and the notional
+// limit pre-multiplied by PRICE_SCALE so the check is one 128-bit compare
+struct SymbolLimits {
+    int64_t tick_size = 1;
+    int64_t lot_size = 1;
+    int64_t min_qty = 1;
+    int64_t max_qty = 0;
+    int64_t min_price = 1;
+    int64_t max_price = 0;
+    UInt128 max_notional;  // price * qty must not exceed this
+    int64_t price_band_bps = 0;
+    Allocation allocation = Allocation::FIFO;
+};
+
+// Prices an order may trade at right now, inclusive
+struct PriceCollar {
+    int64_t lo = 0;
+    int64_t hi = INT64_MAX;
+};
+
+// An account's current exposure, as tracked by the RiskChecker
+struct AccountExposure {
+    int64_t open_orders = 0;
+    int64_t open_notional = 0;  // sum of price * remaining / PRICE_SCALE
+    int64_t position = 0;       // net filled quantity in the symbol, buys positive
+    int64_t open_buy_qty = 0;
+    int64_t open_sell_qty = 0;
 };
 
+void to_json(nlohmann::json& j, const AccountExposure& e);
+
 struct RiskCheckResult {
     bool passed = true;
     ErrorCode error_code = ErrorCode::NONE;
 };
 
+// Symbols are resolved to a dense id through a flat hash table and every
+// rule is evaluated unconditionally into one failure mask, so a passing
+// order costs one hash, one table probe and a handful of compares with no
+// allocation. Only a failing order pays to work out which rule it broke.
+//
+// Account exposure lives in flat arrays indexed by a dense account id (and
+// account id * symbol count + symbol id for positions). The engine keeps it
+// current through the on_* hooks, each an O(1) update.
 class RiskChecker {
 public:
     explicit RiskChecker(RiskLimits limits = {});
     [[nodiscard]] RiskCheckResult check_order(const Order& order) const;
+    // Only the size, minimum and lot rules, for amendments that reduce an
+    // order and so cannot add exposure
+    [[nodiscard]] RiskCheckResult check_quantity(const Order& order) const;
     [[nodiscard]] bool is_valid_symbol(const std::string& symbol) const;
 
+    // A limit order started resting with its remaining quantity
+    void on_rest(const Order& order);
+    // qty of a resting order left the book (filled or cancelled); call
+    // before the order's remaining_qty is reduced
+    void on_unrest(const Order& order, int64_t qty);
+    // Moves both sides' positions and the symbol's reference price
+    void on_trade(const Trade& trade);
+    // Book mid, the reference price until the symbol first trades
+    void on_bbo(std::string_view symbol, const Bbo& bbo);
+    // Restore what on_trade would have built from trades that are no longer
+    // kept, e.g. those before a snapshot
+    void add_position(const std::string& account, std::string_view symbol, int64_t qty);
+    void set_last_trade(std::string_view symbol, int64_t price);
+    // Forgets all exposure and reference prices, e.g. before rebuilding
+    // them after recovery
+    void reset_exposure();
+
+    // Collar for the symbol; unbounded without a band or reference price
+    [[nodiscard]] PriceCollar collar(std::string_view symbol) const;
+    [[nodiscard]] int64_t reference_price(std::string_view symbol) const;
+
+    [[nodiscard]] AccountExposure exposure(std::string_view account,
+                                           std::string_view symbol) const;
+
+    // Dense id of an allowed symbol, SymbolTable::NOT_FOUND otherwise
+    [[nodiscard]] uint32_t symbol_id(std::string_view symbol) const {
+        return symbols_.find(symbol);
+    }
+    [[nodiscard]] const SymbolTable& symbols() const { return symbols_; }
+    [[nodiscard]] const SymbolLimits& symbol_limits(uint32_t id) const { return table_[id]; }
+    [[nodiscard]] const RiskLimits& limits() const { return limits_; }
+
 private:
+    // Compiled account limits plus the account's running totals
+    struct AccountState {
+        int64_t max_open_orders = 0;
+        int64_t max_position = 0;
+        UInt128 max_open_notional;  // already multiplied by PRICE_SCALE
+        int64_t open_orders = 0;
+        UInt128 open_notional;      // sum of price * remaining
+    };
+
+    struct PositionState {
+        int64_t position = 0;
+        int64_t open_buy = 0;
+        int64_t open_sell = 0;
+    };
+
+    // Kept per symbol so the collar check is two compares
+    struct ReferenceState {
+        int64_t last_trade = 0;
+        int64_t mid = 0;
+        PriceCollar collar;
+    };
+
     RiskLimits limits_;
+    SymbolTable symbols_;
+    std::vector<SymbolLimits> table_;  // indexed by symbol id
+    std::vector<ReferenceState> references_;  // indexed by symbol id
+
+    SymbolTable accounts_;
+    std::vector<AccountState> account_state_;  // indexed by account id
+    std::vector<PositionState> positions_;     // account id * symbols + symbol id
+    AccountState default_account_;             // limits for accounts not seen yet
+
+    static AccountState compile_account(const AccountRiskConfig& c, const RiskLimits& global);
+    uint32_t account_id(const std::string& account);
+    PositionState* position(uint32_t account, uint32_t symbol);
+    void update_collar(uint32_t symbol);
+    [[nodiscard]] ErrorCode classify(const Order& order, const SymbolLimits* s) const;
 };
 
 }  // namespace exchange
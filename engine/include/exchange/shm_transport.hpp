@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace exchange {
+
+// Request/response transport over a pair of SPSC byte rings in one POSIX
+// shared-memory object (/dev/shm/<name>). The engine creates the object; the
+// client (api/app/shm_transport.py) maps it and must follow the same layout:
+//
+//   0    u64 magic, u32 version, u32 ring_bytes, u32 client_closed
+//   64   request ring header, then ring_bytes of data  (client -> engine)
+//   ...  response ring header, then ring_bytes of data (engine -> client)
+//
+// A ring header is head (u64, +0), tail (u64, +64), futex word seq (u32,
+// +128) and waiting flag (u32, +132); data starts at +192. Each message is a
+// u32 length followed by its bytes, wrapping at the ring end. Readers spin
+// briefly and then sleep on the futex; writers only wake when a reader has
+// set its waiting flag. Linux only.
+class ShmTransport {
+public:
+    static constexpr uint64_t MAGIC = 0x31304D4853545A41ULL;  // "AZTSHM01"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t DEFAULT_RING_BYTES = 1 << 20;
+
+    explicit ShmTransport(std::string name, uint32_t ring_bytes = DEFAULT_RING_BYTES);
+    ~ShmTransport();
+
+    ShmTransport(const ShmTransport&) = delete;
+    ShmTransport& operator=(const ShmTransport&) = delete;
+
+    // Create and map the shared object; clients may attach once this returns
+    bool create();
+
+    // Blocks until a request arrives. Returns false once the client has
+    // closed its side and the ring is drained, or when the request ring holds
+    // a length that does not fit in it; the client is then treated as gone.
+    bool receive(std::string& out);
+    bool send(const std::string& message);
+
+private:
+    std::string name_;
+    uint32_t ring_bytes_;
+    size_t map_size_ = 0;
+    void* base_ = nullptr;
+};
+
+}  // namespace exchange
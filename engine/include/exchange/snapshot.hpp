@@ -1,19 +1,31 @@
 #pragma once
 
+#include <deque>
+#include <map>
 #include <optional>
 #include <string>
 #include <vector>
 
+#include "exchange/idempotency_store.hpp"
 #include "exchange/types.hpp"
 
 namespace exchange {
 
 struct Snapshot {
+    using Positions = std::map<std::string, std::map<std::string, int64_t>>;
+
     uint64_t sequence = 0;
     uint64_t timestamp_ns = 0;
     uint64_t next_order_id = 1;
     uint64_t next_trade_id = 1;
     std::vector<Order> orders;
+    std::vector<std::string> blocked_accounts;
+    std::map<std::string, SymbolState> symbol_states;
+    // The trades are not kept, so what risk derives from them is: net
+    // position by account then symbol, and each symbol's last trade price
+    Positions positions;
+    std::map<std::string, int64_t> last_trade_prices;
+    std::deque<IdempotencyStore::Entry> idempotency_keys;  // oldest first
 };
 
 void to_json(nlohmann::json& j, const Snapshot& s);
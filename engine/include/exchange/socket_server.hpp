@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "exchange/protocol.hpp"
+
+namespace exchange {
+
+struct SocketServerStats {
+    uint64_t connections_accepted = 0;
+    uint64_t requests = 0;
+    uint64_t wait_syscalls = 0;
+    uint64_t read_syscalls = 0;
+    uint64_t write_syscalls = 0;
+};
+
+// Serves the line-delimited JSON protocol to many clients on a UNIX domain
+// socket. One epoll loop multiplexes every connection into the single
+// matching thread; each connection has its own input/output buffers, so
+// requests on one connection are answered in order on that connection.
+// Request lines are bounded in length, reading pauses while a connection has
+// too many unread responses, and a client that closes its side still gets
+// every response it asked for. Linux only.
+class SocketServer {
+public:
+    SocketServer(ProtocolHandler& handler, std::string path);
+    ~SocketServer();
+
+    SocketServer(const SocketServer&) = delete;
+    SocketServer& operator=(const SocketServer&) = delete;
+
+    bool listen();
+    // Runs until a shutdown command is handled
+    void run();
+
+    [[nodiscard]] const SocketServerStats& stats() const { return stats_; }
+
+private:
+    struct Connection {
+        std::string in;
+        std::string out;
+        uint32_t events = 0;  // epoll interest currently registered
+        bool peer_closed = false;
+    };
+
+    ProtocolHandler& handler_;
+    std::string path_;
+    int listen_fd_ = -1;
+    int epoll_fd_ = -1;
+    std::unordered_map<int, Connection> connections_;
+    SocketServerStats stats_;
+
+    void accept_clients();
+    // These return false if the connection should be closed
+    bool on_readable(int fd, Connection& conn);
+    // Answers buffered requests, flushes and re-arms epoll for the connection
+    bool serve(int fd, Connection& conn);
+    // False if a request line has grown past the length limit
+    bool handle_lines(Connection& conn);
+    bool flush(int fd, Connection& conn);
+    void update_events(int fd, Connection& conn);
+    void close_connection(int fd);
+};
+
+}  // namespace exchange
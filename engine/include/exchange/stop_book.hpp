@@ -0,0 +1,40 @@
+#pragma once
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "exchange/types.hpp"
+
+namespace exchange {
+
+// Untriggered stop and stop-limit orders for one symbol, keyed by stop
+// price. Buy stops fire when a trade prints at or above their stop price,
+// sell stops at or below, so each side is ordered with the next stop to fire
+// first and a trade only touches the stops it triggers.
+class StopBook {
+public:
+    void add(Order* order);
+    bool remove(uint64_t order_id);
+
+    // Moves every stop a trade at price triggers to out, in firing order:
+    // nearest stop price first, then time priority. O(log n + k).
+    void trigger(int64_t price, std::vector<Order*>& out);
+
+    // Whether a new stop is already through the last trade price, 0 if none
+    [[nodiscard]] bool is_triggered(const Order& order) const;
+    [[nodiscard]] int64_t last_price() const { return last_price_; }
+    void set_last_price(int64_t price) { last_price_ = price; }
+
+    [[nodiscard]] std::vector<Order*> get_all() const;
+    [[nodiscard]] size_t size() const { return orders_.size(); }
+    [[nodiscard]] bool empty() const { return orders_.empty(); }
+
+private:
+    std::map<int64_t, std::vector<Order*>, std::less<>> buys_;
+    std::map<int64_t, std::vector<Order*>, std::greater<>> sells_;
+    std::unordered_map<uint64_t, Order*> orders_;
+    int64_t last_price_ = 0;
+};
+
+}  // namespace exchange
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace exchange {
+
+// Maps names (symbols, accounts) to dense ids [0, size()) so per-name state
+// can live in flat arrays. Lookups hash the name once and probe an
+// open-addressed power-of-two table, with no allocation.
+class SymbolTable {
+public:
+    static constexpr uint32_t NOT_FOUND = UINT32_MAX;
+
+    // Id of the symbol, adding it if new
+    uint32_t add(const std::string& symbol) {
+        uint32_t existing = find(symbol);
+        if (existing != NOT_FOUND) return existing;
+
+        auto id = static_cast<uint32_t>(names_.size());
+        names_.push_back(symbol);
+        if (names_.size() * 2 > slots_.size()) {
+            rehash(slots_.empty() ? 16 : slots_.size() * 2);
+        } else {
+            insert(hash(symbol), id);
+        }
+        return id;
+    }
+
+    [[nodiscard]] uint32_t find(std::string_view symbol) const {
+        if (slots_.empty()) return NOT_FOUND;
+        uint64_t h = hash(symbol);
+        for (size_t i = h & mask_;; i = (i + 1) & mask_) {
+            const Slot& s = slots_[i];
+            if (s.id == NOT_FOUND) return NOT_FOUND;
+            if (s.hash == h && names_[s.id] == symbol) return s.id;
+        }
+    }
+
+    [[nodiscard]] const std::string& name(uint32_t id) const { return names_[id]; }
+    [[nodiscard]] size_t size() const { return names_.size(); }
+    [[nodiscard]] const std::vector<std::string>& names() const { return names_; }
+
+private:
+    struct Slot {
+        uint64_t hash = 0;
+        uint32_t id = NOT_FOUND;
+    };
+
+    std::vector<std::string> names_;
+    std::vector<Slot> slots_;
+    size_t mask_ = 0;
+
+    // FNV-1a
+    static uint64_t hash(std::string_view s) {
+        uint64_t h = 14695981039346656037ull;
+        for (char c : s) {
+            h ^= static_cast<uint8_t>(c);
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    void insert(uint64_t h, uint32_t id) {
+        size_t i = h & mask_;
+        while (slots_[i].id != NOT_FOUND) i = (i + 1) & mask_;
+        slots_[i] = {h, id};
+    }
+
+    void rehash(size_t capacity) {
+        slots_.assign(capacity, Slot{});
+        mask_ = capacity - 1;
+        for (uint32_t id = 0; id < names_.size(); ++id) insert(hash(names_[id]), id);
+    }
+};
+
+}  // namespace exchange
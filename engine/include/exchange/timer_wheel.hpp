@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace exchange {
+
+// Hierarchical timer wheel keyed by deadline in nanoseconds. Level L has 64
+// slots of 64^L ticks each; a timer sits at the lowest level whose window
+// still holds both the current tick and its deadline, and drops down a level
+// each time the wheel reaches its slot. Per-level occupancy bitmaps let
+// advance() jump straight to the next occupied slot, so its cost is O(levels)
+// per slot visited plus the timers it touches, however much time has passed.
+//
+// Timers cannot be cancelled; the owner checks what fires against its own
+// state and ignores timers that no longer apply.
+class TimerWheel {
+public:
+    explicit TimerWheel(uint64_t tick_ns = 1000000) : tick_ns_(tick_ns) {}
+
+    void schedule(uint64_t id, uint64_t deadline_ns);
+
+    // Appends the ids of timers due by now_ns. A timer never fires before its
+    // deadline and at most one tick after it.
+    void advance(uint64_t now_ns, std::vector<uint64_t>& out);
+
+    void clear();
+    [[nodiscard]] size_t size() const { return size_; }
+    [[nodiscard]] bool empty() const { return size_ == 0; }
+
+private:
+    static constexpr int LEVELS = 8;
+    static constexpr int SLOT_BITS = 6;
+    static constexpr uint64_t SLOT_MASK = 63;
+
+    struct Timer {
+        uint64_t id;
+        uint64_t tick;  // deadline rounded up to a whole tick
+    };
+
+    uint64_t tick_ns_;
+    uint64_t now_tick_ = 0;
+    size_t size_ = 0;
+    std::array<std::array<std::vector<Timer>, 64>, LEVELS> slots_;
+    std::array<uint64_t, LEVELS> occupied_{};  // bit s set if slot s holds timers
+    std::vector<Timer> due_;                    // deadline already reached when scheduled
+
+    void insert(const Timer& t);
+};
+
+}  // namespace exchange
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#endif
+
+namespace exchange {
+
+// Raw CPU timestamp counter: a few cycles to read, no syscall. Falls back to
+// steady_clock nanoseconds where no user-readable counter exists.
+inline uint64_t rdtsc() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t v;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+#endif
+}
+
+// Nanoseconds per rdtsc() tick, measured against steady_clock on first use
+// (~10ms) and cached for the life of the process
+[[nodiscard]] double tsc_ns_per_tick();
+
+}  // namespace exchange
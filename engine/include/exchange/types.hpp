@@ -1,6 +1,8 @@
 #pragma once
 
+#include <algorithm>
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <unordered_map>
@@ -12,10 +14,49 @@ namespace exchange {
 
 // Fixed-point scale: 1e8 units = 1.0
 constexpr int64_t PRICE_SCALE = 100000000;
+// Longest tradable symbol; the L3 feed carries symbols in a fixed field
+constexpr size_t MAX_SYMBOL_LEN = 13;
 
-enum class Side { BUY, SELL };
-enum class OrderType { LIMIT, MARKET };
-enum class OrderStatus { NEW, PARTIAL, FILLED, CANCELLED, REJECTED };
+enum class Side : uint8_t { BUY, SELL };
+// STOP and STOP_LIMIT wait off the book until a trade reaches stop_price,
+// then become MARKET and LIMIT orders respectively
+enum class OrderType { LIMIT, MARKET, STOP, STOP_LIMIT };
+// EXPIRED orders reached their expire_ts_ns while still open
+enum class OrderStatus { NEW, PARTIAL, FILLED, CANCELLED, REJECTED, EXPIRED };
+
+// GTC rests whatever does not match. IOC cancels the unmatched remainder and
+// FOK trades its whole quantity or nothing. POST_ONLY is rejected if it would
+// take liquidity; POST_ONLY_SLIDE is repriced one tick behind the opposite
+// touch instead. Market orders never rest, whatever their time in force.
+enum class TimeInForce { GTC, IOC, FOK, POST_ONLY, POST_ONLY_SLIDE };
+
+// What happens when an incoming order reaches a resting order from the same
+// account; the incoming order's mode decides. CANCEL_INCOMING stops matching
+// and cancels the incoming remainder, CANCEL_RESTING cancels the resting
+// order and carries on, CANCEL_BOTH does both. DECREMENT_AND_CANCEL takes the
+// smaller quantity off both without a trade, cancelling whichever reaches
+// zero, and SKIP passes over the resting order to liquidity behind it.
+enum class SelfTradePrevention {
+    CANCEL_INCOMING,
+    CANCEL_RESTING,
+    CANCEL_BOTH,
+    DECREMENT_AND_CANCEL,
+    SKIP
+};
+constexpr size_t SELF_TRADE_PREVENTION_MODES = 5;
+
+// How a symbol shares an incoming order among the resting orders at one
+// price. FIFO fills them in time priority. PRO_RATA splits the incoming
+// quantity in proportion to displayed size, rounded down to the lot, and
+// hands out what rounding leaves in time priority. FIFO_PRO_RATA fills the
+// order at the front of the level first, then the rest pro rata.
+enum class Allocation { FIFO, PRO_RATA, FIFO_PRO_RATA };
+
+// Trading phase of a symbol. CONTINUOUS matches as orders arrive. PRE_OPEN
+// and AUCTION take resting orders without matching until the symbol moves to
+// CONTINUOUS, which uncrosses the book. HALTED and CLOSED take no new orders
+// or amendments; cancels still work.
+enum class SymbolState { PRE_OPEN, CONTINUOUS, AUCTION, HALTED, CLOSED };
 
 NLOHMANN_JSON_SERIALIZE_ENUM(Side, {
     {Side::BUY, "BUY"}, 
@@ -24,7 +65,9 @@ NLOHMANN_JSON_SERIALIZE_ENUM(Side, {
 
 NLOHMANN_JSON_SERIALIZE_ENUM(OrderType, {
     {OrderType::LIMIT, "LIMIT"}, 
-    {OrderType::MARKET, "MARKET"}
+    {OrderType::MARKET, "MARKET"},
+    {OrderType::STOP, "STOP"},
+    {OrderType::STOP_LIMIT, "STOP_LIMIT"}
 })
 
 NLOHMANN_JSON_SERIALIZE_ENUM(OrderStatus, {
@@ -32,7 +75,38 @@ NLOHMANN_JSON_SERIALIZE_ENUM(OrderStatus, {
     {OrderStatus::PARTIAL, "PARTIAL"},
     {OrderStatus::FILLED, "FILLED"},
     {OrderStatus::CANCELLED, "CANCELLED"},
-    {OrderStatus::REJECTED, "REJECTED"}
+    {OrderStatus::REJECTED, "REJECTED"},
+    {OrderStatus::EXPIRED, "EXPIRED"}
+})
+
+NLOHMANN_JSON_SERIALIZE_ENUM(TimeInForce, {
+    {TimeInForce::GTC, "GTC"},
+    {TimeInForce::IOC, "IOC"},
+    {TimeInForce::FOK, "FOK"},
+    {TimeInForce::POST_ONLY, "POST_ONLY"},
+    {TimeInForce::POST_ONLY_SLIDE, "POST_ONLY_SLIDE"}
+})
+
+NLOHMANN_JSON_SERIALIZE_ENUM(SelfTradePrevention, {
+    {SelfTradePrevention::CANCEL_INCOMING, "CANCEL_INCOMING"},
+    {SelfTradePrevention::CANCEL_RESTING, "CANCEL_RESTING"},
+    {SelfTradePrevention::CANCEL_BOTH, "CANCEL_BOTH"},
+    {SelfTradePrevention::DECREMENT_AND_CANCEL, "DECREMENT_AND_CANCEL"},
+    {SelfTradePrevention::SKIP, "SKIP"}
+})
+
+NLOHMANN_JSON_SERIALIZE_ENUM(SymbolState, {
+    {SymbolState::PRE_OPEN, "PRE_OPEN"},
+    {SymbolState::CONTINUOUS, "CONTINUOUS"},
+    {SymbolState::AUCTION, "AUCTION"},
+    {SymbolState::HALTED, "HALTED"},
+    {SymbolState::CLOSED, "CLOSED"}
+})
+
+NLOHMANN_JSON_SERIALIZE_ENUM(Allocation, {
+    {Allocation::FIFO, "FIFO"},
+    {Allocation::PRO_RATA, "PRO_RATA"},
+    {Allocation::FIFO_PRO_RATA, "FIFO_PRO_RATA"}
 })
 
 struct Order {
@@ -41,13 +115,22 @@ struct Order {
     std::string symbol;
     Side side = Side::BUY;
     OrderType type = OrderType::LIMIT;
+    TimeInForce time_in_force = TimeInForce::GTC;
+    SelfTradePrevention self_trade_prevention = SelfTradePrevention::CANCEL_INCOMING;
     int64_t price = 0;           // In fixed-point units
+    int64_t stop_price = 0;      // Trigger price for stop orders
+    int64_t display_qty = 0;     // Iceberg peak size; 0 shows the whole order
+    int64_t visible_qty = 0;     // Iceberg slice currently displayed
     int64_t quantity = 0;        // Original quantity
     int64_t remaining_qty = 0;   // Unfilled quantity
     uint64_t timestamp_ns = 0;
+    uint64_t expire_ts_ns = 0;   // Good-till-time deadline; 0 never expires
     OrderStatus status = OrderStatus::NEW;
     std::string idempotency_key;
     std::string client_order_id;
+    // Links in the engine's per-account list of open orders; not serialized
+    Order* account_prev = nullptr;
+    Order* account_next = nullptr;
 
     [[nodiscard]] bool is_active() const {
         return status == OrderStatus::NEW || status == OrderStatus::PARTIAL;
@@ -56,6 +139,43 @@ struct Order {
     [[nodiscard]] int64_t filled_qty() const { 
         return quantity - remaining_qty; 
     }
+
+    // Quantity the book shows: the current slice of an iceberg
+    [[nodiscard]] int64_t shown_qty() const {
+        return display_qty > 0 ? visible_qty : remaining_qty;
+    }
+
+    // Shows a fresh iceberg slice, e.g. when the order (re)enters the book
+    void reset_display() {
+        if (display_qty > 0) visible_qty = std::min(display_qty, remaining_qty);
+    }
+
+    // Fills qty. An iceberg spends its slice first and, once the slice is
+    // used up, shows the next one from the reserve; true if it did. Live
+    // matching and replay both go through here so slices come out the same.
+    bool consume(int64_t qty) {
+        remaining_qty -= qty;
+        if (display_qty <= 0) return false;
+        visible_qty -= qty;
+        if (visible_qty > 0) return false;
+        visible_qty = std::min(display_qty, remaining_qty);
+        return visible_qty > 0;
+    }
+
+    // Cuts the remaining quantity without a fill, keeping the current slice
+    void shrink(int64_t new_remaining_qty) {
+        remaining_qty = new_remaining_qty;
+        if (display_qty > 0) visible_qty = std::min(visible_qty, remaining_qty);
+    }
+
+    [[nodiscard]] bool is_stop() const {
+        return type == OrderType::STOP || type == OrderType::STOP_LIMIT;
+    }
+
+    [[nodiscard]] bool is_post_only() const {
+        return time_in_force == TimeInForce::POST_ONLY ||
+               time_in_force == TimeInForce::POST_ONLY_SLIDE;
+    }
 };
 
 void to_json(nlohmann::json& j, const Order& o);
@@ -89,7 +209,16 @@ enum class EventType {
     ORDER_CANCELLED,
     ORDER_REJECTED,
     TRADE_EXECUTED,
-    SNAPSHOT_MARKER
+    SNAPSHOT_MARKER,
+    MASS_CANCEL,
+    ACCOUNT_UNBLOCKED,
+    ORDER_MODIFIED,
+    SELF_TRADE_PREVENTED,
+    STOP_TRIGGERED,
+    SYMBOL_STATE_CHANGED,
+    AUCTION_UNCROSSED,
+    ORDERS_EXPIRED,
+    RESPONSE_CACHED
 };
 
 NLOHMANN_JSON_SERIALIZE_ENUM(EventType, {
@@ -97,7 +226,16 @@ NLOHMANN_JSON_SERIALIZE_ENUM(EventType, {
     {EventType::ORDER_CANCELLED, "ORDER_CANCELLED"},
     {EventType::ORDER_REJECTED, "ORDER_REJECTED"},
     {EventType::TRADE_EXECUTED, "TRADE_EXECUTED"},
-    {EventType::SNAPSHOT_MARKER, "SNAPSHOT_MARKER"}
+    {EventType::SNAPSHOT_MARKER, "SNAPSHOT_MARKER"},
+    {EventType::MASS_CANCEL, "MASS_CANCEL"},
+    {EventType::ACCOUNT_UNBLOCKED, "ACCOUNT_UNBLOCKED"},
+    {EventType::ORDER_MODIFIED, "ORDER_MODIFIED"},
+    {EventType::SELF_TRADE_PREVENTED, "SELF_TRADE_PREVENTED"},
+    {EventType::STOP_TRIGGERED, "STOP_TRIGGERED"},
+    {EventType::SYMBOL_STATE_CHANGED, "SYMBOL_STATE_CHANGED"},
+    {EventType::AUCTION_UNCROSSED, "AUCTION_UNCROSSED"},
+    {EventType::ORDERS_EXPIRED, "ORDERS_EXPIRED"},
+    {EventType::RESPONSE_CACHED, "RESPONSE_CACHED"}
 })
 
 struct Event {
@@ -125,6 +263,21 @@ enum class ErrorCode {
     SELF_TRADE_PREVENTED,
     NO_LIQUIDITY,
     DUPLICATE_IDEMPOTENCY_KEY,
+    INVALID_TICK_SIZE,
+    INVALID_LOT_SIZE,
+    PRICE_OUT_OF_BAND,
+    MAX_OPEN_ORDERS_EXCEEDED,
+    MAX_OPEN_NOTIONAL_EXCEEDED,
+    MAX_POSITION_EXCEEDED,
+    ACCOUNT_BLOCKED,
+    FOK_NOT_FILLABLE,
+    POST_ONLY_WOULD_CROSS,
+    SYMBOL_IN_AUCTION,
+    SYMBOL_HALTED,
+    SYMBOL_CLOSED,
+    INVALID_STATE_TRANSITION,
+    INVALID_EXPIRY,
+    DUPLICATE_CLIENT_ORDER_ID,
     INTERNAL_ERROR
 };
 
@@ -142,13 +295,30 @@ NLOHMANN_JSON_SERIALIZE_ENUM(ErrorCode, {
     {ErrorCode::SELF_TRADE_PREVENTED, "SELF_TRADE_PREVENTED"},
     {ErrorCode::NO_LIQUIDITY, "NO_LIQUIDITY"},
     {ErrorCode::DUPLICATE_IDEMPOTENCY_KEY, "DUPLICATE_IDEMPOTENCY_KEY"},
+    {ErrorCode::INVALID_TICK_SIZE, "INVALID_TICK_SIZE"},
+    {ErrorCode::INVALID_LOT_SIZE, "INVALID_LOT_SIZE"},
+    {ErrorCode::PRICE_OUT_OF_BAND, "PRICE_OUT_OF_BAND"},
+    {ErrorCode::MAX_OPEN_ORDERS_EXCEEDED, "MAX_OPEN_ORDERS_EXCEEDED"},
+    {ErrorCode::MAX_OPEN_NOTIONAL_EXCEEDED, "MAX_OPEN_NOTIONAL_EXCEEDED"},
+    {ErrorCode::MAX_POSITION_EXCEEDED, "MAX_POSITION_EXCEEDED"},
+    {ErrorCode::ACCOUNT_BLOCKED, "ACCOUNT_BLOCKED"},
+    {ErrorCode::FOK_NOT_FILLABLE, "FOK_NOT_FILLABLE"},
+    {ErrorCode::POST_ONLY_WOULD_CROSS, "POST_ONLY_WOULD_CROSS"},
+    {ErrorCode::SYMBOL_IN_AUCTION, "SYMBOL_IN_AUCTION"},
+    {ErrorCode::SYMBOL_HALTED, "SYMBOL_HALTED"},
+    {ErrorCode::SYMBOL_CLOSED, "SYMBOL_CLOSED"},
+    {ErrorCode::INVALID_STATE_TRANSITION, "INVALID_STATE_TRANSITION"},
+    {ErrorCode::INVALID_EXPIRY, "INVALID_EXPIRY"},
+    {ErrorCode::DUPLICATE_CLIENT_ORDER_ID, "DUPLICATE_CLIENT_ORDER_ID"},
     {ErrorCode::INTERNAL_ERROR, "INTERNAL_ERROR"}
 })
 
 // Get human-readable error message
 [[nodiscard]] std::string error_message(ErrorCode code);
 
-// Utility: current timestamp in nanoseconds
+// Utility: current wall-clock timestamp in nanoseconds (TscClock, monotonic).
+// The engine reads it once per command and reuses it for everything that
+// command produces.
 [[nodiscard]] uint64_t now_ns();
 
 // Book level for order book snapshots
@@ -160,4 +330,22 @@ struct BookLevel {
 
 void to_json(nlohmann::json& j, const BookLevel& l);
 
+// Best bid/offer for one book. An empty side has order_count == 0.
+struct Bbo {
+    BookLevel bid;
+    BookLevel ask;
+
+    [[nodiscard]] bool has_bid() const { return bid.order_count > 0; }
+    [[nodiscard]] bool has_ask() const { return ask.order_count > 0; }
+
+    bool operator==(const Bbo& other) const {
+        return bid.price == other.bid.price && bid.quantity == other.bid.quantity &&
+               bid.order_count == other.bid.order_count && ask.price == other.ask.price &&
+               ask.quantity == other.ask.quantity && ask.order_count == other.ask.order_count;
+    }
+    bool operator!=(const Bbo& other) const { return !(*this == other); }
+};
+
+void to_json(nlohmann::json& j, const Bbo& b);
+
 }  // namespace exchange
\ No newline at end of file
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "exchange/types.hpp"
+
+namespace exchange {
+
+class MatchingEngine;
+
+// Shape of the synthetic order flow. Prices follow a per-symbol mid doing a
+// random walk in ticks; passive orders land a geometric number of ticks
+// behind the touch, so depth clusters near the top of book.
+struct WorkloadConfig {
+    uint64_t seed = 1;
+    std::vector<std::string> symbols = {"BTC-USD", "ETH-USD"};  // at most 256
+    std::vector<double> symbol_weights;  // relative flow per symbol; empty = equal
+    int64_t start_price = 10000 * PRICE_SCALE;
+    int64_t tick = PRICE_SCALE / 100;
+    uint32_t accounts = 100;
+
+    double cancel_ratio = 0.35;      // share of ops cancelling a live order
+    double replace_ratio = 0.10;     // share of ops moving a live order
+    double market_ratio = 0.02;      // share of new orders that are market sweeps
+    double aggressive_ratio = 0.10;  // share of limit orders priced through the mid
+
+    double mid_move_probability = 0.05;  // chance the mid moves one tick per op
+    double level_decay = 0.35;           // geometric p for ticks behind the touch
+    uint32_t max_levels = 50;
+
+    int64_t median_qty = 100;
+    double qty_sigma = 0.8;          // log-normal spread of order sizes
+    int64_t sweep_multiplier = 20;   // market order size vs a typical order
+
+    uint64_t mean_gap_ns = 20000;    // mean inter-arrival time outside bursts
+    double burst_probability = 0.002;
+    uint32_t burst_length = 200;     // ops per burst, arriving 100x faster
+};
+
+enum class TraceOpType : uint8_t { PLACE, CANCEL, REPLACE };
+
+// One step of a trace. Cancels and replaces refer to the op that placed the
+// order (its index in the trace), since engine order ids only exist at run
+// time; a replace is a cancel of `ref` followed by a new order.
+struct TraceOp {
+    uint64_t gap_ns = 0;  // time since the previous op
+    TraceOpType type = TraceOpType::PLACE;
+    Side side = Side::BUY;
+    OrderType order_type = OrderType::LIMIT;
+    uint8_t symbol = 0;  // index into Trace::symbols
+    uint32_t account = 0;
+    int64_t price = 0;
+    int64_t quantity = 0;
+    uint64_t ref = 0;
+};
+
+struct Trace {
+    std::vector<std::string> symbols;
+    uint32_t accounts = 0;
+    std::vector<TraceOp> ops;
+};
+
+// Draws come straight from the mt19937_64 stream rather than std::
+// distributions, whose algorithms differ between standard libraries, so a
+// seed yields the same trace wherever it is generated.
+class WorkloadGenerator {
+public:
+    explicit WorkloadGenerator(WorkloadConfig config);
+
+    TraceOp next();
+    [[nodiscard]] Trace generate(size_t count);
+
+private:
+    // A limit order the generator placed and may later cancel or replace
+    struct LiveOrder {
+        uint64_t op = 0;
+        uint8_t symbol = 0;
+        Side side = Side::BUY;
+        uint32_t account = 0;
+    };
+
+    WorkloadConfig config_;
+    std::mt19937_64 rng_;
+    std::vector<double> symbol_cdf_;
+    std::vector<int64_t> mids_;
+    std::vector<LiveOrder> live_;
+    uint64_t op_index_ = 0;
+    uint32_t burst_left_ = 0;
+
+    double uniform();
+    uint64_t geometric(double p);
+    uint8_t draw_symbol();
+    int64_t draw_qty();
+    uint64_t draw_gap();
+    int64_t limit_price(uint8_t symbol, Side side);
+    LiveOrder take_live();
+};
+
+// Binary trace file: "AZTRACE1", version, symbol table, account count, op
+// count, then fixed 36-byte little-endian op records
+bool write_trace(const std::string& path, const Trace& trace);
+[[nodiscard]] std::optional<Trace> read_trace(const std::string& path);
+
+[[nodiscard]] Order trace_order(const Trace& trace, const TraceOp& op);
+
+struct TraceRunStats {
+    uint64_t placed = 0;
+    uint64_t cancelled = 0;
+    uint64_t replaced = 0;
+    uint64_t rejected = 0;
+    uint64_t cancel_misses = 0;  // target already filled or cancelled
+    uint64_t trades = 0;
+};
+
+inline void to_json(nlohmann::json& j, const TraceRunStats& s) {
+    j = nlohmann::json{
+        {"placed", s.placed},
+        {"cancelled", s.cancelled},
+        {"replaced", s.replaced},
+        {"rejected", s.rejected},
+        {"cancel_misses", s.cancel_misses},
+        {"trades", s.trades}
+    };
+}
+
+// Feeds a trace into an engine op by op. The same trace against a fresh
+// engine always produces the same orders, trades and events.
+class TraceRunner {
+public:
+    TraceRunner(MatchingEngine& engine, const Trace& trace);
+
+    // Applies the next op; false once the trace is exhausted
+    bool step();
+    void run();
+
+    [[nodiscard]] size_t position() const { return pos_; }
+    [[nodiscard]] const TraceRunStats& stats() const { return stats_; }
+
+private:
+    MatchingEngine& engine_;
+    const Trace& trace_;
+    std::vector<uint64_t> order_ids_;  // engine id per placing op, 0 if none
+    size_t pos_ = 0;
+    TraceRunStats stats_;
+
+    void place(const TraceOp& op);
+    bool cancel(uint64_t ref);
+};
+
+}  // namespace exchange
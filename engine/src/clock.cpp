@@ -0,0 +1,155 @@
+#include "exchange/clock.hpp"
+
+#include <chrono>
+
+#include <time.h>
+
+#include "exchange/tsc.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace exchange {
+
+namespace {
+
+uint64_t realtime_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::system_clock::now().time_since_epoch())
+                                     .count());
+}
+
+// Never stepped or slewed by NTP, so the tick rate is measured against it
+uint64_t raw_ns() {
+#ifdef CLOCK_MONOTONIC_RAW
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + static_cast<uint64_t>(ts.tv_nsec);
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+#endif
+}
+
+// TSC, realtime and raw monotonic time read as close together as possible:
+// keep the sample whose bracketing TSC reads are nearest, and take their
+// midpoint
+void sample_clocks(uint64_t& tsc, uint64_t& ns, uint64_t& raw) {
+    uint64_t best_window = UINT64_MAX;
+    for (int i = 0; i < 5; ++i) {
+        uint64_t t0 = rdtsc();
+        uint64_t rt = realtime_ns();
+        uint64_t mono = raw_ns();
+        uint64_t t1 = rdtsc();
+        if (t1 - t0 < best_window) {
+            best_window = t1 - t0;
+            tsc = t0 + (t1 - t0) / 2;
+            ns = rt;
+            raw = mono;
+        }
+    }
+}
+
+}  // namespace
+
+bool has_invariant_tsc() {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (__get_cpuid_max(0x80000000, nullptr) < 0x80000007) return false;
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return (edx & (1u << 8)) != 0;
+#elif defined(_M_X64) || defined(_M_IX86)
+    int regs[4] = {};
+    __cpuid(regs, 0x80000000);
+    if (static_cast<unsigned>(regs[0]) < 0x80000007) return false;
+    __cpuid(regs, 0x80000007);
+    return (regs[3] & (1 << 8)) != 0;
+#elif defined(__aarch64__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+TscClock& TscClock::instance() {
+    static TscClock clock;
+    return clock;
+}
+
+TscClock::TscClock() : use_tsc_(has_invariant_tsc()) {
+    if (!use_tsc_) return;
+    ns_per_tick_.store(tsc_ns_per_tick(), std::memory_order_relaxed);
+    uint64_t ns = 0;
+    sample_clocks(origin_tsc_, ns, origin_raw_ns_);
+    base_tsc_.store(origin_tsc_, std::memory_order_relaxed);
+    base_ns_.store(ns, std::memory_order_relaxed);
+    next_resync_tsc_.store(
+        origin_tsc_ + static_cast<uint64_t>(RESYNC_INTERVAL_NS / tsc_ns_per_tick()),
+        std::memory_order_relaxed);
+}
+
+uint64_t TscClock::now_ns() {
+    if (!use_tsc_) return monotonic(realtime_ns());
+
+    uint64_t tsc = rdtsc();
+    if (tsc >= next_resync_tsc_.load(std::memory_order_relaxed)) {
+        resync();
+        tsc = rdtsc();
+    }
+
+    uint64_t base_tsc, base_ns;
+    double rate;
+    uint32_t s;
+    do {
+        s = seq_.load(std::memory_order_acquire);
+        base_tsc = base_tsc_.load(std::memory_order_relaxed);
+        base_ns = base_ns_.load(std::memory_order_relaxed);
+        rate = ns_per_tick_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((s & 1) || s != seq_.load(std::memory_order_relaxed));
+
+    uint64_t elapsed = tsc > base_tsc ? tsc - base_tsc : 0;
+    return monotonic(base_ns + static_cast<uint64_t>(static_cast<double>(elapsed) * rate));
+}
+
+void TscClock::resync() {
+    if (!use_tsc_) return;
+    // One re-sync at a time; others keep using the current anchor
+    if (resyncing_.exchange(true, std::memory_order_acquire)) return;
+
+    uint64_t tsc = 0, ns = 0, raw = 0;
+    sample_clocks(tsc, ns, raw);
+
+    // Realtime only moves the anchor; a step or slew of the system clock
+    // never leaks into the rate
+    double rate = ns_per_tick_.load(std::memory_order_relaxed);
+    if (tsc > origin_tsc_ && raw > origin_raw_ns_) {
+        rate = static_cast<double>(raw - origin_raw_ns_) / static_cast<double>(tsc - origin_tsc_);
+    }
+
+    uint32_t s = seq_.load(std::memory_order_relaxed);
+    seq_.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    base_tsc_.store(tsc, std::memory_order_relaxed);
+    base_ns_.store(ns, std::memory_order_relaxed);
+    ns_per_tick_.store(rate, std::memory_order_relaxed);
+    seq_.store(s + 2, std::memory_order_release);
+
+    next_resync_tsc_.store(tsc + static_cast<uint64_t>(RESYNC_INTERVAL_NS / rate),
+                           std::memory_order_relaxed);
+    resyncs_.fetch_add(1, std::memory_order_relaxed);
+    resyncing_.store(false, std::memory_order_release);
+}
+
+uint64_t TscClock::monotonic(uint64_t ns) {
+    // Plain load/store rather than a CAS loop: the matching thread is the
+    // only hot caller, and a locked instruction would double the read cost
+    uint64_t last = last_ns_.load(std::memory_order_relaxed);
+    if (ns <= last) return last;
+    last_ns_.store(ns, std::memory_order_relaxed);
+    return ns;
+}
+
+}  // namespace exchange
@@ -11,12 +11,35 @@ EventLog::EventLog(const std::string& path) : path_(path) {
     }
 }
 
+EventLog::~EventLog() {
+    external_writer_ = false;
+    flush();
+}
+
 void EventLog::append(const Event& event) {
     if (!enabled_) return;
     std::lock_guard<std::mutex> lock(mutex_);
     nlohmann::json j = event;
-    file_ << j.dump() << "\n";
+    pending_ += j.dump();
+    pending_ += '\n';
+}
+
+void EventLog::flush() {
+    if (!enabled_ || external_writer_) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pending_.empty()) return;
+    file_.write(pending_.data(), static_cast<std::streamsize>(pending_.size()));
     file_.flush();
+    pending_.clear();
+    write_calls_++;
+}
+
+std::string EventLog::take_pending() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string out;
+    out.swap(pending_);
+    if (!out.empty()) write_calls_++;
+    return out;
 }
 
 std::vector<Event> EventLog::read_all() const {
@@ -0,0 +1,102 @@
+#include "exchange/idempotency_store.hpp"
+
+namespace exchange {
+
+namespace {
+
+// splitmix64 finalizer
+uint64_t mix(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+// Heap held by a cached response, roughly: its trades and the strings of
+// the order and trades
+size_t heap_bytes(const IdempotencyStore::Response& r) {
+    const Order& o = r.order;
+    size_t n = o.account_id.size() + o.symbol.size() + o.client_order_id.size() +
+               o.idempotency_key.size() + r.trades.capacity() * sizeof(Trade);
+    for (const Trade& t : r.trades) {
+        n += t.symbol.size() + t.buyer_account_id.size() + t.seller_account_id.size();
+    }
+    return n;
+}
+
+}  // namespace
+
+KeyFingerprint IdempotencyStore::fingerprint(std::string_view key) {
+    // FNV-1a for one half, a multiply-rotate hash for the other
+    uint64_t fnv = 14695981039346656037ULL;
+    uint64_t mr = 0x9e3779b97f4a7c15ULL ^ key.size();
+    for (char c : key) {
+        auto b = static_cast<uint8_t>(c);
+        fnv = (fnv ^ b) * 1099511628211ULL;
+        mr = (mr ^ b) * 0xff51afd7ed558ccdULL;
+        mr = (mr << 23) | (mr >> 41);
+    }
+    return {mix(mr), mix(fnv)};
+}
+
+const IdempotencyStore::Entry* IdempotencyStore::find(const KeyFingerprint& key,
+                                                      uint64_t now_ns) {
+    expire(now_ns);
+    auto it = index_.find(key);
+    return it == index_.end() ? nullptr : it->second;
+}
+
+void IdempotencyStore::insert(const KeyFingerprint& key, uint64_t order_id, uint64_t now_ns) {
+    expire(now_ns);
+    if (capacity_ == 0 || index_.count(key)) return;
+    entries_.push_back({key, order_id, now_ns, {}});
+    index_.emplace(key, &entries_.back());
+    if (entries_.size() > capacity_) pop_oldest();
+}
+
+void IdempotencyStore::set_response(const KeyFingerprint& key, Response response) {
+    auto it = index_.find(key);
+    if (it == index_.end()) return;
+    Response& cached = it->second->response;
+    response.order.account_prev = response.order.account_next = nullptr;
+    response_bytes_ += heap_bytes(response);
+    response_bytes_ -= heap_bytes(cached);
+    cached = std::move(response);
+}
+
+void IdempotencyStore::clear() {
+    index_.clear();
+    entries_.clear();
+    response_bytes_ = 0;
+}
+
+void IdempotencyStore::restore(const std::deque<Entry>& entries) {
+    clear();
+    for (const Entry& e : entries) {
+        insert(e.key, e.order_id, e.timestamp_ns);
+        set_response(e.key, e.response);
+    }
+}
+
+size_t IdempotencyStore::memory_bytes() const {
+    // Node plus cached hash and next pointer per index entry, one pointer
+    // per bucket, the queue and what the responses hold outside it
+    constexpr size_t NODE = sizeof(std::pair<const KeyFingerprint, Entry*>) + 2 * sizeof(void*);
+    return index_.size() * NODE + index_.bucket_count() * sizeof(void*) +
+           entries_.size() * sizeof(Entry) + response_bytes_;
+}
+
+void IdempotencyStore::expire(uint64_t now_ns) {
+    if (now_ns < ttl_ns_) return;
+    uint64_t cutoff = now_ns - ttl_ns_;
+    while (!entries_.empty() && entries_.front().timestamp_ns <= cutoff) pop_oldest();
+}
+
+void IdempotencyStore::pop_oldest() {
+    index_.erase(entries_.front().key);
+    response_bytes_ -= heap_bytes(entries_.front().response);
+    entries_.pop_front();
+}
+
+}  // namespace exchange
@@ -0,0 +1,344 @@
+#include "exchange/io_uring_server.hpp"
+
+#include <iostream>
+
+#ifdef EXCHANGE_HAVE_IO_URING
+#include <fcntl.h>
+#include <liburing.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+#endif
+
+namespace exchange {
+
+#ifdef EXCHANGE_HAVE_IO_URING
+
+namespace {
+
+constexpr unsigned QUEUE_DEPTH = 1024;
+constexpr size_t RECV_BUFFER_BYTES = 64 * 1024;
+
+enum Op : uint64_t { OP_ACCEPT = 1, OP_RECV = 2, OP_SEND = 3, OP_LOG_WRITE = 4 };
+
+// user_data carries the fd and the operation; an fd is only closed once none
+// of its operations are in flight, so it cannot be reused under us
+uint64_t make_tag(int fd, Op op) { return (static_cast<uint64_t>(fd) << 8) | op; }
+int tag_fd(uint64_t tag) { return static_cast<int>(tag >> 8); }
+Op tag_op(uint64_t tag) { return static_cast<Op>(tag & 0xff); }
+
+}  // namespace
+
+struct IoUringServer::Impl {
+    struct Connection {
+        std::vector<char> recv_buf = std::vector<char>(RECV_BUFFER_BYTES);
+        std::string in;
+        std::string held;     // responses whose events are not yet submitted to the journal
+        std::string covered;  // responses waiting for the in-flight journal write
+        std::string out;      // responses cleared to send
+        std::string sending;  // bytes owned by the in-flight send
+        int inflight = 0;
+        bool send_inflight = false;
+        bool closing = false;
+    };
+
+    IoUringServer& server;
+    io_uring ring{};
+    bool ring_ready = false;
+    int listen_fd = -1;
+    int log_fd = -1;
+    bool shutting_down = false;
+
+    std::unordered_map<int, std::unique_ptr<Connection>> conns;
+
+    std::string log_next;      // journal bytes collected but not yet submitted
+    std::string log_inflight;  // journal bytes owned by the in-flight write
+    bool log_busy = false;
+
+    explicit Impl(IoUringServer& s) : server(s) {}
+
+    ~Impl() {
+        if (ring_ready) io_uring_queue_exit(&ring);
+        for (auto& [fd, _] : conns) ::close(fd);
+        if (log_fd >= 0) ::close(log_fd);
+        if (listen_fd >= 0) {
+            ::close(listen_fd);
+            ::unlink(server.path_.c_str());
+        }
+    }
+
+    io_uring_sqe* get_sqe() {
+        io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+        while (!sqe) {
+            // Submission queue full: hand what we have to the kernel first
+            io_uring_submit(&ring);
+            server.stats_.submit_syscalls++;
+            sqe = io_uring_get_sqe(&ring);
+        }
+        return sqe;
+    }
+
+    void arm_accept() {
+        io_uring_sqe* sqe = get_sqe();
+        io_uring_prep_accept(sqe, listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(make_tag(listen_fd, OP_ACCEPT)));
+    }
+
+    void arm_recv(int fd, Connection& c) {
+        io_uring_sqe* sqe = get_sqe();
+        io_uring_prep_recv(sqe, fd, c.recv_buf.data(), c.recv_buf.size(), 0);
+        io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(make_tag(fd, OP_RECV)));
+        c.inflight++;
+    }
+
+    void arm_send(int fd, Connection& c) {
+        if (c.send_inflight || c.out.empty()) return;
+        c.sending.swap(c.out);
+        io_uring_sqe* sqe = get_sqe();
+        io_uring_prep_send(sqe, fd, c.sending.data(), c.sending.size(), MSG_NOSIGNAL);
+        io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(make_tag(fd, OP_SEND)));
+        c.send_inflight = true;
+        c.inflight++;
+    }
+
+    void arm_log_write() {
+        log_inflight.swap(log_next);
+        io_uring_sqe* sqe = get_sqe();
+        // O_APPEND ignores the offset; -1 means "current position" for other files
+        io_uring_prep_write(sqe, log_fd, log_inflight.data(),
+                            static_cast<unsigned>(log_inflight.size()), static_cast<__u64>(-1));
+        io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(make_tag(log_fd, OP_LOG_WRITE)));
+        log_busy = true;
+        server.stats_.log_writes++;
+    }
+
+    void on_accept(int res) {
+        if (res >= 0) {
+            auto conn = std::make_unique<Connection>();
+            arm_recv(res, *conn);
+            conns.emplace(res, std::move(conn));
+            server.stats_.connections_accepted++;
+        }
+        if (!shutting_down) arm_accept();
+    }
+
+    void on_recv(int fd, Connection& c, int res) {
+        c.inflight--;
+        if (res <= 0) {
+            c.closing = true;
+            return;
+        }
+
+        c.in.append(c.recv_buf.data(), static_cast<size_t>(res));
+        size_t start = 0;
+        size_t nl;
+        while (!shutting_down && (nl = c.in.find('\n', start)) != std::string::npos) {
+            if (nl > start) {
+                c.held += server.handler_.handle(c.in.substr(start, nl - start));
+                c.held += '\n';
+                server.stats_.requests++;
+            }
+            start = nl + 1;
+            if (server.handler_.shutdown_requested()) shutting_down = true;
+        }
+        c.in.erase(0, start);
+
+        if (!shutting_down) arm_recv(fd, c);
+    }
+
+    void on_send(int fd, Connection& c, int res) {
+        c.inflight--;
+        c.send_inflight = false;
+        if (res < 0) {
+            // Peer is gone: drop whatever it was still owed
+            c.closing = true;
+            c.held.clear();
+            c.covered.clear();
+            c.out.clear();
+            c.sending.clear();
+            return;
+        }
+        c.sending.erase(0, static_cast<size_t>(res));
+        if (!c.sending.empty()) {
+            // Short send: the remainder goes ahead of anything queued since
+            c.out.insert(0, c.sending);
+            c.sending.clear();
+        }
+        arm_send(fd, c);
+    }
+
+    void on_log_write(int res) {
+        if (res < 0) {
+            std::cerr << "[ENGINE] Event log write failed: " << std::strerror(-res) << std::endl;
+            res = 0;
+        }
+        log_inflight.erase(0, static_cast<size_t>(res));
+        if (!log_inflight.empty()) {
+            log_next.insert(0, log_inflight);
+            log_inflight.clear();
+            log_busy = false;
+            return;
+        }
+        log_busy = false;
+
+        // Everything covered by this write is now in the journal
+        for (auto& [fd, c] : conns) {
+            if (c->covered.empty()) continue;
+            c->out += c->covered;
+            c->covered.clear();
+            arm_send(fd, *c);
+        }
+    }
+
+    // End of a matching cycle: batch the journal bytes it produced and
+    // release responses that no longer depend on an unwritten event
+    void end_cycle() {
+        if (log_fd >= 0) log_next += server.log_.take_pending();
+
+        if (!log_busy) {
+            bool journal = !log_next.empty();
+            for (auto& [fd, c] : conns) {
+                if (c->held.empty()) continue;
+                if (journal) {
+                    c->covered += c->held;
+                } else {
+                    c->out += c->held;
+                    arm_send(fd, *c);
+                }
+                c->held.clear();
+            }
+            if (journal) arm_log_write();
+        }
+
+        for (auto it = conns.begin(); it != conns.end();) {
+            auto& c = *it->second;
+            bool drained = c.held.empty() && c.covered.empty() && c.out.empty();
+            if (c.closing && c.inflight == 0 && drained) {
+                ::close(it->first);
+                it = conns.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    [[nodiscard]] bool idle() const {
+        if (log_busy || !log_next.empty()) return false;
+        for (const auto& [_, c] : conns) {
+            if (!c->held.empty() || !c->covered.empty() || !c->out.empty() || c->send_inflight) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+IoUringServer::IoUringServer(ProtocolHandler& handler, EventLog& log, std::string path)
+    : handler_(handler), log_(log), path_(std::move(path)), impl_(std::make_unique<Impl>(*this)) {}
+
+IoUringServer::~IoUringServer() {
+    impl_.reset();
+    log_.set_external_writer(false);
+}
+
+bool IoUringServer::available() { return true; }
+
+bool IoUringServer::listen() {
+    sockaddr_un addr{};
+    if (path_.size() >= sizeof(addr.sun_path)) return false;
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path_.c_str(), path_.size() + 1);
+
+    ::unlink(path_.c_str());
+
+    impl_->listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (impl_->listen_fd < 0) return false;
+    if (::bind(impl_->listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(impl_->listen_fd, SOMAXCONN) != 0) {
+        return false;
+    }
+
+    if (io_uring_queue_init(QUEUE_DEPTH, &impl_->ring, 0) < 0) return false;
+    impl_->ring_ready = true;
+
+    if (log_.enabled()) {
+        log_.flush();  // anything buffered before we take over
+        impl_->log_fd = ::open(log_.path().c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+        if (impl_->log_fd < 0) return false;
+        log_.set_external_writer(true);
+    }
+    return true;
+}
+
+void IoUringServer::run() {
+    Impl& s = *impl_;
+    s.arm_accept();
+
+    while (!(s.shutting_down && s.idle())) {
+        int rc = io_uring_submit_and_wait(&s.ring, 1);
+        stats_.submit_syscalls++;
+        if (rc < 0 && rc != -EINTR) {
+            std::cerr << "[ENGINE] io_uring_submit_and_wait failed: " << std::strerror(-rc)
+                      << std::endl;
+            return;
+        }
+
+        unsigned head;
+        unsigned count = 0;
+        io_uring_cqe* cqe;
+        io_uring_for_each_cqe(&s.ring, head, cqe) {
+            ++count;
+            auto tag = reinterpret_cast<uintptr_t>(io_uring_cqe_get_data(cqe));
+            int fd = tag_fd(tag);
+            switch (tag_op(tag)) {
+                case OP_ACCEPT:
+                    s.on_accept(cqe->res);
+                    break;
+                case OP_LOG_WRITE:
+                    s.on_log_write(cqe->res);
+                    break;
+                case OP_RECV:
+                case OP_SEND: {
+                    auto it = s.conns.find(fd);
+                    if (it == s.conns.end()) break;
+                    if (tag_op(tag) == OP_RECV) {
+                        s.on_recv(fd, *it->second, cqe->res);
+                    } else {
+                        s.on_send(fd, *it->second, cqe->res);
+                    }
+                    break;
+                }
+            }
+        }
+        io_uring_cq_advance(&s.ring, count);
+
+        s.end_cycle();
+    }
+}
+
+#else  // !EXCHANGE_HAVE_IO_URING
+
+struct IoUringServer::Impl {};
+
+IoUringServer::IoUringServer(ProtocolHandler& handler, EventLog& log, std::string path)
+    : handler_(handler), log_(log), path_(std::move(path)) {}
+
+IoUringServer::~IoUringServer() = default;
+
+bool IoUringServer::available() { return false; }
+
+bool IoUringServer::listen() {
+    std::cerr << "[ENGINE] Built without liburing; io_uring backend unavailable" << std::endl;
+    return false;
+}
+
+void IoUringServer::run() {}
+
+#endif
+
+}  // namespace exchange
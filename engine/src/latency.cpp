@@ -0,0 +1,35 @@
+#include "exchange/latency.hpp"
+
+namespace exchange {
+
+void to_json(nlohmann::json& j, const LatencyRecorder& r) {
+#ifdef EXCHANGE_LATENCY_STATS
+    const bool enabled = true;
+#else
+    const bool enabled = false;
+#endif
+    // Calibration spins for a few ms; skip it when nothing was timed
+    const double scale = enabled ? tsc_ns_per_tick() : 0.0;
+    auto ns = [scale](uint64_t ticks) {
+        return static_cast<uint64_t>(static_cast<double>(ticks) * scale + 0.5);
+    };
+
+    nlohmann::json stages = nlohmann::json::object();
+    for (size_t i = 0; i < LATENCY_STAGE_NAMES.size(); ++i) {
+        const auto& h = r.histogram(static_cast<LatencyStage>(i));
+        stages[LATENCY_STAGE_NAMES[i]] = {
+            {"count", h.count()},
+            {"min", ns(h.min())},
+            {"mean", h.mean() * scale},
+            {"p50", ns(h.percentile(0.50))},
+            {"p90", ns(h.percentile(0.90))},
+            {"p99", ns(h.percentile(0.99))},
+            {"p999", ns(h.percentile(0.999))},
+            {"max", ns(h.max())}
+        };
+    }
+
+    j = nlohmann::json{{"enabled", enabled}, {"ns_per_tick", scale}, {"stages", stages}};
+}
+
+}  // namespace exchange
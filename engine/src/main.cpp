@@ -1,22 +1,197 @@
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <string_view>
 
 #include <nlohmann/json.hpp>
 
+#include "exchange/io_uring_server.hpp"
 #include "exchange/matching_engine.hpp"
 #include "exchange/protocol.hpp"
+#include "exchange/shm_transport.hpp"
+#include "exchange/socket_server.hpp"
+#include "exchange/workload.hpp"
+
+namespace {
+
+// A whole-string decimal count; a usage error on stderr otherwise
+bool parse_count(std::string_view flag, std::string_view value, uint64_t max, uint64_t& out) {
+    auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), out);
+    if (!value.empty() && ec == std::errc{} && end == value.data() + value.size() && out <= max) {
+        return true;
+    }
+    std::cerr << "[ENGINE] Usage: " << flag << " <0.." << max << ">, got '" << value << "'"
+              << std::endl;
+    return false;
+}
+
+// Default transport: one JSON command per line on stdin, one response per line on stdout
+int run_stdio(exchange::ProtocolHandler& handler) {
+    std::cerr << "[ENGINE] Ready, reading commands from stdin..." << std::endl;
+
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        if (line.empty()) continue;
+        
+        std::string response = handler.handle(line);
+        std::cout << response << std::endl;
+        std::cout.flush();
+
+        if (handler.shutdown_requested()) {
+            std::cerr << "[ENGINE] Shutdown requested" << std::endl;
+            break;
+        }
+    }
+    return 0;
+}
+
+// Same JSON protocol carried over shared-memory rings instead of pipes
+int run_shm(exchange::ProtocolHandler& handler, const std::string& name) {
+    exchange::ShmTransport transport(name);
+    if (!transport.create()) {
+        std::cerr << "[ENGINE] Could not create shared memory transport " << name << std::endl;
+        return 1;
+    }
+
+    std::cerr << "[ENGINE] Ready, serving shared memory transport " << name << std::endl;
+
+    std::string request;
+    while (transport.receive(request)) {
+        if (request.empty()) continue;
+
+        if (!transport.send(handler.handle(request))) {
+            std::cerr << "[ENGINE] Response too large or client gone" << std::endl;
+            break;
+        }
+
+        if (handler.shutdown_requested()) {
+            std::cerr << "[ENGINE] Shutdown requested" << std::endl;
+            break;
+        }
+    }
+    return 0;
+}
+
+// Many clients on one UNIX domain socket, multiplexed into this thread
+int run_socket_server(exchange::ProtocolHandler& handler, exchange::EventLog& log,
+                      const std::string& path) {
+    exchange::SocketServer server(handler, path);
+    if (!server.listen()) {
+        std::cerr << "[ENGINE] Could not listen on " << path << std::endl;
+        return 1;
+    }
+
+    std::cerr << "[ENGINE] Ready, listening on " << path << " (epoll)" << std::endl;
+    server.run();
+    std::cerr << "[ENGINE] Shutdown requested" << std::endl;
+
+    const auto& st = server.stats();
+    nlohmann::json io = {{"backend", "epoll"},
+                         {"requests", st.requests},
+                         {"syscalls", st.wait_syscalls + st.read_syscalls + st.write_syscalls +
+                                          log.write_calls()}};
+    std::cerr << "[ENGINE] io_stats " << io.dump() << std::endl;
+    return 0;
+}
+
+// Same server on io_uring: socket I/O and journal writes batched per cycle
+int run_io_uring_server(exchange::ProtocolHandler& handler, exchange::EventLog& log,
+                        const std::string& path) {
+    exchange::IoUringServer server(handler, log, path);
+    if (!server.listen()) {
+        std::cerr << "[ENGINE] Could not listen on " << path << " with io_uring" << std::endl;
+        return 1;
+    }
+
+    std::cerr << "[ENGINE] Ready, listening on " << path << " (io_uring)" << std::endl;
+    server.run();
+    std::cerr << "[ENGINE] Shutdown requested" << std::endl;
+
+    const auto& st = server.stats();
+    nlohmann::json io = {{"backend", "io_uring"},
+                         {"requests", st.requests},
+                         {"syscalls", st.submit_syscalls}};
+    std::cerr << "[ENGINE] io_stats " << io.dump() << std::endl;
+    return 0;
+}
+
+// Drive the engine from a recorded workload trace instead of a client,
+// journaling as usual, then print a summary and exit
+int run_trace(exchange::MatchingEngine& engine, const std::string& path) {
+    auto trace = exchange::read_trace(path);
+    if (!trace) {
+        std::cerr << "[ENGINE] Could not read trace " << path << std::endl;
+        return 1;
+    }
+
+    std::cerr << "[ENGINE] Replaying " << trace->ops.size() << " trace ops from " << path
+              << std::endl;
+    auto t0 = std::chrono::steady_clock::now();
+    exchange::TraceRunner runner(engine, *trace);
+    runner.run();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    nlohmann::json summary = runner.stats();
+    summary["ops"] = trace->ops.size();
+    summary["seconds"] = secs;
+    summary["ops_per_sec"] = secs > 0 ? static_cast<double>(trace->ops.size()) / secs : 0.0;
+    summary["event_sequence"] = engine.get_stats().event_sequence;
+    std::cout << summary.dump() << std::endl;
+    return 0;
+}
+
+}  // namespace
 
 int main(int argc, char* argv[]) {
     std::string event_log;
     std::string snapshot_dir;
+    std::string bbo_feed;
+    std::string l3_feed;
+    std::string shm_name;
+    std::string listen_path;
+    bool io_uring = false;
+    std::string replay_trace;
+    std::string risk_config;
+    uint64_t idempotency_capacity = exchange::IdempotencyStore::DEFAULT_CAPACITY;
+    uint64_t idempotency_ttl_s = exchange::IdempotencyStore::DEFAULT_TTL_NS / 1000000000;
 
     for (int i = 1; i < argc; ++i) {
         std::string a = argv[i];
         if (a == "--event-log" && i + 1 < argc) event_log = argv[++i];
         else if (a == "--snapshot-dir" && i + 1 < argc) snapshot_dir = argv[++i];
+        else if (a == "--bbo-feed" && i + 1 < argc) bbo_feed = argv[++i];
+        else if (a == "--l3-feed" && i + 1 < argc) l3_feed = argv[++i];
+        else if (a == "--shm" && i + 1 < argc) shm_name = argv[++i];
+        else if (a == "--listen" && i + 1 < argc) listen_path = argv[++i];
+        else if (a == "--io-uring") io_uring = true;
+        else if (a == "--replay-trace" && i + 1 < argc) replay_trace = argv[++i];
+        else if (a == "--risk-config" && i + 1 < argc) risk_config = argv[++i];
+        else if (a == "--idempotency-capacity" && i + 1 < argc) {
+            if (!parse_count(a, argv[++i], SIZE_MAX, idempotency_capacity)) return 1;
+        } else if (a == "--idempotency-ttl-s" && i + 1 < argc) {
+            // Kept in nanoseconds, which must not overflow
+            if (!parse_count(a, argv[++i], UINT64_MAX / 1000000000, idempotency_ttl_s)) return 1;
+        }
     }
 
     exchange::MatchingEngine engine(event_log, snapshot_dir);
+    engine.set_idempotency_limits(idempotency_capacity, idempotency_ttl_s * 1000000000);
+
+    // Symbols and their trading rules, replacing the built-in defaults
+    if (!risk_config.empty()) {
+        auto limits = exchange::load_risk_config(risk_config);
+        if (!limits) {
+            std::cerr << "[ENGINE] Could not load risk config " << risk_config << std::endl;
+            return 1;
+        }
+        engine.set_risk_limits(std::move(*limits));
+        std::cerr << "[ENGINE] Loaded risk config for "
+                  << engine.risk_checker().symbols().size() << " symbols" << std::endl;
+    }
     
     if (engine.recover()) {
         std::cerr << "[ENGINE] Recovered from existing state" << std::endl;
@@ -24,31 +199,61 @@ int main(int argc, char* argv[]) {
         std::cerr << "[ENGINE] Starting fresh" << std::endl;
     }
 
-    exchange::ProtocolHandler handler(engine);
+    // Optional top-of-book change stream, one JSON line per change
+    std::ofstream bbo_out;
+    if (!bbo_feed.empty()) {
+        bbo_out.open(bbo_feed, std::ios::app);
+        if (bbo_out.is_open()) {
+            engine.set_bbo_listener(
+                [&bbo_out](const std::string& symbol, const exchange::Bbo& bbo,
+                           uint64_t timestamp_ns) {
+                    nlohmann::json j = bbo;
+                    j["symbol"] = symbol;
+                    j["timestamp_ns"] = timestamp_ns;
+                    bbo_out << j.dump() << "\n";
+                },
+                [&bbo_out] { bbo_out.flush(); });
+        } else {
+            std::cerr << "[ENGINE] Could not open BBO feed " << bbo_feed << std::endl;
+        }
+    }
 
-    std::cerr << "[ENGINE] Ready, reading commands from stdin..." << std::endl;
+    // Optional order-by-order feed, drained by its own thread to a file or
+    // unix:<path> socket. Attached after recovery so replay is not re-published.
+    std::unique_ptr<exchange::MarketDataFeed> feed;
+    if (!l3_feed.empty()) {
+        feed = std::make_unique<exchange::MarketDataFeed>(l3_feed);
+        if (feed->start()) {
+            engine.set_market_data_feed(feed.get());
+        } else {
+            std::cerr << "[ENGINE] Could not open L3 feed " << l3_feed << std::endl;
+            feed.reset();
+        }
+    }
 
-    std::string line;
-    while (std::getline(std::cin, line)) {
-        if (line.empty()) continue;
-        
-        std::string response = handler.handle(line);
-        std::cout << response << std::endl;
-        std::cout.flush();
+    exchange::ProtocolHandler handler(engine);
 
-        // Check for shutdown command
-        try {
-            auto cmd = nlohmann::json::parse(line);
-            std::string cmd_type = cmd.value("cmd", "");
-            if (cmd_type == "shutdown" || cmd_type == "exit" || cmd_type == "quit") {
-                std::cerr << "[ENGINE] Shutdown requested" << std::endl;
-                break;
-            }
-        } catch (...) {
-            // Ignore parse errors here - they're handled in the protocol handler
+    int rc = 0;
+    if (!replay_trace.empty()) {
+        rc = run_trace(engine, replay_trace);
+    } else if (!listen_path.empty()) {
+        if (io_uring && !exchange::IoUringServer::available()) {
+            std::cerr << "[ENGINE] io_uring not compiled in, falling back to epoll" << std::endl;
+            io_uring = false;
         }
+        rc = io_uring ? run_io_uring_server(handler, engine.event_log(), listen_path)
+                      : run_socket_server(handler, engine.event_log(), listen_path);
+    } else if (!shm_name.empty()) {
+        rc = run_shm(handler, shm_name);
+    } else {
+        rc = run_stdio(handler);
+    }
+
+    if (feed) {
+        engine.set_market_data_feed(nullptr);
+        feed->stop();
     }
 
     std::cerr << "[ENGINE] Exiting" << std::endl;
-    return 0;
+    return rc;
 }
\ No newline at end of file
@@ -0,0 +1,153 @@
+#include "exchange/market_data.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace exchange {
+
+namespace {
+
+constexpr std::string_view UNIX_PREFIX = "unix:";
+constexpr size_t WRITE_BATCH_BYTES = 64 * 1024;
+
+}  // namespace
+
+void to_json(nlohmann::json& j, const L3Message& m) {
+    j = nlohmann::json{{"seq", m.sequence},
+                       {"timestamp_ns", m.timestamp_ns},
+                       {"type", m.type},
+                       {"symbol", std::string(m.symbol)},
+                       {"side", m.side},
+                       {"order_id", m.order_id},
+                       {"price", m.price},
+                       {"quantity", m.quantity}};
+    if (m.type == L3MessageType::EXECUTE) {
+        j["trade_id"] = m.trade_id;
+    }
+}
+
+MarketDataFeed::MarketDataFeed(std::string sink) : sink_(std::move(sink)) {}
+
+MarketDataFeed::~MarketDataFeed() { stop(); }
+
+bool MarketDataFeed::start() {
+#ifdef _WIN32
+    std::cerr << "[ENGINE] L3 feed is not supported on this platform" << std::endl;
+    return false;
+#else
+    if (sink_.rfind(UNIX_PREFIX, 0) == 0) {
+        std::string path = sink_.substr(UNIX_PREFIX.size());
+        sockaddr_un addr{};
+        if (path.size() >= sizeof(addr.sun_path)) return false;
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+        fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd_ < 0) return false;
+        if (::connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            ::close(fd_);
+            fd_ = -1;
+            return false;
+        }
+        is_socket_ = true;
+    } else {
+        fd_ = ::open(sink_.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd_ < 0) return false;
+    }
+
+    running_.store(true, std::memory_order_release);
+    consumer_ = std::thread(&MarketDataFeed::run, this);
+    return true;
+#endif
+}
+
+void MarketDataFeed::stop() {
+    running_.store(false, std::memory_order_release);
+    if (consumer_.joinable()) consumer_.join();
+#ifndef _WIN32
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+#endif
+}
+
+void MarketDataFeed::publish(L3MessageType type, const Order& order, int64_t quantity,
+                             uint64_t trade_id) {
+    L3Message m;
+    m.sequence = ++sequence_;
+    m.timestamp_ns = timestamp_ns_;
+    m.order_id = order.id;
+    m.trade_id = trade_id;
+    m.price = order.price;
+    m.quantity = quantity;
+    m.type = type;
+    m.side = order.side;
+    std::strncpy(m.symbol, order.symbol.c_str(), sizeof(m.symbol) - 1);
+
+    // Never stall the matcher: a full ring drops the message and consumers
+    // detect the gap from the sequence number
+    if (!ring_.try_push(m)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void MarketDataFeed::run() {
+    std::string batch;
+    batch.reserve(WRITE_BATCH_BYTES * 2);
+    L3Message m;
+
+    while (true) {
+        // Read the flag before draining so nothing published before stop() is lost
+        bool keep_running = running_.load(std::memory_order_acquire);
+
+        while (batch.size() < WRITE_BATCH_BYTES && ring_.try_pop(m)) {
+            nlohmann::json j = m;
+            batch += j.dump();
+            batch += '\n';
+        }
+
+        if (!batch.empty()) {
+            if (!write_all(batch)) {
+                std::cerr << "[ENGINE] L3 feed sink write failed, stopping feed" << std::endl;
+                return;
+            }
+            batch.clear();
+            continue;
+        }
+
+        if (!keep_running) break;
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+}
+
+bool MarketDataFeed::write_all(const std::string& data) {
+#ifdef _WIN32
+    (void)data;
+    return false;
+#else
+    size_t off = 0;
+    while (off < data.size()) {
+        ssize_t n = is_socket_
+                        ? ::send(fd_, data.data() + off, data.size() - off, MSG_NOSIGNAL)
+                        : ::write(fd_, data.data() + off, data.size() - off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        off += static_cast<size_t>(n);
+    }
+    return true;
+#endif
+}
+
+}  // namespace exchange
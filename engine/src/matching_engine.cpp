@@ -12,6 +12,36 @@
 
 namespace exchange {
 
+namespace {
+
+// Writes every event a command produced in one batch when the command
+// returns, and flushes the top-of-book listener once if the command moved it
+struct EventBatch {
+    EventLog& log;
+    LatencyRecorder& latency;
+    const std::function<void()>& bbo_flush;
+    bool& bbo_published;
+
+    ~EventBatch() {
+        if (bbo_published) {
+            bbo_published = false;
+            if (bbo_flush) bbo_flush();
+        }
+#ifdef EXCHANGE_LATENCY_STATS
+        if (latency.pending(LatencyStage::EVENT_LOG) > 0) {
+            uint64_t start = rdtsc();
+            log.flush();
+            latency.accrue(LatencyStage::EVENT_LOG, rdtsc() - start);
+            latency.commit(LatencyStage::EVENT_LOG);
+            return;
+        }
+#endif
+        log.flush();
+    }
+};
+
+}  // namespace
+
 MatchingEngine::MatchingEngine(const std::string& event_log_path,
                                const std::string& snapshot_path,
                                uint64_t snapshot_interval)
@@ -19,19 +49,67 @@ MatchingEngine::MatchingEngine(const std::string& event_log_path,
       snapshot_manager_(snapshot_path, snapshot_interval) {}
 
 PlaceOrderResult MatchingEngine::place_order(Order order) {
+    EXCHANGE_LATENCY_SCOPE(latency_, LatencyStage::PLACE_ORDER);
+    EventBatch batch{event_log_, latency_, bbo_flush_, bbo_published_};
+    begin_command();
     PlaceOrderResult r;
 
-    // idempotency check
-    if (!order.idempotency_key.empty() &&
-        idempotency_keys_.count(order.idempotency_key)) {
+    // idempotency check; a retry gets the first placement's result back
+    KeyFingerprint key;
+    if (!order.idempotency_key.empty()) {
+        key = IdempotencyStore::fingerprint(order.idempotency_key);
+        if (const auto* first = idempotency_.find(key, command_ts_)) {
+            const auto& cached = first->response;
+            r.success = cached.success;
+            r.error_code = cached.error_code;
+            r.order = cached.order;
+            r.trades = cached.trades;
+            r.duplicate = true;
+            return r;
+        }
+    }
+
+    // kill switch
+    if (!blocked_accounts_.empty() && blocked_accounts_.count(order.account_id)) {
         r.success = false;
-        r.error_code = ErrorCode::DUPLICATE_IDEMPOTENCY_KEY;
+        r.error_code = ErrorCode::ACCOUNT_BLOCKED;
+        stats_.total_rejects++;
+        return r;
+    }
+
+    // trading phase, read once for the command
+    const SymbolState state = symbol_state(order.symbol);
+    if (state != SymbolState::CONTINUOUS) {
+        ErrorCode code = admit_state(order, state);
+        if (code != ErrorCode::NONE) {
+            r.success = false;
+            r.error_code = code;
+            stats_.total_rejects++;
+            return r;
+        }
+    }
+
+    // client ids name one open order per account
+    if (!order.client_order_id.empty() &&
+        find_client_order(order.account_id, order.client_order_id) != 0) {
+        r.success = false;
+        r.error_code = ErrorCode::DUPLICATE_CLIENT_ORDER_ID;
+        stats_.total_rejects++;
+        return r;
+    }
+
+    // good-till-time deadline must still be ahead
+    if (order.expire_ts_ns != 0 && order.expire_ts_ns <= command_ts_) {
+        r.success = false;
+        r.error_code = ErrorCode::INVALID_EXPIRY;
         stats_.total_rejects++;
         return r;
     }
 
     // risk check
+    EXCHANGE_LATENCY_BEGIN(latency_, risk_start);
     auto risk = risk_checker_.check_order(order);
+    EXCHANGE_LATENCY_END(latency_, LatencyStage::RISK_CHECK, risk_start);
     if (!risk.passed) {
         r.success = false;
         r.error_code = risk.error_code;
@@ -41,13 +119,13 @@ PlaceOrderResult MatchingEngine::place_order(Order order) {
 
     // assign id, timestamp, remaining
     order.id = next_order_id_++;
-    order.timestamp_ns = now_ns();
+    order.timestamp_ns = command_ts_;
     order.remaining_qty = order.quantity;
+    order.reset_display();
     order.status = OrderStatus::NEW;
+    order.account_prev = order.account_next = nullptr;
 
-    if (!order.idempotency_key.empty()) {
-        idempotency_keys_.insert(order.idempotency_key);
-    }
+    if (!order.idempotency_key.empty()) idempotency_.insert(key, order.id, command_ts_);
 
     // store order
     auto ptr = std::make_unique<Order>(order);
@@ -57,31 +135,149 @@ PlaceOrderResult MatchingEngine::place_order(Order order) {
     // log placed event
     log_event(EventType::ORDER_PLACED, *raw);
     stats_.total_orders++;
+    if (raw->expire_ts_ns != 0) expiries_.schedule(raw->id, raw->expire_ts_ns);
+
+    if (raw->is_stop()) {
+        arm_stop(raw, r, state);
+    } else {
+        execute(raw, r, state);
+        fire_stops();
+    }
+    if (!raw->idempotency_key.empty()) cache_response(key, *raw, r);
+    return r;
+}
+
+// Keeps what a keyed placement returned for its retries. The journaled
+// copy names the trades by id; replay finds them just behind it.
+void MatchingEngine::cache_response(const KeyFingerprint& key, const Order& order,
+                                    const PlaceOrderResult& r) {
+    std::vector<uint64_t> trade_ids;
+    for (const Trade& t : r.trades) trade_ids.push_back(t.id);
+    log_event(EventType::RESPONSE_CACHED, nlohmann::json{{"order_id", order.id},
+                                                         {"success", r.success},
+                                                         {"error_code", r.error_code},
+                                                         {"trade_ids", trade_ids}});
+    idempotency_.set_response(key, {r.success, r.error_code, order, r.trades});
+}
+
+// Parks a new stop order until a trade reaches its stop price, or fires it
+// at once if the last trade is already through it
+void MatchingEngine::arm_stop(Order* raw, PlaceOrderResult& r, SymbolState state) {
+    StopBook& stops = stop_books_[raw->symbol];
+    if (stops.is_triggered(*raw)) {
+        trigger_stop(raw);
+        execute(raw, r, state);
+        fire_stops();
+        return;
+    }
+    stops.add(raw);
+    risk_checker_.on_rest(*raw);
+    index_order(*raw);
+    r.success = true;
+    r.order = *raw;
+}
+
+// Turns a stop into the order it stands for, queued from the trigger time
+void MatchingEngine::trigger_stop(Order* order) {
+    order->type = order->type == OrderType::STOP ? OrderType::MARKET : OrderType::LIMIT;
+    order->timestamp_ns = command_ts_;
+    log_event(EventType::STOP_TRIGGERED, nlohmann::json{{"order_id", order->id}});
+}
+
+// Why an order is refused in a symbol that is not trading continuously;
+// only resting orders join a call auction
+ErrorCode MatchingEngine::admit_state(const Order& order, SymbolState state) const {
+    switch (state) {
+        case SymbolState::HALTED:
+            return ErrorCode::SYMBOL_HALTED;
+        case SymbolState::CLOSED:
+            return ErrorCode::SYMBOL_CLOSED;
+        case SymbolState::PRE_OPEN:
+        case SymbolState::AUCTION:
+            if (order.type == OrderType::MARKET || order.time_in_force != TimeInForce::GTC) {
+                return ErrorCode::SYMBOL_IN_AUCTION;
+            }
+            break;
+        case SymbolState::CONTINUOUS:
+            break;
+    }
+    return ErrorCode::NONE;
+}
+
+// Executes the stops triggered so far in this command. The queue is FIFO
+// and grows as they trade, so a cascade fires in one deterministic order
+// that the STOP_TRIGGERED events reproduce on replay. Trades only happen
+// while a symbol trades continuously, so its stops fire that way too. The
+// fired order is risk checked again, since positions and the collar have
+// moved since it was parked, and rejected if it no longer passes.
+void MatchingEngine::fire_stops() {
+    for (size_t i = 0; i < triggered_stops_.size(); ++i) {
+        Order* order = triggered_stops_[i];
+        unindex_order(*order);
+        risk_checker_.on_unrest(*order, order->remaining_qty);
+        trigger_stop(order);
+        PlaceOrderResult ignored;
+        auto risk = risk_checker_.check_order(*order);
+        if (!risk.passed) {
+            reject_placed(get_or_create_book(order->symbol), order, ignored, risk.error_code);
+            continue;
+        }
+        execute(order, ignored);
+    }
+    triggered_stops_.clear();
+}
+
+// Matches a stored order and rests what is left of a limit order, filling in
+// r. Shared by new orders and re-queued modifications.
+void MatchingEngine::execute(Order* raw, PlaceOrderResult& r, SymbolState state) {
+    if (state == SymbolState::PRE_OPEN || state == SymbolState::AUCTION) {
+        // Accumulates for the uncross; a stop firing as a market order is
+        // the only non-resting order that gets here
+        auto& book = get_or_create_book(raw->symbol);
+        if (raw->type == OrderType::MARKET) {
+            reject_placed(book, raw, r, ErrorCode::SYMBOL_IN_AUCTION);
+            return;
+        }
+        rest_order(book, raw);
+        publish_bbo(book);
+        r.success = true;
+        r.order = *raw;
+        return;
+    }
 
     // attempt match
+    EXCHANGE_LATENCY_BEGIN(latency_, match_start);
     r.trades = match(raw);
+    EXCHANGE_LATENCY_END(latency_, LatencyStage::MATCH, match_start);
+    auto& book = get_or_create_book(raw->symbol);
 
     // update status / book membership
-    if (raw->remaining_qty == 0) {
+    const bool stp_stopped = match_stop_ == ErrorCode::SELF_TRADE_PREVENTED;
+    if (raw->remaining_qty == 0 && !stp_stopped) {
         raw->status = OrderStatus::FILLED;
+    } else if (r.trades.empty() && match_stop_ != ErrorCode::NONE && raw->remaining_qty > 0) {
+        // Refused by its time in force or self-trade prevention, or a market
+        // order stopped at the collar. DECREMENT_AND_CANCEL taking the whole
+        // order is not a refusal and is cancelled below.
+        reject_placed(book, raw, r, match_stop_);
+        return;
+    } else if (stp_stopped) {
+        cancel_remainder(raw);
     } else if (raw->type == OrderType::MARKET) {
         // Market order with remaining qty = no liquidity for remainder
         if (raw->remaining_qty == raw->quantity) {
             // No fills at all
-            raw->status = OrderStatus::REJECTED;
-            r.success = false;
-            r.error_code = ErrorCode::NO_LIQUIDITY;
-            stats_.total_rejects++;
-            r.order = *raw;
-            return r;
+            reject_placed(book, raw, r, ErrorCode::NO_LIQUIDITY);
+            return;
         } else {
             // Partial fill - market orders don't rest on book
             raw->status = OrderStatus::PARTIAL;
         }
+    } else if (raw->time_in_force == TimeInForce::IOC ||
+               raw->time_in_force == TimeInForce::FOK) {
+        cancel_remainder(raw);
     } else if (raw->type == OrderType::LIMIT && raw->remaining_qty > 0) {
         // Limit order with remaining qty - check if adding would cross the book
-        auto& book = get_or_create_book(raw->symbol);
-        
         bool would_cross = false;
         if (raw->side == Side::BUY) {
             auto best_ask = book.best_ask_price();
@@ -96,96 +292,501 @@ PlaceOrderResult MatchingEngine::place_order(Order order) {
         }
         
         if (would_cross) {
-            // This can happen due to self-trade prevention
-            // Reject the order to maintain book integrity
-            raw->status = OrderStatus::REJECTED;
-            r.success = false;
-            r.error_code = ErrorCode::SELF_TRADE_PREVENTED;
-            stats_.total_rejects++;
-            r.order = *raw;
-            return r;
-        }
-        
-        // Safe to add to book
-        book.add_order(raw);
-        if (raw->remaining_qty < raw->quantity) {
-            raw->status = OrderStatus::PARTIAL;
+            // Only the account's own orders, passed over by SKIP, can still
+            // be in the way; the remainder goes rather than cross them
+            if (r.trades.empty()) {
+                reject_placed(book, raw, r, ErrorCode::SELF_TRADE_PREVENTED);
+                return;
+            }
+            cancel_remainder(raw);
+        } else {
+            rest_order(book, raw);
+            if (raw->remaining_qty < raw->quantity) {
+                raw->status = OrderStatus::PARTIAL;
+            }
+            // else status remains NEW
         }
-        // else status remains NEW
     }
 
+    publish_bbo(book);
     r.success = true;
     r.order = *raw;
-    return r;
+}
+
+// The unmatched remainder of an order that does not rest
+void MatchingEngine::cancel_remainder(Order* raw) {
+    raw->status = OrderStatus::CANCELLED;
+    log_event(EventType::ORDER_CANCELLED, nlohmann::json{{"order_id", raw->id}});
+}
+
+// Rejects an order that was already journaled as placed, so replay knows
+// not to rest it
+void MatchingEngine::reject_placed(OrderBook& book, Order* raw, PlaceOrderResult& r,
+                                   ErrorCode code) {
+    raw->status = OrderStatus::REJECTED;
+    log_event(EventType::ORDER_REJECTED, nlohmann::json{{"order_id", raw->id},
+                                                        {"error_code", code}});
+    r.success = false;
+    r.error_code = code;
+    stats_.total_rejects++;
+    r.order = *raw;
+    publish_bbo(book);
+}
+
+// Pre-trade time-in-force checks; false if the order must not match. FOK
+// sums level totals up to its limit (the collar for market orders) without
+// touching the book. A crossing post-only order is refused, or slid one
+// tick behind the opposite touch and journaled as modified.
+bool MatchingEngine::admit_time_in_force(OrderBook& book, Order* incoming,
+                                         const PriceCollar& collar) {
+    const bool buy = incoming->side == Side::BUY;
+
+    if (incoming->time_in_force == TimeInForce::FOK) {
+        int64_t limit = incoming->type == OrderType::LIMIT ? incoming->price
+                        : buy                              ? collar.hi
+                                                           : collar.lo;
+        // The account's own orders never fill it, so only when it has some
+        // on the other side are the levels walked order by order. Modes that
+        // carry on past them count what lies behind.
+        AccountExposure own = risk_checker_.exposure(incoming->account_id, incoming->symbol);
+        bool self_cross = (buy ? own.open_sell_qty : own.open_buy_qty) > 0;
+        bool pass_own = incoming->self_trade_prevention == SelfTradePrevention::SKIP ||
+                        incoming->self_trade_prevention == SelfTradePrevention::CANCEL_RESTING;
+        int64_t fillable = book.fillable_qty(incoming->side, limit, incoming->remaining_qty,
+                                             self_cross ? &incoming->account_id : nullptr,
+                                             pass_own);
+        if (fillable < incoming->remaining_qty) {
+            match_stop_ = ErrorCode::FOK_NOT_FILLABLE;
+            return false;
+        }
+        return true;
+    }
+
+    if (!incoming->is_post_only()) return true;
+
+    auto touch = buy ? book.best_ask_price() : book.best_bid_price();
+    if (touch && (buy ? incoming->price >= *touch : incoming->price <= *touch)) {
+        int64_t tick = risk_checker_.symbol_limits(risk_checker_.symbol_id(incoming->symbol))
+                           .tick_size;
+        int64_t slid = buy ? *touch - tick : *touch + tick;
+        if (incoming->time_in_force == TimeInForce::POST_ONLY || slid <= 0) {
+            match_stop_ = ErrorCode::POST_ONLY_WOULD_CROSS;
+            return false;
+        }
+        incoming->price = slid;
+        log_event(EventType::ORDER_MODIFIED, nlohmann::json{{"order_id", incoming->id},
+                                                            {"price", slid},
+                                                            {"quantity", incoming->quantity}});
+    }
+    // A post-only order never takes liquidity
+    return false;
+}
+
+// Whether execute() would refuse a replacement outright, trading nothing:
+// a post-only order that would cross, or self-trade prevention that meets the
+// account's own orders first (CANCEL_INCOMING, CANCEL_BOTH) or finds nothing
+// else to trade with (SKIP). Checked while the original still rests, so a
+// refused modify leaves it untouched.
+ErrorCode MatchingEngine::admit_replacement(const OrderBook& book, const Order& candidate) const {
+    const bool buy = candidate.side == Side::BUY;
+    auto touch = buy ? book.best_ask_price() : book.best_bid_price();
+    if (!touch || (buy ? candidate.price < *touch : candidate.price > *touch)) {
+        return ErrorCode::NONE;
+    }
+
+    const SymbolLimits& limits =
+        risk_checker_.symbol_limits(risk_checker_.symbol_id(candidate.symbol));
+    if (candidate.is_post_only()) {
+        int64_t slid = buy ? *touch - limits.tick_size : *touch + limits.tick_size;
+        return candidate.time_in_force == TimeInForce::POST_ONLY || slid <= 0
+                   ? ErrorCode::POST_ONLY_WOULD_CROSS
+                   : ErrorCode::NONE;
+    }
+
+    bool refused = false;
+    switch (candidate.self_trade_prevention) {
+        case SelfTradePrevention::CANCEL_INCOMING:
+        case SelfTradePrevention::CANCEL_BOTH:
+            if (limits.allocation == Allocation::FIFO) {
+                refused = book.fillable_qty(candidate.side, candidate.price, 1,
+                                            &candidate.account_id) == 0;
+            } else {
+                // Pro-rata deals with every own order at the level first
+                const PriceLevel* level = book.level_from(buy ? Side::SELL : Side::BUY, *touch);
+                refused = std::any_of(level->orders.begin(), level->orders.end(), [&](Order* o) {
+                    return o->account_id == candidate.account_id;
+                });
+            }
+            break;
+        case SelfTradePrevention::SKIP:
+            refused = book.fillable_qty(candidate.side, candidate.price, 1,
+                                        &candidate.account_id, true) == 0;
+            break;
+        case SelfTradePrevention::CANCEL_RESTING:
+        case SelfTradePrevention::DECREMENT_AND_CANCEL:
+            break;
+    }
+    return refused ? ErrorCode::SELF_TRADE_PREVENTED : ErrorCode::NONE;
 }
 
 std::vector<Trade> MatchingEngine::match(Order* incoming) {
     std::vector<Trade> trades;
     auto& book = get_or_create_book(incoming->symbol);
 
-    while (incoming->remaining_qty > 0) {
-        // choose side to match against
-        std::vector<Order*> resting;
-        if (incoming->side == Side::BUY) {
-            resting = book.get_asks_at_best();
-        } else {
-            resting = book.get_bids_at_best();
-        }
+    // Fixed for the whole command so a sweep cannot walk the band along
+    // with its own fills
+    PriceCollar collar = risk_checker_.collar(incoming->symbol);
+    StopBook& stops = stop_books_[incoming->symbol];
+    const SymbolLimits& limits =
+        risk_checker_.symbol_limits(risk_checker_.symbol_id(incoming->symbol));
+    const Allocation allocation = limits.allocation;
+    const int64_t lot = limits.lot_size;
+    match_stop_ = ErrorCode::NONE;
+    if (incoming->time_in_force != TimeInForce::GTC &&
+        !admit_time_in_force(book, incoming, collar)) {
+        return trades;
+    }
 
-        if (resting.empty()) break;
+    // Single pass over the resting side: the level being matched and how
+    // many of the account's own orders at its front SKIP passed over
+    const bool buy = incoming->side == Side::BUY;
+    const Side resting_side = buy ? Side::SELL : Side::BUY;
+    int64_t cursor = buy ? INT64_MIN : INT64_MAX;
+    size_t skipped = 0;
 
-        Order* best = resting.front();
-        if (!best) break;
+    while (incoming->remaining_qty > 0) {
+        const PriceLevel* level = book.level_from(resting_side, cursor);
+        if (!level) break;
+        if (level->orders.front()->price != cursor) {
+            cursor = level->orders.front()->price;
+            skipped = 0;
+        }
+        if (skipped == level->orders.size()) {
+            // only own orders left at this price
+            cursor += buy ? 1 : -1;
+            continue;
+        }
+        Order* best = level->orders[skipped];
 
         // for limit orders ensure price is acceptable
         if (incoming->type == OrderType::LIMIT) {
-            if (incoming->side == Side::BUY && best->price > incoming->price) break;
-            if (incoming->side == Side::SELL && best->price < incoming->price) break;
+            if (buy && best->price > incoming->price) break;
+            if (!buy && best->price < incoming->price) break;
+        } else if (best->price < collar.lo || best->price > collar.hi) {
+            // market orders stop sweeping at the price collar
+            match_stop_ = ErrorCode::PRICE_OUT_OF_BAND;
+            break;
+        }
+
+        if (allocation != Allocation::FIFO) {
+            // Shares the level out in one go; 0 once only SKIPped own
+            // orders are left at this price
+            if (allocate_level(book, stops, *level, incoming, allocation, lot, skipped,
+                               trades) == 0) {
+                cursor += buy ? 1 : -1;
+            }
+            if (match_stop_ != ErrorCode::NONE) break;
+            continue;
         }
 
-        // Self-trade prevention: skip this match entirely
         if (incoming->account_id == best->account_id) {
-            // Don't match against own orders - break and let caller handle
+            if (!prevent_self_trade(book, incoming, best)) break;
+            if (incoming->self_trade_prevention == SelfTradePrevention::SKIP) ++skipped;
+            continue;
+        }
+
+        fill(book, stops, incoming, best, std::min(incoming->remaining_qty, best->shown_qty()),
+             trades);
+    }
+
+    return trades;
+}
+
+// Journals a trade and applies it to risk and the symbol's stops; the
+// caller updates the orders
+const Trade& MatchingEngine::record_trade(StopBook& stops, const std::string& symbol,
+                                          Order* buy, Order* sell, int64_t price, int64_t qty,
+                                          std::vector<Trade>& trades) {
+    Trade t;
+    t.id = next_trade_id_++;
+    t.symbol = symbol;
+    t.price = price;
+    t.quantity = qty;
+    t.timestamp_ns = command_ts_;
+    t.buy_order_id = buy->id;
+    t.sell_order_id = sell->id;
+    t.buyer_account_id = buy->account_id;
+    t.seller_account_id = sell->account_id;
+
+    trades.push_back(t);
+    trades_.push_back(t);
+    log_event(EventType::TRADE_EXECUTED, t);
+    stats_.total_trades++;
+    risk_checker_.on_trade(t);
+    stops.trigger(price, triggered_stops_);
+    return trades.back();
+}
+
+// Trades qty between the incoming order and one resting order, at the
+// resting order's price
+void MatchingEngine::fill(OrderBook& book, StopBook& stops, Order* incoming, Order* resting,
+                          int64_t qty, std::vector<Trade>& trades) {
+    const bool buy = incoming->side == Side::BUY;
+    const Trade& t = record_trade(stops, incoming->symbol, buy ? incoming : resting,
+                                  buy ? resting : incoming, resting->price, qty, trades);
+    if (feed_) feed_->publish(L3MessageType::EXECUTE, *resting, qty, t.id);
+    risk_checker_.on_unrest(*resting, qty);
+
+    // reduce quantities; an iceberg refill re-queues the resting order
+    incoming->consume(qty);
+    int64_t new_resting_remaining = resting->remaining_qty - qty;
+    book.update_order_qty(resting->id, new_resting_remaining);
+    if (new_resting_remaining == 0) unindex_order(*resting);
+}
+
+// Pro-rata allocation of the incoming order over one price level. The
+// account's own orders there are dealt with first by self-trade prevention
+// and left out of the split. If the incoming order covers everything else
+// shown at the level, each order is filled in time priority; otherwise each
+// gets remaining * shown / pool rounded down to the lot, with pool taken from
+// the level's cached total, and what rounding leaves goes out in time
+// priority. Trades are made in queue order, so the journal replays exactly.
+// skipped counts the own orders SKIP has passed over at this level: a
+// covered pool leaves them at its front, ahead of any iceberg refills, and
+// they are not offered to self-trade prevention again. Returns the pool;
+// match_stop_ is set if self-trade prevention stopped.
+int64_t MatchingEngine::allocate_level(OrderBook& book, StopBook& stops, const PriceLevel& level,
+                                       Order* incoming, Allocation allocation, int64_t lot,
+                                       size_t& skipped, std::vector<Trade>& trades) {
+    // Fills below remove orders and may free the level, so work from a copy
+    level_orders_.assign(level.orders.begin() + static_cast<ptrdiff_t>(skipped),
+                         level.orders.end());
+    int64_t pool = level.total_qty;
+    bool has_own = skipped > 0;
+    for (Order* o : level_orders_) has_own |= o->account_id == incoming->account_id;
+
+    if (has_own) {
+        for (Order* o : level_orders_) {
+            if (incoming->remaining_qty == 0 || match_stop_ != ErrorCode::NONE) break;
+            if (o->account_id != incoming->account_id) continue;
+            if (!prevent_self_trade(book, incoming, o)) return 0;
+        }
+        if (incoming->remaining_qty == 0 || match_stop_ != ErrorCode::NONE) return 0;
+        pool = 0;
+        auto own = std::remove_if(level_orders_.begin(), level_orders_.end(), [&](Order* o) {
+            return o->account_id == incoming->account_id;
+        });
+        if (incoming->self_trade_prevention == SelfTradePrevention::SKIP) {
+            skipped += static_cast<size_t>(level_orders_.end() - own);
+        }
+        level_orders_.erase(own, level_orders_.end());
+        for (Order* o : level_orders_) pool += o->shown_qty();
+        if (pool == 0) return 0;
+    }
+
+    if (incoming->remaining_qty >= pool) {
+        for (Order* o : level_orders_) fill(book, stops, incoming, o, o->shown_qty(), trades);
+        return pool;
+    }
+
+    level_alloc_.assign(level_orders_.size(), 0);
+    int64_t left = incoming->remaining_qty;
+    int64_t split = pool;
+    size_t first = 0;
+    if (allocation == Allocation::FIFO_PRO_RATA) {
+        // Top order priority: the front of the level fills before the split
+        level_alloc_[0] = std::min(left, level_orders_[0]->shown_qty());
+        left -= level_alloc_[0];
+        split -= level_orders_[0]->shown_qty();
+        first = 1;
+    }
+
+    const int64_t to_split = left;
+    for (size_t i = first; i < level_orders_.size() && to_split > 0; ++i) {
+        int64_t share = div_u64(mul_u64(static_cast<uint64_t>(to_split),
+                                        static_cast<uint64_t>(level_orders_[i]->shown_qty())),
+                                static_cast<uint64_t>(split));
+        share -= share % lot;
+        level_alloc_[i] = share;
+        left -= share;
+    }
+    for (size_t i = first; i < level_orders_.size() && left > 0; ++i) {
+        int64_t extra = std::min(left, level_orders_[i]->shown_qty() - level_alloc_[i]);
+        level_alloc_[i] += extra;
+        left -= extra;
+    }
+
+    for (size_t i = 0; i < level_orders_.size(); ++i) {
+        if (level_alloc_[i] == 0) continue;
+        fill(book, stops, incoming, level_orders_[i], level_alloc_[i], trades);
+    }
+    return pool;
+}
+
+// Applies the incoming order's self-trade prevention mode to one of the
+// account's own resting orders; false once the incoming order stops. Every
+// mode that changes an order is journaled as SELF_TRADE_PREVENTED; what is
+// left of a stopped incoming order is cancelled by execute().
+bool MatchingEngine::prevent_self_trade(OrderBook& book, Order* incoming, Order* resting) {
+    const SelfTradePrevention mode = incoming->self_trade_prevention;
+    stats_.self_trade_prevented[static_cast<size_t>(mode)]++;
+
+    int64_t qty = 0;
+    switch (mode) {
+        case SelfTradePrevention::SKIP:
+            return true;
+        case SelfTradePrevention::CANCEL_INCOMING:
+            match_stop_ = ErrorCode::SELF_TRADE_PREVENTED;
+            return false;
+        case SelfTradePrevention::DECREMENT_AND_CANCEL:
+            qty = std::min(incoming->remaining_qty, resting->remaining_qty);
+            break;
+        case SelfTradePrevention::CANCEL_RESTING:
+        case SelfTradePrevention::CANCEL_BOTH:
             break;
+    }
+    log_event(EventType::SELF_TRADE_PREVENTED, nlohmann::json{{"incoming_order_id", incoming->id},
+                                                              {"resting_order_id", resting->id},
+                                                              {"mode", mode},
+                                                              {"quantity", qty}});
+
+    if (mode == SelfTradePrevention::DECREMENT_AND_CANCEL) {
+        // Taken off both orders' size rather than filled
+        incoming->quantity -= qty;
+        incoming->shrink(incoming->remaining_qty - qty);
+        if (incoming->remaining_qty == 0) match_stop_ = ErrorCode::SELF_TRADE_PREVENTED;
+        resting->quantity -= qty;
+        if (resting->remaining_qty > qty) {
+            risk_checker_.on_unrest(*resting, qty);
+            book.reduce_order_qty(resting->id, resting->remaining_qty - qty);
+            return true;
         }
+    }
 
-        int64_t qty = std::min(incoming->remaining_qty, best->remaining_qty);
+    remove_resting(book, *resting);
+    resting->remaining_qty -= qty;
+    resting->status = OrderStatus::CANCELLED;
+    stats_.total_cancels++;
+    if (mode == SelfTradePrevention::CANCEL_BOTH) {
+        match_stop_ = ErrorCode::SELF_TRADE_PREVENTED;
+        return false;
+    }
+    return true;
+}
 
-        Trade t;
-        t.id = next_trade_id_++;
-        t.symbol = incoming->symbol;
-        t.price = best->price;  // Trade at resting order's price
-        t.quantity = qty;
-        t.timestamp_ns = now_ns();
+PlaceOrderResult MatchingEngine::modify_order(uint64_t order_id, int64_t new_price,
+                                              int64_t new_quantity) {
+    EXCHANGE_LATENCY_SCOPE(latency_, LatencyStage::PLACE_ORDER);
+    EventBatch batch{event_log_, latency_, bbo_flush_, bbo_published_};
+    begin_command();
+    PlaceOrderResult r;
 
-        if (incoming->side == Side::BUY) {
-            t.buy_order_id = incoming->id;
-            t.sell_order_id = best->id;
-            t.buyer_account_id = incoming->account_id;
-            t.seller_account_id = best->account_id;
-        } else {
-            t.buy_order_id = best->id;
-            t.sell_order_id = incoming->id;
-            t.buyer_account_id = best->account_id;
-            t.seller_account_id = incoming->account_id;
+    // only resting limit orders can be modified
+    auto it = orders_.find(order_id);
+    Order* ord = it == orders_.end() ? nullptr : it->second.get();
+    OrderBook* book = ord ? get_book(ord->symbol) : nullptr;
+    if (!ord || !ord->is_active() || !book || !book->get_order(order_id)) {
+        r.success = false;
+        r.error_code = ErrorCode::ORDER_NOT_FOUND;
+        return r;
+    }
+    r.order = *ord;
+
+    const SymbolState state = symbol_state(ord->symbol);
+    if (state == SymbolState::HALTED || state == SymbolState::CLOSED) {
+        r.success = false;
+        r.error_code = admit_state(*ord, state);
+        stats_.total_rejects++;
+        return r;
+    }
+
+    int64_t new_remaining = new_quantity - ord->filled_qty();
+    if (new_remaining <= 0) {
+        r.success = false;
+        r.error_code = ErrorCode::INVALID_QUANTITY;
+        stats_.total_rejects++;
+        return r;
+    }
+
+    // The replacement is checked as a new order for its remaining quantity
+    Order candidate = *ord;
+    candidate.price = new_price;
+    candidate.quantity = new_remaining;
+
+    bool in_place = new_price == ord->price && new_remaining <= ord->remaining_qty;
+    if (in_place) {
+        // A reduction adds no exposure, but must still be a valid size
+        auto risk = risk_checker_.check_quantity(candidate);
+        if (!risk.passed) {
+            r.success = false;
+            r.error_code = risk.error_code;
+            stats_.total_rejects++;
+            return r;
+        }
+    } else {
+        // Only reductions get past the kill switch
+        if (!blocked_accounts_.empty() && blocked_accounts_.count(ord->account_id)) {
+            r.success = false;
+            r.error_code = ErrorCode::ACCOUNT_BLOCKED;
+            stats_.total_rejects++;
+            return r;
         }
 
-        // record trade
-        trades.push_back(t);
-        trades_.push_back(t);
-        log_event(EventType::TRADE_EXECUTED, t);
-        stats_.total_trades++;
+        // Everything else is checked with the original's exposure taken out
+        EXCHANGE_LATENCY_BEGIN(latency_, risk_start);
+        risk_checker_.on_unrest(*ord, ord->remaining_qty);
+        auto risk = risk_checker_.check_order(candidate);
+        risk_checker_.on_rest(*ord);
+        EXCHANGE_LATENCY_END(latency_, LatencyStage::RISK_CHECK, risk_start);
+        if (!risk.passed) {
+            r.success = false;
+            r.error_code = risk.error_code;
+            stats_.total_rejects++;
+            return r;
+        }
 
-        // reduce quantities
-        incoming->remaining_qty -= qty;
-        int64_t new_best_remaining = best->remaining_qty - qty;
-        book.update_order_qty(best->id, new_best_remaining);
+        // Refusals execute() would make are caught before the original
+        // leaves the book, so it keeps its place
+        ErrorCode refused = state == SymbolState::CONTINUOUS
+                                ? admit_replacement(*book, candidate)
+                                : ErrorCode::NONE;
+        if (refused != ErrorCode::NONE) {
+            r.success = false;
+            r.error_code = refused;
+            stats_.total_rejects++;
+            return r;
+        }
     }
 
-    return trades;
+    // One event covers the amendment; replay re-derives which path it took
+    log_event(EventType::ORDER_MODIFIED, nlohmann::json{{"order_id", order_id},
+                                                        {"price", new_price},
+                                                        {"quantity", new_quantity}});
+
+    if (in_place) {
+        risk_checker_.on_unrest(*ord, ord->remaining_qty - new_remaining);
+        book->reduce_order_qty(order_id, new_remaining);
+        ord->quantity = new_quantity;
+        publish_bbo(*book);
+        r.success = true;
+        r.order = *ord;
+        return r;
+    }
+
+    remove_resting(*book, *ord);
+    ord->price = new_price;
+    ord->quantity = new_quantity;
+    ord->remaining_qty = new_remaining;
+    ord->reset_display();
+    ord->timestamp_ns = command_ts_;
+    execute(ord, r, state);
+    fire_stops();
+    return r;
 }
 
 CancelOrderResult MatchingEngine::cancel_order(uint64_t order_id) {
+    EventBatch batch{event_log_, latency_, bbo_flush_, bbo_published_};
+    begin_command();
     CancelOrderResult res{};
 
     auto it = orders_.find(order_id);
@@ -197,45 +798,396 @@ CancelOrderResult MatchingEngine::cancel_order(uint64_t order_id) {
 
     Order& ord = *it->second;
 
-    // Only allow cancel if it's still live (NEW or PARTIAL are active)
-    if (ord.status == OrderStatus::FILLED ||
-        ord.status == OrderStatus::CANCELLED ||
-        ord.status == OrderStatus::REJECTED) {
+    // Only allow cancel if it's still live
+    if (!ord.is_active()) {
         res.success = false;
         res.error_code = ErrorCode::ORDER_NOT_FOUND;
         res.order = ord;
         return res;
     }
 
-    auto* book = get_book(ord.symbol);
-    if (book) {
-        book->remove_order(order_id);
-    }
-
+    remove_open(ord);
     ord.status = OrderStatus::CANCELLED;
 
     // Log cancellation event
     log_event(EventType::ORDER_CANCELLED, nlohmann::json{{"order_id", order_id}});
     stats_.total_cancels++;
+    if (auto* book = get_book(ord.symbol)) publish_bbo(*book);
 
     res.success = true;
     res.order = ord;
     return res;
 }
 
+CancelOrderResult MatchingEngine::cancel_order(const std::string& account_id,
+                                                const std::string& client_order_id) {
+    uint64_t order_id = find_client_order(account_id, client_order_id);
+    if (order_id == 0) {
+        CancelOrderResult res{};
+        res.error_code = ErrorCode::ORDER_NOT_FOUND;
+        return res;
+    }
+    return cancel_order(order_id);
+}
+
+MassCancelResult MatchingEngine::mass_cancel(const MassCancelRequest& request) {
+    EventBatch batch{event_log_, latency_, bbo_flush_, bbo_published_};
+    begin_command();
+    MassCancelResult res;
+
+    std::vector<Order*> targets;
+    if (!request.account_id.empty()) {
+        auto it = account_orders_.find(request.account_id);
+        if (it != account_orders_.end()) {
+            for (Order* o : it->second) {
+                if (request.symbol.empty() || o->symbol == request.symbol) targets.push_back(o);
+            }
+        }
+    } else {
+        for (auto& [symbol, book] : books_) {
+            if (!request.symbol.empty() && symbol != request.symbol) continue;
+            for (Order* o : book->get_all_bids()) targets.push_back(o);
+            for (Order* o : book->get_all_asks()) targets.push_back(o);
+        }
+        for (auto& [symbol, stops] : stop_books_) {
+            if (!request.symbol.empty() && symbol != request.symbol) continue;
+            for (Order* o : stops.get_all()) targets.push_back(o);
+        }
+    }
+    // Ascending ids keep the journal and the L3 feed deterministic
+    std::sort(targets.begin(), targets.end(),
+              [](const Order* a, const Order* b) { return a->id < b->id; });
+
+    res.order_ids.reserve(targets.size());
+    for (Order* o : targets) {
+        remove_open(*o);
+        o->status = OrderStatus::CANCELLED;
+        res.order_ids.push_back(o->id);
+    }
+
+    bool block = request.block && !request.account_id.empty();
+    if (block) blocked_accounts_.insert(request.account_id);
+
+    // One event for the whole batch
+    if (!res.order_ids.empty() || block) {
+        log_event(EventType::MASS_CANCEL, nlohmann::json{{"order_ids", res.order_ids},
+                                                         {"account_id", request.account_id},
+                                                         {"symbol", request.symbol},
+                                                         {"block", block}});
+    }
+    stats_.total_cancels += res.order_ids.size();
+    for (auto& [symbol, book] : books_) {
+        if (request.symbol.empty() || symbol == request.symbol) publish_bbo(*book);
+    }
+
+    res.success = true;
+    return res;
+}
+
+bool MatchingEngine::unblock_account(const std::string& account_id) {
+    EventBatch batch{event_log_, latency_, bbo_flush_, bbo_published_};
+    begin_command();
+    if (blocked_accounts_.erase(account_id) == 0) return false;
+    log_event(EventType::ACCOUNT_UNBLOCKED, nlohmann::json{{"account_id", account_id}});
+    return true;
+}
+
+namespace {
+
+// Phases each state may move to, as bits indexed by SymbolState
+constexpr uint8_t bit(SymbolState s) { return uint8_t{1} << static_cast<int>(s); }
+constexpr uint8_t ALLOWED_TRANSITIONS[] = {
+    // PRE_OPEN
+    bit(SymbolState::CONTINUOUS) | bit(SymbolState::AUCTION) | bit(SymbolState::HALTED) |
+        bit(SymbolState::CLOSED),
+    // CONTINUOUS
+    bit(SymbolState::AUCTION) | bit(SymbolState::HALTED) | bit(SymbolState::CLOSED),
+    // AUCTION
+    bit(SymbolState::CONTINUOUS) | bit(SymbolState::HALTED) | bit(SymbolState::CLOSED),
+    // HALTED
+    bit(SymbolState::PRE_OPEN) | bit(SymbolState::CONTINUOUS) | bit(SymbolState::AUCTION) |
+        bit(SymbolState::CLOSED),
+    // CLOSED
+    bit(SymbolState::PRE_OPEN) | bit(SymbolState::CONTINUOUS),
+};
+
+}  // namespace
+
+SymbolStateResult MatchingEngine::set_symbol_state(const std::string& symbol,
+                                                   SymbolState state) {
+    EventBatch batch{event_log_, latency_, bbo_flush_, bbo_published_};
+    begin_command();
+    SymbolStateResult res;
+    res.state = symbol_state(symbol);
+    if (!risk_checker_.is_valid_symbol(symbol)) {
+        res.error_code = ErrorCode::INVALID_SYMBOL;
+        return res;
+    }
+    if (!(ALLOWED_TRANSITIONS[static_cast<int>(res.state)] & bit(state))) {
+        res.error_code = ErrorCode::INVALID_STATE_TRANSITION;
+        return res;
+    }
+
+    apply_symbol_state(symbol, state);
+    log_event(EventType::SYMBOL_STATE_CHANGED, nlohmann::json{{"symbol", symbol},
+                                                              {"state", state}});
+    res.state = state;
+    res.success = true;
+
+    // Orders may have crossed while the symbol was not matching
+    auto* book = get_book(symbol);
+    if (state == SymbolState::CONTINUOUS && book && book->is_crossed()) uncross(*book, res);
+    return res;
+}
+
+void MatchingEngine::apply_symbol_state(const std::string& symbol, SymbolState state) {
+    uint32_t id = state_ids_.add(symbol);
+    if (id >= symbol_states_.size()) symbol_states_.resize(id + 1, SymbolState::CONTINUOUS);
+    symbol_states_[id] = state;
+}
+
+// Trades everything a crossed book can at the auction price, within the
+// state change's command, so the trades reach the journal in one flush.
+// Orders trade in price-time priority on each side, iceberg reserves
+// included. Self-trade prevention does not apply. Stops the trades trigger
+// fire afterwards, under continuous matching.
+void MatchingEngine::uncross(OrderBook& book, SymbolStateResult& res) {
+    const std::string& symbol = book.symbol();
+    StopBook& stops = stop_books_[symbol];
+    res.uncross = book.auction_price(stops.last_price());
+    log_event(EventType::AUCTION_UNCROSSED, nlohmann::json{{"symbol", symbol},
+                                                           {"price", res.uncross.price},
+                                                           {"volume", res.uncross.volume}});
+
+    // The orders that trade on one side, best first, gathered before any
+    // fill changes the queues
+    auto take = [&](Side side, std::vector<Order*>& out) {
+        int64_t left = res.uncross.volume;
+        int64_t price = side == Side::BUY ? INT64_MAX : INT64_MIN;
+        while (left > 0) {
+            const PriceLevel* level = book.level_from(side, price);
+            for (auto it = level->orders.begin(); it != level->orders.end() && left > 0; ++it) {
+                out.push_back(*it);
+                left -= (*it)->remaining_qty;
+            }
+            price = level->orders.front()->price + (side == Side::BUY ? -1 : 1);
+        }
+    };
+    std::vector<Order*> buys;
+    std::vector<Order*> sells;
+    take(Side::BUY, buys);
+    take(Side::SELL, sells);
+
+    int64_t left = res.uncross.volume;
+    for (size_t b = 0, s = 0; left > 0;) {
+        Order* buy = buys[b];
+        Order* sell = sells[s];
+        int64_t qty = std::min({left, buy->remaining_qty, sell->remaining_qty});
+        const Trade& t = record_trade(stops, symbol, buy, sell, res.uncross.price, qty,
+                                      res.trades);
+        for (Order* o : {buy, sell}) {
+            if (feed_) feed_->publish(L3MessageType::EXECUTE, *o, qty, t.id);
+            risk_checker_.on_unrest(*o, qty);
+            book.update_order_qty(o->id, o->remaining_qty - qty);
+            if (o->remaining_qty == 0) unindex_order(*o);
+        }
+        b += buy->remaining_qty == 0;
+        s += sell->remaining_qty == 0;
+        left -= qty;
+    }
+
+    publish_bbo(book);
+    fire_stops();
+}
+
+void MatchingEngine::set_risk_limits(RiskLimits limits) {
+    risk_checker_ = RiskChecker(std::move(limits));
+    rebuild_resting_state();
+}
+
+void MatchingEngine::rest_order(OrderBook& book, Order* order) {
+    book.add_order(order);
+    risk_checker_.on_rest(*order);
+    index_order(*order);
+}
+
+// Takes a resting order off the book and out of every index; false if it
+// was not resting
+bool MatchingEngine::remove_resting(OrderBook& book, Order& order) {
+    if (!book.remove_order(order.id)) return false;
+    risk_checker_.on_unrest(order, order.remaining_qty);
+    unindex_order(order);
+    return true;
+}
+
+// remove_resting for any open order, including untriggered stops
+bool MatchingEngine::remove_open(Order& order) {
+    if (order.is_stop()) {
+        auto it = stop_books_.find(order.symbol);
+        if (it == stop_books_.end() || !it->second.remove(order.id)) return false;
+        risk_checker_.on_unrest(order, order.remaining_qty);
+        unindex_order(order);
+        return true;
+    }
+    auto* book = get_book(order.symbol);
+    return book && remove_resting(*book, order);
+}
+
+void MatchingEngine::index_order(Order& order) {
+    account_orders_[order.account_id].insert(&order);
+    if (!order.client_order_id.empty()) {
+        client_order_ids_[order.account_id][order.client_order_id] = order.id;
+    }
+}
+
+void MatchingEngine::unindex_order(Order& order) {
+    auto it = account_orders_.find(order.account_id);
+    if (it == account_orders_.end()) return;
+    it->second.erase(&order);
+    if (it->second.empty()) account_orders_.erase(it);
+    if (order.client_order_id.empty()) return;
+    auto ids = client_order_ids_.find(order.account_id);
+    if (ids == client_order_ids_.end()) return;
+    ids->second.erase(order.client_order_id);
+    if (ids->second.empty()) client_order_ids_.erase(ids);
+}
+
+// Id of the account's open order with that client id, 0 if none
+uint64_t MatchingEngine::find_client_order(const std::string& account_id,
+                                           const std::string& client_order_id) const {
+    auto ids = client_order_ids_.find(account_id);
+    if (ids == client_order_ids_.end()) return 0;
+    auto it = ids->second.find(client_order_id);
+    return it == ids->second.end() ? 0 : it->second;
+}
+
+// Net positions and last trade prices over every trade: the snapshot's
+// totals plus the trades journaled since
+void MatchingEngine::trade_totals(Snapshot::Positions& positions,
+                                  std::map<std::string, int64_t>& last_prices) const {
+    positions = snapshot_positions_;
+    last_prices = snapshot_last_prices_;
+    for (const auto& t : trades_) {
+        positions[t.buyer_account_id][t.symbol] += t.quantity;
+        positions[t.seller_account_id][t.symbol] -= t.quantity;
+        last_prices[t.symbol] = t.price;
+    }
+}
+
+// Recomputes what is derived from resting orders and trades (account and
+// client id indexes, risk exposure, reference prices), e.g. after replay
+void MatchingEngine::rebuild_resting_state() {
+    risk_checker_.reset_exposure();
+    account_orders_.clear();
+    client_order_ids_.clear();
+    std::vector<Order*> open;
+    for (const auto& [id, order] : orders_) {
+        if (!order) continue;
+        order->account_prev = order->account_next = nullptr;
+        if (!order->is_active()) continue;
+        auto* book = get_book(order->symbol);
+        if (!book || !book->get_order(id)) continue;
+        risk_checker_.on_rest(*order);
+        open.push_back(order.get());
+    }
+    for (const auto& [symbol, stops] : stop_books_) {
+        for (Order* o : stops.get_all()) {
+            risk_checker_.on_rest(*o);
+            open.push_back(o);
+        }
+    }
+    // orders_ is unordered; sorted, every insert links at the back
+    std::sort(open.begin(), open.end(),
+              [](const Order* a, const Order* b) { return a->id < b->id; });
+    for (Order* o : open) index_order(*o);
+    // Deadlines of every open order, whether resting or an untriggered stop
+    expiries_.clear();
+    for (const auto& [account, orders] : account_orders_) {
+        for (const Order* o : orders) {
+            if (o->expire_ts_ns != 0) expiries_.schedule(o->id, o->expire_ts_ns);
+        }
+    }
+    Snapshot::Positions positions;
+    std::map<std::string, int64_t> last_prices;
+    trade_totals(positions, last_prices);
+    for (const auto& [account, symbols] : positions) {
+        for (const auto& [symbol, qty] : symbols) risk_checker_.add_position(account, symbol, qty);
+    }
+    for (const auto& [symbol, price] : last_prices) {
+        risk_checker_.set_last_trade(symbol, price);
+        stop_books_[symbol].set_last_price(price);
+    }
+    for (const auto& [symbol, book] : books_) risk_checker_.on_bbo(symbol, book->bbo());
+}
+
+void MatchingEngine::begin_command() {
+    command_ts_ = now_ns();
+    if (feed_) feed_->set_timestamp(command_ts_);
+    if (!expiries_.empty()) expire_orders();
+}
+
+// Closes every open order whose deadline has passed, as one ORDERS_EXPIRED
+// event; the wheel hands over only the timers due, so the cost follows the
+// number expired rather than the number open
+void MatchingEngine::expire_orders() {
+    expired_.clear();
+    expiries_.advance(command_ts_, expired_);
+    if (expired_.empty()) return;
+
+    std::vector<Order*> targets;
+    for (uint64_t id : expired_) {
+        auto it = orders_.find(id);
+        if (it == orders_.end() || !it->second) continue;
+        Order* o = it->second.get();
+        // Filled or cancelled since it was scheduled
+        if (!o->is_active()) continue;
+        targets.push_back(o);
+    }
+    if (targets.empty()) return;
+    // Ascending ids keep the journal and the L3 feed deterministic
+    std::sort(targets.begin(), targets.end(),
+              [](const Order* a, const Order* b) { return a->id < b->id; });
+
+    std::vector<uint64_t> ids;
+    ids.reserve(targets.size());
+    for (Order* o : targets) {
+        remove_open(*o);
+        o->status = OrderStatus::EXPIRED;
+        ids.push_back(o->id);
+    }
+    log_event(EventType::ORDERS_EXPIRED, nlohmann::json{{"order_ids", ids}});
+    stats_.total_cancels += ids.size();
+    for (Order* o : targets) {
+        if (auto* book = get_book(o->symbol)) publish_bbo(*book);
+    }
+}
+
 OrderBook& MatchingEngine::get_or_create_book(const std::string& symbol) {
     auto it = books_.find(symbol);
     if (it == books_.end()) {
         books_[symbol] = std::make_unique<OrderBook>(symbol);
+        books_[symbol]->set_feed(feed_);
     }
     return *books_[symbol];
 }
 
+void MatchingEngine::set_market_data_feed(MarketDataFeed* feed) {
+    feed_ = feed;
+    for (auto& [_, book] : books_) {
+        book->set_feed(feed);
+    }
+}
+
 OrderBook* MatchingEngine::get_book(const std::string& symbol) {
     auto it = books_.find(symbol);
     return it == books_.end() ? nullptr : it->second.get();
 }
 
+const StopBook* MatchingEngine::get_stop_book(const std::string& symbol) const {
+    auto it = stop_books_.find(symbol);
+    return it == stop_books_.end() ? nullptr : &it->second;
+}
+
 std::optional<Order> MatchingEngine::get_order(uint64_t order_id) const {
     auto it = orders_.find(order_id);
     if (it == orders_.end()) return std::nullopt;
@@ -243,6 +1195,25 @@ std::optional<Order> MatchingEngine::get_order(uint64_t order_id) const {
     return *it->second;
 }
 
+std::optional<Order> MatchingEngine::get_order(const std::string& account_id,
+                                              const std::string& client_order_id) const {
+    uint64_t order_id = find_client_order(account_id, client_order_id);
+    if (order_id == 0) return std::nullopt;
+    return get_order(order_id);
+}
+
+std::vector<Order> MatchingEngine::get_open_orders(const std::string& account_id,
+                                                  const std::string& symbol) const {
+    std::vector<Order> out;
+    auto it = account_orders_.find(account_id);
+    if (it == account_orders_.end()) return out;
+    out.reserve(it->second.size());
+    for (const Order* o : it->second) {
+        if (symbol.empty() || o->symbol == symbol) out.push_back(*o);
+    }
+    return out;
+}
+
 std::vector<Trade> MatchingEngine::get_trades(const std::string& symbol, size_t limit) const {
     std::vector<Trade> out;
     if (limit == 0) return out;
@@ -262,16 +1233,31 @@ std::vector<Trade> MatchingEngine::get_trades(const std::string& symbol, size_t
 EngineStats MatchingEngine::get_stats() const {
     EngineStats s = stats_;
     s.event_sequence = event_log_.current_sequence();
+    s.idempotency_keys = idempotency_.size();
+    s.idempotency_bytes = idempotency_.memory_bytes();
     return s;
 }
 
-void MatchingEngine::log_event(EventType type, const nlohmann::json& payload) {
+template <typename Payload>
+void MatchingEngine::log_event(EventType type, const Payload& payload) {
+    EXCHANGE_LATENCY_BEGIN(latency_, log_start);
     Event e;
     e.sequence = event_log_.next_sequence();
-    e.timestamp_ns = now_ns();
+    e.timestamp_ns = command_ts_;
     e.type = type;
     e.payload = payload;
     event_log_.append(e);
+    EXCHANGE_LATENCY_ACCRUE(latency_, LatencyStage::EVENT_LOG, log_start);
+}
+
+void MatchingEngine::publish_bbo(OrderBook& book) {
+    // Only emit when the top actually moved since the last notification
+    if (!book.poll_bbo_change()) return;
+    risk_checker_.on_bbo(book.symbol(), book.bbo());
+    if (bbo_listener_) {
+        bbo_listener_(book.symbol(), book.bbo(), command_ts_);
+        bbo_published_ = true;
+    }
 }
 
 bool MatchingEngine::recover() {
@@ -282,7 +1268,12 @@ bool MatchingEngine::recover() {
         // Restore from snapshot
         orders_.clear();
         books_.clear();
-        idempotency_keys_.clear();
+        stop_books_.clear();
+        idempotency_.restore(snap->idempotency_keys);
+        blocked_accounts_ = {snap->blocked_accounts.begin(), snap->blocked_accounts.end()};
+        for (const auto& [symbol, state] : snap->symbol_states) apply_symbol_state(symbol, state);
+        snapshot_positions_ = snap->positions;
+        snapshot_last_prices_ = snap->last_trade_prices;
 
         for (const auto& o : snap->orders) {
             auto ptr = std::make_unique<Order>(o);
@@ -292,14 +1283,11 @@ bool MatchingEngine::recover() {
             if (o.status == OrderStatus::NEW || o.status == OrderStatus::PARTIAL) {
                 if (o.remaining_qty > 0 && o.type == OrderType::LIMIT) {
                     get_or_create_book(o.symbol).add_order(raw);
+                } else if (o.is_stop()) {
+                    stop_books_[o.symbol].add(raw);
                 }
             }
             
-            // Track idempotency keys
-            if (!o.idempotency_key.empty()) {
-                idempotency_keys_.insert(o.idempotency_key);
-            }
-            
             orders_[o.id] = std::move(ptr);
         }
 
@@ -343,10 +1331,13 @@ void MatchingEngine::replay_events(const std::vector<Event>& events) {
                 if ((order.status == OrderStatus::NEW || order.status == OrderStatus::PARTIAL) &&
                     order.type == OrderType::LIMIT && order.remaining_qty > 0) {
                     get_or_create_book(order.symbol).add_order(raw);
+                } else if (order.is_active() && order.is_stop()) {
+                    stop_books_[order.symbol].add(raw);
                 }
                 
                 if (!order.idempotency_key.empty()) {
-                    idempotency_keys_.insert(order.idempotency_key);
+                    idempotency_.insert(IdempotencyStore::fingerprint(order.idempotency_key),
+                                        order.id, event.timestamp_ns);
                 }
                 
                 orders_[order.id] = std::move(ptr);
@@ -366,10 +1357,155 @@ void MatchingEngine::replay_events(const std::vector<Event>& events) {
                     if (book) {
                         book->remove_order(order_id);
                     }
+                    auto stops = stop_books_.find(it->second->symbol);
+                    if (stops != stop_books_.end()) stops->second.remove(order_id);
                 }
                 break;
             }
+
+            case EventType::STOP_TRIGGERED: {
+                uint64_t order_id = event.payload.value("order_id", 0ULL);
+                auto it = orders_.find(order_id);
+                if (it == orders_.end() || !it->second) break;
+                Order& o = *it->second;
+                auto stops = stop_books_.find(o.symbol);
+                if (stops != stop_books_.end()) stops->second.remove(order_id);
+                o.type = o.type == OrderType::STOP ? OrderType::MARKET : OrderType::LIMIT;
+                o.timestamp_ns = event.timestamp_ns;
+                // Booked like a placed limit order; the events that follow
+                // fill, cancel or reject it
+                if (o.type == OrderType::LIMIT && o.is_active() && o.remaining_qty > 0) {
+                    get_or_create_book(o.symbol).add_order(&o);
+                }
+                break;
+            }
+
+            case EventType::ORDER_REJECTED: {
+                // Placed, then refused after matching; it never rested
+                uint64_t order_id = event.payload.value("order_id", 0ULL);
+                auto it = orders_.find(order_id);
+                if (it == orders_.end() || !it->second) break;
+                it->second->status = OrderStatus::REJECTED;
+                if (auto* book = get_book(it->second->symbol)) book->remove_order(order_id);
+                break;
+            }
+
+            case EventType::ORDER_MODIFIED: {
+                uint64_t order_id = event.payload.value("order_id", 0ULL);
+                auto it = orders_.find(order_id);
+                if (it == orders_.end() || !it->second) break;
+                Order& o = *it->second;
+                int64_t price = event.payload.at("price").get<int64_t>();
+                int64_t quantity = event.payload.at("quantity").get<int64_t>();
+                int64_t remaining = quantity - o.filled_qty();
+                auto* book = get_book(o.symbol);
+
+                if (price == o.price && remaining <= o.remaining_qty) {
+                    if (book) book->reduce_order_qty(order_id, remaining);
+                } else {
+                    // Re-queued at the back; the trades that follow reduce it
+                    if (book) book->remove_order(order_id);
+                    o.price = price;
+                    o.timestamp_ns = event.timestamp_ns;
+                    o.remaining_qty = remaining;
+                    o.reset_display();
+                    if (o.is_active() && remaining > 0) {
+                        get_or_create_book(o.symbol).add_order(&o);
+                    }
+                }
+                o.quantity = quantity;
+                o.remaining_qty = remaining;
+                break;
+            }
+
+            case EventType::SELF_TRADE_PREVENTED: {
+                auto mode = event.payload.at("mode").get<SelfTradePrevention>();
+                int64_t qty = event.payload.value("quantity", int64_t{0});
+                auto apply = [&](uint64_t order_id, bool resting) {
+                    auto it = orders_.find(order_id);
+                    if (it == orders_.end() || !it->second) return;
+                    Order& o = *it->second;
+                    auto* book = get_book(o.symbol);
+                    if (mode == SelfTradePrevention::DECREMENT_AND_CANCEL) {
+                        // The incoming order may be on the book here, since
+                        // replay books limit orders when placed
+                        o.quantity -= qty;
+                        int64_t remaining = o.remaining_qty - qty;
+                        if (book && remaining > 0) {
+                            book->reduce_order_qty(order_id, remaining);
+                        } else if (book) {
+                            book->remove_order(order_id);
+                        }
+                        o.remaining_qty = remaining;
+                        if (remaining == 0) o.status = OrderStatus::CANCELLED;
+                    } else if (resting) {
+                        o.status = OrderStatus::CANCELLED;
+                        if (book) book->remove_order(order_id);
+                    }
+                };
+                apply(event.payload.value("incoming_order_id", 0ULL), false);
+                apply(event.payload.value("resting_order_id", 0ULL), true);
+                break;
+            }
+
+            case EventType::MASS_CANCEL: {
+                for (uint64_t order_id : event.payload.at("order_ids")) {
+                    auto it = orders_.find(order_id);
+                    if (it == orders_.end() || !it->second) continue;
+                    it->second->status = OrderStatus::CANCELLED;
+                    if (auto* book = get_book(it->second->symbol)) book->remove_order(order_id);
+                    auto stops = stop_books_.find(it->second->symbol);
+                    if (stops != stop_books_.end()) stops->second.remove(order_id);
+                }
+                if (event.payload.value("block", false)) {
+                    blocked_accounts_.insert(event.payload.value("account_id", ""));
+                }
+                break;
+            }
+
+            case EventType::ORDERS_EXPIRED: {
+                for (uint64_t order_id : event.payload.at("order_ids")) {
+                    auto it = orders_.find(order_id);
+                    if (it == orders_.end() || !it->second) continue;
+                    it->second->status = OrderStatus::EXPIRED;
+                    if (auto* book = get_book(it->second->symbol)) book->remove_order(order_id);
+                    auto stops = stop_books_.find(it->second->symbol);
+                    if (stops != stop_books_.end()) stops->second.remove(order_id);
+                }
+                break;
+            }
+
+            case EventType::ACCOUNT_UNBLOCKED:
+                blocked_accounts_.erase(event.payload.value("account_id", ""));
+                break;
+
+            // An uncross that follows is replayed from its trade events
+            case EventType::SYMBOL_STATE_CHANGED:
+                apply_symbol_state(event.payload.at("symbol").get<std::string>(),
+                                   event.payload.at("state").get<SymbolState>());
+                break;
             
+            case EventType::RESPONSE_CACHED: {
+                // Logged as the placing command finished, so the order is as
+                // that command left it and its trades are the latest ones
+                uint64_t order_id = event.payload.value("order_id", 0ULL);
+                auto it = orders_.find(order_id);
+                if (it == orders_.end() || !it->second) break;
+                IdempotencyStore::Response response{event.payload.value("success", false),
+                                                    event.payload.value("error_code",
+                                                                        ErrorCode::NONE),
+                                                    *it->second,
+                                                    {}};
+                for (uint64_t trade_id : event.payload.at("trade_ids")) {
+                    auto t = std::find_if(trades_.rbegin(), trades_.rend(),
+                                          [&](const Trade& x) { return x.id == trade_id; });
+                    if (t != trades_.rend()) response.trades.push_back(*t);
+                }
+                auto key = IdempotencyStore::fingerprint(it->second->idempotency_key);
+                idempotency_.set_response(key, std::move(response));
+                break;
+            }
+
             case EventType::TRADE_EXECUTED: {
                 Trade trade = event.payload.get<Trade>();
                 trades_.push_back(trade);
@@ -378,30 +1514,19 @@ void MatchingEngine::replay_events(const std::vector<Event>& events) {
                     next_trade_id_ = trade.id + 1;
                 }
                 
-                // Update order quantities
-                auto buy_it = orders_.find(trade.buy_order_id);
-                if (buy_it != orders_.end() && buy_it->second) {
-                    buy_it->second->remaining_qty -= trade.quantity;
-                    if (buy_it->second->remaining_qty <= 0) {
-                        buy_it->second->remaining_qty = 0;
-                        buy_it->second->status = OrderStatus::FILLED;
-                        auto* book = get_book(buy_it->second->symbol);
-                        if (book) book->remove_order(trade.buy_order_id);
-                    } else {
-                        buy_it->second->status = OrderStatus::PARTIAL;
-                    }
-                }
-                
-                auto sell_it = orders_.find(trade.sell_order_id);
-                if (sell_it != orders_.end() && sell_it->second) {
-                    sell_it->second->remaining_qty -= trade.quantity;
-                    if (sell_it->second->remaining_qty <= 0) {
-                        sell_it->second->remaining_qty = 0;
-                        sell_it->second->status = OrderStatus::FILLED;
-                        auto* book = get_book(sell_it->second->symbol);
-                        if (book) book->remove_order(trade.sell_order_id);
+                // Update order quantities, through the book for resting
+                // orders so its level totals stay in step
+                for (uint64_t order_id : {trade.buy_order_id, trade.sell_order_id}) {
+                    auto it = orders_.find(order_id);
+                    if (it == orders_.end() || !it->second) continue;
+                    Order& o = *it->second;
+                    int64_t remaining = std::max<int64_t>(o.remaining_qty - trade.quantity, 0);
+                    auto* book = get_book(o.symbol);
+                    if (book && book->get_order(order_id)) {
+                        book->update_order_qty(order_id, remaining);
                     } else {
-                        sell_it->second->status = OrderStatus::PARTIAL;
+                        o.remaining_qty = remaining;
+                        o.status = remaining == 0 ? OrderStatus::FILLED : OrderStatus::PARTIAL;
                     }
                 }
                 break;
@@ -411,6 +1536,7 @@ void MatchingEngine::replay_events(const std::vector<Event>& events) {
                 break;
         }
     }
+    rebuild_resting_state();
 }
 
 Snapshot MatchingEngine::create_snapshot() const {
@@ -419,12 +1545,42 @@ Snapshot MatchingEngine::create_snapshot() const {
     s.timestamp_ns = now_ns();
     s.next_order_id = next_order_id_;
     s.next_trade_id = next_trade_id_;
+    s.idempotency_keys = idempotency_.entries();
 
+    // Resting orders in queue order, so a restore rebuilds the same queues
+    // (refilled icebergs included), then stops and other live orders by id
+    std::vector<const std::string*> symbols;
+    for (const auto& [symbol, _] : books_) symbols.push_back(&symbol);
+    std::sort(symbols.begin(), symbols.end(),
+              [](const std::string* a, const std::string* b) { return *a < *b; });
+    std::unordered_set<uint64_t> queued;
+    for (const std::string* symbol : symbols) {
+        const OrderBook& book = *books_.at(*symbol);
+        for (const auto& side : {book.get_all_bids(), book.get_all_asks()}) {
+            for (const Order* o : side) {
+                s.orders.push_back(*o);
+                queued.insert(o->id);
+            }
+        }
+    }
+    size_t resting = s.orders.size();
     for (const auto& [id, order] : orders_) {
-        if (order && order->is_active()) {
+        if (order && order->is_active() && !queued.count(id)) {
             s.orders.push_back(*order);
         }
     }
+    std::sort(s.orders.begin() + static_cast<std::ptrdiff_t>(resting), s.orders.end(),
+              [](const Order& a, const Order& b) { return a.id < b.id; });
+    s.blocked_accounts.assign(blocked_accounts_.begin(), blocked_accounts_.end());
+    std::sort(s.blocked_accounts.begin(), s.blocked_accounts.end());
+    for (uint32_t id = 0; id < symbol_states_.size(); ++id) {
+        s.symbol_states[state_ids_.name(id)] = symbol_states_[id];
+    }
+    trade_totals(s.positions, s.last_trade_prices);
+    for (auto it = s.positions.begin(); it != s.positions.end();) {
+        std::erase_if(it->second, [](const auto& kv) { return kv.second == 0; });
+        it = it->second.empty() ? s.positions.erase(it) : std::next(it);
+    }
 
     return s;
 }
@@ -1,52 +1,136 @@
 #include "exchange/order_book.hpp"
 
 #include <algorithm>
+#include <cstdlib>
+#include <iterator>
+
+#include "exchange/market_data.hpp"
 
 namespace exchange {
 
+namespace {
+
+template <typename Levels>
+BookLevel top_level(const Levels& levels) {
+    BookLevel lvl;
+    if (levels.empty()) return lvl;
+    const auto& [price, level] = *levels.begin();
+    lvl.price = price;
+    lvl.quantity = level.total_qty;
+    lvl.order_count = static_cast<int>(level.orders.size());
+    return lvl;
+}
+
+template <typename Levels>
+std::vector<BookLevel> level_summary(const Levels& levels, size_t depth) {
+    std::vector<BookLevel> out;
+    for (const auto& [price, level] : levels) {
+        if (out.size() >= depth) break;
+        BookLevel lvl;
+        lvl.price = price;
+        lvl.quantity = level.total_qty;
+        lvl.order_count = static_cast<int>(level.orders.size());
+        out.push_back(lvl);
+    }
+    return out;
+}
+
+template <typename Levels, typename Within>
+int64_t fillable(const Levels& levels, Within within, int64_t needed,
+                 const std::string* own_account, bool pass_own) {
+    int64_t total = 0;
+    for (const auto& [price, level] : levels) {
+        if (total >= needed || !within(price)) break;
+        if (!own_account) {
+            total += level.total_qty + level.hidden_qty;
+            continue;
+        }
+        for (const Order* o : level.orders) {
+            if (o->account_id != *own_account) {
+                total += o->remaining_qty;
+            } else if (!pass_own) {
+                return total;
+            }
+        }
+    }
+    return total;
+}
+
+}  // namespace
+
 OrderBook::OrderBook(std::string symbol) : symbol_(std::move(symbol)) {}
 
 void OrderBook::add_order(Order* order) {
+    PriceLevel& level = order->side == Side::BUY ? bids_[order->price] : asks_[order->price];
+    level.orders.push_back(order);
+    level.total_qty += order->shown_qty();
+    level.hidden_qty += order->remaining_qty - order->shown_qty();
     if (order->side == Side::BUY) {
-        bids_[order->price].push_back(order);
         bid_orders_[order->id] = order;
     } else {
-        asks_[order->price].push_back(order);
         ask_orders_[order->id] = order;
     }
+    refresh_bbo(order->side);
+    if (feed_) feed_->publish(L3MessageType::ADD, *order, order->shown_qty());
 }
 
 bool OrderBook::remove_order(uint64_t order_id) {
+    Order* order = erase_order(order_id);
+    if (!order) return false;
+    if (feed_) feed_->publish(L3MessageType::DELETE, *order, 0);
+    return true;
+}
+
+Order* OrderBook::erase_order(uint64_t order_id) {
     auto bid_it = bid_orders_.find(order_id);
     if (bid_it != bid_orders_.end()) {
-        remove_from_price_level(bid_it->second);
+        Order* order = bid_it->second;
+        remove_from_price_level(order);
         bid_orders_.erase(bid_it);
-        return true;
+        refresh_bbo(Side::BUY);
+        return order;
     }
 
     auto ask_it = ask_orders_.find(order_id);
     if (ask_it != ask_orders_.end()) {
-        remove_from_price_level(ask_it->second);
+        Order* order = ask_it->second;
+        remove_from_price_level(order);
         ask_orders_.erase(ask_it);
-        return true;
+        refresh_bbo(Side::SELL);
+        return order;
     }
 
-    return false;
+    return nullptr;
+}
+
+PriceLevel* OrderBook::find_level(const Order* order) {
+    if (order->side == Side::BUY) {
+        auto it = bids_.find(order->price);
+        return it == bids_.end() ? nullptr : &it->second;
+    }
+    auto it = asks_.find(order->price);
+    return it == asks_.end() ? nullptr : &it->second;
 }
 
 void OrderBook::remove_from_price_level(Order* order) {
     if (order->side == Side::BUY) {
         auto it = bids_.find(order->price);
         if (it != bids_.end()) {
-            auto& v = it->second;
+            auto& level = it->second;
+            auto& v = level.orders;
             v.erase(std::remove(v.begin(), v.end(), order), v.end());
+            level.total_qty -= order->shown_qty();
+            level.hidden_qty -= order->remaining_qty - order->shown_qty();
             if (v.empty()) bids_.erase(it);
         }
     } else {
         auto it = asks_.find(order->price);
         if (it != asks_.end()) {
-            auto& v = it->second;
+            auto& level = it->second;
+            auto& v = level.orders;
             v.erase(std::remove(v.begin(), v.end(), order), v.end());
+            level.total_qty -= order->shown_qty();
+            level.hidden_qty -= order->remaining_qty - order->shown_qty();
             if (v.empty()) asks_.erase(it);
         }
     }
@@ -56,13 +140,69 @@ void OrderBook::update_order_qty(uint64_t order_id, int64_t new_remaining_qty) {
     Order* order = get_order(order_id);
     if (!order) return;
 
-    order->remaining_qty = new_remaining_qty;
+    PriceLevel* level = find_level(order);
+    int64_t old_shown = order->shown_qty();
+    int64_t old_hidden = order->remaining_qty - old_shown;
+    bool refilled = order->consume(order->remaining_qty - new_remaining_qty);
+    if (level) {
+        level->total_qty += order->shown_qty() - old_shown;
+        level->hidden_qty += order->remaining_qty - order->shown_qty() - old_hidden;
+    }
     if (new_remaining_qty == 0) {
+        // A full fill is implied by the EXECUTE message, so no DELETE is sent
         order->status = OrderStatus::FILLED;
-        remove_order(order_id);
+        erase_order(order_id);
+        return;
+    }
+    order->status = OrderStatus::PARTIAL;
+    if (refilled && level) {
+        // The EXECUTE used up the old slice; the new one joins the back
+        requeue(*level, order);
+        if (feed_) feed_->publish(L3MessageType::ADD, *order, order->shown_qty());
+    }
+    refresh_bbo(order->side);
+}
+
+void OrderBook::requeue(PriceLevel& level, Order* order) {
+    auto& v = level.orders;
+    if (v.front() == order) {
+        v.pop_front();
     } else {
-        order->status = OrderStatus::PARTIAL;
+        v.erase(std::find(v.begin(), v.end(), order));
     }
+    v.push_back(order);
+}
+
+bool OrderBook::reduce_order_qty(uint64_t order_id, int64_t new_remaining_qty) {
+    Order* order = get_order(order_id);
+    if (!order || new_remaining_qty <= 0 || new_remaining_qty > order->remaining_qty) {
+        return false;
+    }
+
+    int64_t old_shown = order->shown_qty();
+    int64_t old_hidden = order->remaining_qty - old_shown;
+    order->shrink(new_remaining_qty);
+    if (auto* level = find_level(order)) {
+        level->total_qty += order->shown_qty() - old_shown;
+        level->hidden_qty += order->remaining_qty - order->shown_qty() - old_hidden;
+    }
+    refresh_bbo(order->side);
+    if (feed_) feed_->publish(L3MessageType::MODIFY, *order, order->shown_qty());
+    return true;
+}
+
+void OrderBook::refresh_bbo(Side side) {
+    if (side == Side::BUY) {
+        bbo_.bid = top_level(bids_);
+    } else {
+        bbo_.ask = top_level(asks_);
+    }
+}
+
+bool OrderBook::poll_bbo_change() {
+    if (bbo_ == published_bbo_) return false;
+    published_bbo_ = bbo_;
+    return true;
 }
 
 std::optional<int64_t> OrderBook::best_bid_price() const {
@@ -77,54 +217,96 @@ std::optional<int64_t> OrderBook::best_ask_price() const {
 
 std::vector<Order*> OrderBook::get_bids_at_best() const {
     if (bids_.empty()) return {};
-    return bids_.begin()->second;
+    const auto& orders = bids_.begin()->second.orders;
+    return {orders.begin(), orders.end()};
 }
 
 std::vector<Order*> OrderBook::get_asks_at_best() const {
     if (asks_.empty()) return {};
-    return asks_.begin()->second;
+    const auto& orders = asks_.begin()->second.orders;
+    return {orders.begin(), orders.end()};
+}
+
+const PriceLevel* OrderBook::level_from(Side side, int64_t price) const {
+    if (side == Side::BUY) {
+        auto it = bids_.lower_bound(price);
+        return it == bids_.end() ? nullptr : &it->second;
+    }
+    auto it = asks_.lower_bound(price);
+    return it == asks_.end() ? nullptr : &it->second;
+}
+
+int64_t OrderBook::fillable_qty(Side taker_side, int64_t limit_price, int64_t needed,
+                               const std::string* own_account, bool pass_own) const {
+    if (taker_side == Side::BUY) {
+        return fillable(asks_, [&](int64_t p) { return p <= limit_price; }, needed, own_account,
+                        pass_own);
+    }
+    return fillable(bids_, [&](int64_t p) { return p >= limit_price; }, needed, own_account,
+                    pass_own);
+}
+
+AuctionPrice OrderBook::auction_price(int64_t reference_price) const {
+    AuctionPrice best;
+    if (!is_crossed()) return best;
+    const int64_t lo = asks_.begin()->first;
+    const int64_t hi = bids_.begin()->first;
+    auto qty = [](const PriceLevel& level) { return level.total_qty + level.hidden_qty; };
+
+    // Bids at or above the lowest candidate price; each level leaves the
+    // total once the sweep has passed its price
+    auto bid_end = bids_.upper_bound(lo);
+    int64_t bids = 0;
+    for (auto it = bids_.begin(); it != bid_end; ++it) bids += qty(it->second);
+    int64_t asks = 0;
+
+    auto bid = std::make_reverse_iterator(bid_end);
+    auto ask = asks_.begin();
+    const auto ask_end = asks_.upper_bound(hi);
+    while (bid != bids_.rend() || ask != ask_end) {
+        int64_t price = bid == bids_.rend()  ? ask->first
+                        : ask == ask_end     ? bid->first
+                                             : std::min(bid->first, ask->first);
+        if (ask != ask_end && ask->first == price) asks += qty((ask++)->second);
+        int64_t bids_here = 0;
+        if (bid != bids_.rend() && bid->first == price) bids_here = qty((bid++)->second);
+
+        int64_t volume = std::min(bids, asks);
+        int64_t imbalance = bids - asks;
+        bool better = volume > best.volume;
+        if (volume == best.volume && std::abs(imbalance) != std::abs(best.imbalance)) {
+            better = std::abs(imbalance) < std::abs(best.imbalance);
+        } else if (volume == best.volume && reference_price != 0) {
+            better = std::abs(price - reference_price) < std::abs(best.price - reference_price);
+        }
+        if (better) best = {price, volume, imbalance};
+        bids -= bids_here;
+    }
+    return best;
 }
 
 std::vector<Order*> OrderBook::get_all_bids() const {
     std::vector<Order*> result;
-    for (const auto& [_, orders] : bids_) {
-        result.insert(result.end(), orders.begin(), orders.end());
+    for (const auto& [_, level] : bids_) {
+        result.insert(result.end(), level.orders.begin(), level.orders.end());
     }
     return result;
 }
 
 std::vector<Order*> OrderBook::get_all_asks() const {
     std::vector<Order*> result;
-    for (const auto& [_, orders] : asks_) {
-        result.insert(result.end(), orders.begin(), orders.end());
+    for (const auto& [_, level] : asks_) {
+        result.insert(result.end(), level.orders.begin(), level.orders.end());
     }
     return result;
 }
 
 std::vector<BookLevel> OrderBook::get_bid_levels(size_t depth) const {
-    std::vector<BookLevel> levels;
-    for (const auto& [price, orders] : bids_) {
-        if (levels.size() >= depth) break;
-        BookLevel lvl;
-        lvl.price = price;
-        lvl.order_count = static_cast<int>(orders.size());
-        for (const auto* o : orders) lvl.quantity += o->remaining_qty;
-        levels.push_back(lvl);
-    }
-    return levels;
+    return level_summary(bids_, depth);
 }
 
 std::vector<BookLevel> OrderBook::get_ask_levels(size_t depth) const {
-    std::vector<BookLevel> levels;
-    for (const auto& [price, orders] : asks_) {
-        if (levels.size() >= depth) break;
-        BookLevel lvl;
-        lvl.price = price;
-        lvl.order_count = static_cast<int>(orders.size());
-        for (const auto* o : orders) lvl.quantity += o->remaining_qty;
-        levels.push_back(lvl);
-    }
-    return levels;
+    return level_summary(asks_, depth);
 }
 
 bool OrderBook::is_crossed() const {
@@ -5,18 +5,27 @@ namespace exchange {
 ProtocolHandler::ProtocolHandler(MatchingEngine& engine) : engine_(engine) {}
 
 std::string ProtocolHandler::handle(const std::string& json_command) {
+    auto& latency = engine_.latency();
+    EXCHANGE_LATENCY_SCOPE(latency, LatencyStage::HANDLE);
     nlohmann::json out;
     
     try {
+        EXCHANGE_LATENCY_BEGIN(latency, parse_start);
         auto cmd = nlohmann::json::parse(json_command);
+        EXCHANGE_LATENCY_END(latency, LatencyStage::PARSE, parse_start);
         std::string type = cmd.value("cmd", "");
         std::string req_id = cmd.value("req_id", "");
         
         out["req_id"] = req_id;
 
         if (type == "place_order") {
+            EXCHANGE_LATENCY_BEGIN(latency, decode_start);
             Order o = cmd.at("order").get<Order>();
-            auto r = engine_.place_order(o);
+            EXCHANGE_LATENCY_END(latency, LatencyStage::DECODE, decode_start);
+
+            auto r = engine_.place_order(std::move(o));
+
+            EXCHANGE_LATENCY_BEGIN(latency, response_start);
             out["success"] = r.success;
             if (r.success) {
                 out["data"] = {{"order", r.order}, {"trades", r.trades}};
@@ -24,10 +33,15 @@ std::string ProtocolHandler::handle(const std::string& json_command) {
                 out["error"] = {{"code", r.error_code},
                                 {"message", error_message(r.error_code)}};
             }
+            if (r.duplicate) out["duplicate"] = true;
+            EXCHANGE_LATENCY_ACCRUE(latency, LatencyStage::SERIALIZE, response_start);
         } 
         else if (type == "cancel_order") {
-            uint64_t order_id = cmd.at("order_id").get<uint64_t>();
-            auto r = engine_.cancel_order(order_id);
+            // By order_id, or by account_id plus client_order_id
+            auto r = cmd.contains("client_order_id")
+                         ? engine_.cancel_order(cmd.at("account_id").get<std::string>(),
+                                                cmd.at("client_order_id").get<std::string>())
+                         : engine_.cancel_order(cmd.at("order_id").get<uint64_t>());
             out["success"] = r.success;
             if (r.success) {
                 out["data"] = {{"order", r.order}};
@@ -36,9 +50,75 @@ std::string ProtocolHandler::handle(const std::string& json_command) {
                                 {"message", error_message(r.error_code)}};
             }
         }
-        else if (type == "get_order") {
+        else if (type == "replace_order") {
+            // price and quantity default to the order's current values
             uint64_t order_id = cmd.at("order_id").get<uint64_t>();
-            auto order_opt = engine_.get_order(order_id);
+            auto current = engine_.get_order(order_id);
+            int64_t price = cmd.value("price", current ? current->price : 0);
+            int64_t quantity = cmd.value("quantity", current ? current->quantity : 0);
+
+            auto r = engine_.modify_order(order_id, price, quantity);
+            out["success"] = r.success;
+            if (r.success) {
+                out["data"] = {{"order", r.order}, {"trades", r.trades}};
+            } else {
+                out["error"] = {{"code", r.error_code},
+                                {"message", error_message(r.error_code)}};
+            }
+        }
+        else if (type == "mass_cancel") {
+            // Any combination of account_id and symbol; neither cancels everything
+            MassCancelRequest req;
+            req.account_id = cmd.value("account_id", "");
+            req.symbol = cmd.value("symbol", "");
+            req.block = cmd.value("block", false);
+            if (req.block && req.account_id.empty()) {
+                out["success"] = false;
+                out["error"] = {{"code", "INVALID_REQUEST"},
+                                {"message", "block requires account_id"}};
+            } else {
+                auto r = engine_.mass_cancel(req);
+                out["success"] = r.success;
+                out["data"] = {{"cancelled", r.order_ids.size()},
+                               {"order_ids", r.order_ids},
+                               {"blocked", req.block}};
+            }
+        }
+        else if (type == "unblock_account") {
+            std::string account_id = cmd.at("account_id").get<std::string>();
+            out["success"] = true;
+            out["data"] = {{"account_id", account_id},
+                           {"was_blocked", engine_.unblock_account(account_id)}};
+        }
+        else if (type == "set_symbol_state") {
+            std::string symbol = cmd.at("symbol").get<std::string>();
+            auto r = engine_.set_symbol_state(symbol, cmd.at("state").get<SymbolState>());
+            out["success"] = r.success;
+            if (r.success) {
+                out["data"] = {{"symbol", symbol}, {"state", r.state}};
+                if (r.uncross.volume > 0) {
+                    out["data"]["uncross"] = {{"price", r.uncross.price},
+                                              {"volume", r.uncross.volume},
+                                              {"imbalance", r.uncross.imbalance},
+                                              {"trades", r.trades}};
+                }
+            } else {
+                out["error"] = {{"code", r.error_code},
+                                {"message", error_message(r.error_code)},
+                                {"state", r.state}};
+            }
+        }
+        else if (type == "get_symbol_state") {
+            std::string symbol = cmd.at("symbol").get<std::string>();
+            out["success"] = true;
+            out["data"] = {{"symbol", symbol}, {"state", engine_.symbol_state(symbol)}};
+        }
+        else if (type == "get_order") {
+            // By order_id, or by account_id plus client_order_id (open orders only)
+            auto order_opt = cmd.contains("client_order_id")
+                                 ? engine_.get_order(cmd.at("account_id").get<std::string>(),
+                                                     cmd.at("client_order_id").get<std::string>())
+                                 : engine_.get_order(cmd.at("order_id").get<uint64_t>());
             if (order_opt.has_value()) {
                 out["success"] = true;
                 out["data"] = {{"order", order_opt.value()}};
@@ -48,6 +128,14 @@ std::string ProtocolHandler::handle(const std::string& json_command) {
                                 {"message", error_message(ErrorCode::ORDER_NOT_FOUND)}};
             }
         }
+        else if (type == "get_open_orders") {
+            // symbol is optional; without it every open order of the account
+            std::string account_id = cmd.at("account_id").get<std::string>();
+            std::string symbol = cmd.value("symbol", "");
+            out["success"] = true;
+            out["data"] = {{"account_id", account_id},
+                           {"orders", engine_.get_open_orders(account_id, symbol)}};
+        }
         else if (type == "get_book") {
             std::string symbol = cmd.at("symbol").get<std::string>();
             size_t depth = cmd.value("depth", 10);
@@ -66,6 +154,38 @@ std::string ProtocolHandler::handle(const std::string& json_command) {
             }
             out["data"] = data;
         }
+        else if (type == "get_book_l3") {
+            std::string symbol = cmd.at("symbol").get<std::string>();
+
+            auto* book = engine_.get_book(symbol);
+            auto to_l3 = [](const std::vector<Order*>& orders) {
+                nlohmann::json arr = nlohmann::json::array();
+                for (const auto* o : orders) {
+                    arr.push_back({{"order_id", o->id},
+                                   {"price", o->price},
+                                   {"quantity", o->shown_qty()}});
+                }
+                return arr;
+            };
+
+            out["success"] = true;
+            nlohmann::json data;
+            data["symbol"] = symbol;
+            // Feed messages with a higher sequence apply on top of this snapshot
+            data["sequence"] = engine_.market_data_sequence();
+            data["bids"] = book ? to_l3(book->get_all_bids()) : nlohmann::json::array();
+            data["asks"] = book ? to_l3(book->get_all_asks()) : nlohmann::json::array();
+            out["data"] = data;
+        }
+        else if (type == "get_bbo") {
+            std::string symbol = cmd.at("symbol").get<std::string>();
+
+            auto* book = engine_.get_book(symbol);
+            out["success"] = true;
+            nlohmann::json data = book ? nlohmann::json(book->bbo()) : nlohmann::json(Bbo{});
+            data["symbol"] = symbol;
+            out["data"] = data;
+        }
         else if (type == "get_trades") {
             std::string symbol = cmd.at("symbol").get<std::string>();
             size_t limit = cmd.value("limit", 100);
@@ -79,6 +199,12 @@ std::string ProtocolHandler::handle(const std::string& json_command) {
             out["success"] = true;
             out["data"] = stats;
         }
+        else if (type == "get_latency") {
+            // Optionally clears the histograms after reading them
+            out["success"] = true;
+            out["data"] = latency;
+            if (cmd.value("reset", false)) latency.reset();
+        }
         else if (type == "health") {
             out["success"] = true;
             out["data"] = {{"status", "healthy"}, {"timestamp_ns", now_ns()}};
@@ -86,7 +212,7 @@ std::string ProtocolHandler::handle(const std::string& json_command) {
         else if (type == "shutdown" || type == "exit" || type == "quit") {
             out["success"] = true;
             out["data"] = {{"status", "shutting_down"}};
-            // Note: The main loop should check for this and exit
+            shutdown_requested_ = true;
         }
         else {
             out["success"] = false;
@@ -104,7 +230,11 @@ std::string ProtocolHandler::handle(const std::string& json_command) {
                        {"message", std::string("Internal error: ") + e.what()}};
     }
 
-    return out.dump();
+    EXCHANGE_LATENCY_BEGIN(latency, dump_start);
+    std::string response = out.dump();
+    EXCHANGE_LATENCY_ACCRUE(latency, LatencyStage::SERIALIZE, dump_start);
+    EXCHANGE_LATENCY_COMMIT(latency, LatencyStage::SERIALIZE);
+    return response;
 }
 
 }  // namespace exchange
\ No newline at end of file
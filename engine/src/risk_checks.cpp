@@ -1,55 +1,477 @@
 #include "exchange/risk_checks.hpp"
 
 #include <algorithm>
+#include <fstream>
+#include <limits>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
 
 namespace exchange {
 
-RiskChecker::RiskChecker(RiskLimits limits) : limits_(std::move(limits)) {}
+UInt128 mul_u64(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+    __extension__ using u128 = unsigned __int128;
+    u128 p = static_cast<u128>(a) * b;
+    return {static_cast<uint64_t>(p >> 64), static_cast<uint64_t>(p)};
+#elif defined(_MSC_VER) && defined(_M_X64)
+    UInt128 r;
+    r.lo = _umul128(a, b, &r.hi);
+    return r;
+#else
+    uint64_t a_lo = a & 0xffffffff, a_hi = a >> 32;
+    uint64_t b_lo = b & 0xffffffff, b_hi = b >> 32;
+    uint64_t ll = a_lo * b_lo, lh = a_lo * b_hi, hl = a_hi * b_lo, hh = a_hi * b_hi;
+    uint64_t mid = (ll >> 32) + (lh & 0xffffffff) + (hl & 0xffffffff);
+    return {hh + (lh >> 32) + (hl >> 32) + (mid >> 32), (mid << 32) | (ll & 0xffffffff)};
+#endif
+}
 
-RiskCheckResult RiskChecker::check_order(const Order& order) const {
-    RiskCheckResult r;
+int64_t div_u64(UInt128 v, uint64_t d) {
+#if defined(__SIZEOF_INT128__)
+    __extension__ using u128 = unsigned __int128;
+    u128 q128 = ((static_cast<u128>(v.hi) << 64) | v.lo) / d;
+    UInt128 q{static_cast<uint64_t>(q128 >> 64), static_cast<uint64_t>(q128)};
+#else
+    UInt128 q;
+    uint64_t rem = 0;
+    for (int i = 127; i >= 0; --i) {
+        uint64_t bit = i >= 64 ? (v.hi >> (i - 64)) & 1 : (v.lo >> i) & 1;
+        bool carry = rem >> 63;
+        rem = (rem << 1) | bit;
+        if (carry || rem >= d) {
+            rem -= d;
+            if (i >= 64) q.hi |= uint64_t{1} << (i - 64);
+            else q.lo |= uint64_t{1} << i;
+        }
+    }
+#endif
+    if (q.hi != 0 || q.lo > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+        return std::numeric_limits<int64_t>::max();
+    }
+    return static_cast<int64_t>(q.lo);
+}
+
+namespace {
+
+UInt128 add(UInt128 a, UInt128 b) {
+    uint64_t lo = a.lo + b.lo;
+    return {a.hi + b.hi + (lo < a.lo), lo};
+}
+
+UInt128 sub(UInt128 a, UInt128 b) {
+    return {a.hi - b.hi - (a.lo < b.lo), a.lo - b.lo};
+}
+
+bool exceeds(UInt128 v, UInt128 limit) {
+    return (v.hi > limit.hi) | ((v.hi == limit.hi) & (v.lo > limit.lo));
+}
+
+UInt128 scaled_limit(int64_t limit) {
+    if (limit <= 0) return {UINT64_MAX, UINT64_MAX};
+    return mul_u64(static_cast<uint64_t>(limit), PRICE_SCALE);
+}
+
+UInt128 notional_of(int64_t price, int64_t qty) {
+    return mul_u64(static_cast<uint64_t>(price), static_cast<uint64_t>(qty));
+}
+
+SymbolLimits compile(const SymbolRiskConfig& c, const RiskLimits& global) {
+    SymbolLimits s;
+    s.tick_size = std::max<int64_t>(c.tick_size, 1);
+    s.lot_size = std::max<int64_t>(c.lot_size, 1);
+    s.min_qty = std::max<int64_t>(c.min_qty, 1);
+    s.max_qty = c.max_qty > 0 ? c.max_qty : global.max_order_size;
+    s.min_price = std::max<int64_t>(c.min_price, 1);
+    s.max_price = c.max_price > 0 ? c.max_price : std::numeric_limits<int64_t>::max();
+
+    // price * qty / PRICE_SCALE > max_notional  <=>  price * qty > max_notional * PRICE_SCALE
+    int64_t notional = c.max_notional > 0 ? c.max_notional : global.max_notional;
+    s.max_notional = mul_u64(static_cast<uint64_t>(std::max<int64_t>(notional, 0)), PRICE_SCALE);
+    s.price_band_bps = c.price_band_bps > 0 ? c.price_band_bps : global.price_band_bps;
+    s.allocation = c.allocation;
+    return s;
+}
+
+int64_t or_unlimited(int64_t limit, int64_t fallback) {
+    int64_t v = limit > 0 ? limit : fallback;
+    return v > 0 ? v : std::numeric_limits<int64_t>::max();
+}
+
+}  // namespace
+
+void to_json(nlohmann::json& j, const SymbolRiskConfig& c) {
+    j = nlohmann::json{
+        {"symbol", c.symbol},
+        {"tick_size", c.tick_size},
+        {"lot_size", c.lot_size},
+        {"min_qty", c.min_qty},
+        {"max_qty", c.max_qty},
+        {"min_price", c.min_price},
+        {"max_price", c.max_price},
+        {"max_notional", c.max_notional},
+        {"price_band_bps", c.price_band_bps},
+        {"allocation", c.allocation}
+    };
+}
+
+void from_json(const nlohmann::json& j, SymbolRiskConfig& c) {
+    SymbolRiskConfig d;
+    j.at("symbol").get_to(c.symbol);
+    c.tick_size = j.value("tick_size", d.tick_size);
+    c.lot_size = j.value("lot_size", d.lot_size);
+    c.min_qty = j.value("min_qty", d.min_qty);
+    c.max_qty = j.value("max_qty", d.max_qty);
+    c.min_price = j.value("min_price", d.min_price);
+    c.max_price = j.value("max_price", d.max_price);
+    c.max_notional = j.value("max_notional", d.max_notional);
+    c.price_band_bps = j.value("price_band_bps", d.price_band_bps);
+    c.allocation = j.value("allocation", d.allocation);
+}
+
+void to_json(nlohmann::json& j, const AccountRiskConfig& c) {
+    j = nlohmann::json{
+        {"account", c.account},
+        {"max_open_orders", c.max_open_orders},
+        {"max_open_notional", c.max_open_notional},
+        {"max_position", c.max_position}
+    };
+}
+
+void from_json(const nlohmann::json& j, AccountRiskConfig& c) {
+    AccountRiskConfig d;
+    j.at("account").get_to(c.account);
+    c.max_open_orders = j.value("max_open_orders", d.max_open_orders);
+    c.max_open_notional = j.value("max_open_notional", d.max_open_notional);
+    c.max_position = j.value("max_position", d.max_position);
+}
+
+void to_json(nlohmann::json& j, const RiskLimits& l) {
+    j = nlohmann::json{
+        {"max_order_size", l.max_order_size},
+        {"max_notional", l.max_notional},
+        {"allowed_symbols", l.allowed_symbols},
+        {"symbols", l.symbols},
+        {"price_band_bps", l.price_band_bps},
+        {"max_open_orders", l.max_open_orders},
+        {"max_open_notional", l.max_open_notional},
+        {"max_position", l.max_position},
+        {"accounts", l.accounts}
+    };
+}
+
+void from_json(const nlohmann::json& j, RiskLimits& l) {
+    RiskLimits d;
+    l.max_order_size = j.value("max_order_size", d.max_order_size);
+    l.max_notional = j.value("max_notional", d.max_notional);
+    l.symbols = j.value("symbols", std::vector<SymbolRiskConfig>{});
+    if (j.contains("allowed_symbols")) {
+        j.at("allowed_symbols").get_to(l.allowed_symbols);
+    } else {
+        l.allowed_symbols = j.contains("symbols") ? std::vector<std::string>{} : d.allowed_symbols;
+    }
+    l.price_band_bps = j.value("price_band_bps", d.price_band_bps);
+    l.max_open_orders = j.value("max_open_orders", d.max_open_orders);
+    l.max_open_notional = j.value("max_open_notional", d.max_open_notional);
+    l.max_position = j.value("max_position", d.max_position);
+    l.accounts = j.value("accounts", std::vector<AccountRiskConfig>{});
+}
+
+void to_json(nlohmann::json& j, const AccountExposure& e) {
+    j = nlohmann::json{
+        {"open_orders", e.open_orders},
+        {"open_notional", e.open_notional},
+        {"position", e.position},
+        {"open_buy_qty", e.open_buy_qty},
+        {"open_sell_qty", e.open_sell_qty}
+    };
+}
+
+std::optional<RiskLimits> load_risk_config(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) return std::nullopt;
 
-    if (order.quantity <= 0) {
-        r.passed = false;
-        r.error_code = ErrorCode::INVALID_QUANTITY;
-        return r;
+    auto j = nlohmann::json::parse(file, nullptr, false);
+    if (j.is_discarded() || !j.is_object()) return std::nullopt;
+    RiskLimits limits;
+    try {
+        limits = j.get<RiskLimits>();
+    } catch (const nlohmann::json::exception&) {
+        return std::nullopt;
+    }
+    for (const auto& symbol : limits.allowed_symbols) {
+        if (symbol.size() > MAX_SYMBOL_LEN) return std::nullopt;
+    }
+    for (const auto& cfg : limits.symbols) {
+        if (cfg.symbol.size() > MAX_SYMBOL_LEN) return std::nullopt;
     }
+    return limits;
+}
 
-    if (order.type == OrderType::LIMIT && order.price <= 0) {
-        r.passed = false;
-        r.error_code = ErrorCode::INVALID_PRICE;
-        return r;
+// Symbols longer than MAX_SYMBOL_LEN are left out, so orders for them are
+// refused with INVALID_SYMBOL and no book is ever created for them
+RiskChecker::RiskChecker(RiskLimits limits) : limits_(std::move(limits)) {
+    for (const auto& symbol : limits_.allowed_symbols) {
+        if (symbol.size() > MAX_SYMBOL_LEN) continue;
+        if (symbols_.add(symbol) == table_.size()) {
+            table_.push_back(compile(SymbolRiskConfig{}, limits_));
+        }
+    }
+    // A later entry for the same symbol wins
+    for (const auto& cfg : limits_.symbols) {
+        if (cfg.symbol.size() > MAX_SYMBOL_LEN) continue;
+        uint32_t id = symbols_.add(cfg.symbol);
+        if (id == table_.size()) table_.emplace_back();
+        table_[id] = compile(cfg, limits_);
     }
+    references_.resize(table_.size());
+
+    default_account_ = compile_account(AccountRiskConfig{}, limits_);
+    for (const auto& cfg : limits_.accounts) {
+        account_state_[account_id(cfg.account)] = compile_account(cfg, limits_);
+    }
+}
+
+RiskChecker::AccountState RiskChecker::compile_account(const AccountRiskConfig& c,
+                                                       const RiskLimits& global) {
+    AccountState a;
+    a.max_open_orders = or_unlimited(c.max_open_orders, global.max_open_orders);
+    a.max_position = or_unlimited(c.max_position, global.max_position);
+    a.max_open_notional =
+        scaled_limit(c.max_open_notional > 0 ? c.max_open_notional : global.max_open_notional);
+    return a;
+}
+
+RiskCheckResult RiskChecker::check_order(const Order& order) const {
+    uint32_t id = symbols_.find(order.symbol);
+    if (id == SymbolTable::NOT_FOUND) return {false, classify(order, nullptr)};
+
+    const SymbolLimits& s = table_[id];
+    const int64_t qty = order.quantity;
+    const int64_t price = order.price;
+    const bool is_limit = order.type == OrderType::LIMIT || order.type == OrderType::STOP_LIMIT;
+    // Parked stops count as open orders too
+    const bool rests = is_limit | order.is_stop();
+
+    static const PositionState no_position{};
+    uint32_t acct = accounts_.find(order.account_id);
+    bool known = acct != SymbolTable::NOT_FOUND;
+    const AccountState& a = known ? account_state_[acct] : default_account_;
+    const PositionState& p = known ? positions_[acct * table_.size() + id] : no_position;
+    const PriceCollar& collar = references_[id].collar;
+
+    // Every rule is evaluated; a bad quantity or price makes the product
+    // meaningless, but then the order fails regardless
+    UInt128 notional = notional_of(price, qty);
+    int64_t worst_position = order.side == Side::BUY ? p.position + p.open_buy + qty
+                                                     : p.open_sell + qty - p.position;
+    bool bad_qty = (qty < s.min_qty) | (qty > s.max_qty) | (qty % s.lot_size != 0) |
+                   (worst_position > a.max_position);
+    bool bad_price = (price < s.min_price) | (price > s.max_price) |
+                     (price % s.tick_size != 0) | exceeds(notional, s.max_notional) |
+                     (price < collar.lo) | (price > collar.hi);
+    bool bad_open = (a.open_orders >= a.max_open_orders) |
+                    exceeds(add(a.open_notional, notional), a.max_open_notional);
 
-    if (!is_valid_symbol(order.symbol)) {
-        r.passed = false;
-        r.error_code = ErrorCode::INVALID_SYMBOL;
-        return r;
+    bool bad_type = (!is_limit) & (order.is_post_only() | (order.display_qty != 0));
+    bool bad_stop = order.is_stop() & ((order.stop_price <= 0) |
+                                       (order.stop_price % s.tick_size != 0));
+    bool bad_display = (order.display_qty < 0) | (order.display_qty % s.lot_size != 0);
+
+    if (!(bad_qty | (is_limit & bad_price) | (rests & bad_open) | bad_type | bad_stop |
+          bad_display)) {
+        return {};
     }
+    return {false, classify(order, &s)};
+}
 
-    if (order.quantity > limits_.max_order_size) {
-        r.passed = false;
-        r.error_code = ErrorCode::MAX_ORDER_SIZE_EXCEEDED;
-        return r;
+RiskCheckResult RiskChecker::check_quantity(const Order& order) const {
+    uint32_t id = symbols_.find(order.symbol);
+    if (id == SymbolTable::NOT_FOUND) return {false, ErrorCode::INVALID_SYMBOL};
+    const SymbolLimits& s = table_[id];
+    if (order.quantity > s.max_qty) return {false, ErrorCode::MAX_ORDER_SIZE_EXCEEDED};
+    if (order.quantity < s.min_qty) return {false, ErrorCode::INVALID_QUANTITY};
+    if (order.quantity % s.lot_size != 0) return {false, ErrorCode::INVALID_LOT_SIZE};
+    return {};
+}
+
+// Slow path: the first rule the order breaks, in the order the checks were
+// historically applied
+ErrorCode RiskChecker::classify(const Order& order, const SymbolLimits* s) const {
+    const bool is_limit = order.type == OrderType::LIMIT || order.type == OrderType::STOP_LIMIT;
+
+    if (!is_limit && (order.is_post_only() || order.display_qty != 0)) {
+        return ErrorCode::INVALID_ORDER_TYPE;
+    }
+    if (order.quantity <= 0 || order.display_qty < 0) return ErrorCode::INVALID_QUANTITY;
+    if (is_limit && order.price <= 0) return ErrorCode::INVALID_PRICE;
+    if (order.is_stop() && order.stop_price <= 0) return ErrorCode::INVALID_PRICE;
+    if (s == nullptr) return ErrorCode::INVALID_SYMBOL;
+    if (order.quantity > s->max_qty) return ErrorCode::MAX_ORDER_SIZE_EXCEEDED;
+    if (order.quantity < s->min_qty) return ErrorCode::INVALID_QUANTITY;
+    if (order.quantity % s->lot_size != 0 || order.display_qty % s->lot_size != 0) {
+        return ErrorCode::INVALID_LOT_SIZE;
+    }
+    if (order.is_stop() && order.stop_price % s->tick_size != 0) {
+        return ErrorCode::INVALID_TICK_SIZE;
     }
 
-    if (order.type == OrderType::LIMIT) {
-        long double notional =
-            static_cast<long double>(order.price) * order.quantity / PRICE_SCALE;
-        if (notional > limits_.max_notional) {
-            r.passed = false;
-            r.error_code = ErrorCode::MAX_NOTIONAL_EXCEEDED;
-            return r;
+    UInt128 notional = notional_of(order.price, order.quantity);
+    if (is_limit) {
+        if (order.price % s->tick_size != 0) return ErrorCode::INVALID_TICK_SIZE;
+        PriceCollar c = collar(order.symbol);
+        if (order.price < s->min_price || order.price > s->max_price || order.price < c.lo ||
+            order.price > c.hi) {
+            return ErrorCode::PRICE_OUT_OF_BAND;
         }
+        if (exceeds(notional, s->max_notional)) return ErrorCode::MAX_NOTIONAL_EXCEEDED;
     }
 
-    return r;
+    uint32_t acct = accounts_.find(order.account_id);
+    const AccountState& a =
+        acct != SymbolTable::NOT_FOUND ? account_state_[acct] : default_account_;
+    AccountExposure e = exposure(order.account_id, order.symbol);
+
+    if (is_limit || order.is_stop()) {
+        if (a.open_orders >= a.max_open_orders) return ErrorCode::MAX_OPEN_ORDERS_EXCEEDED;
+        if (exceeds(add(a.open_notional, notional), a.max_open_notional)) {
+            return ErrorCode::MAX_OPEN_NOTIONAL_EXCEEDED;
+        }
+    }
+    int64_t worst_position = order.side == Side::BUY
+                                 ? e.position + e.open_buy_qty + order.quantity
+                                 : e.open_sell_qty + order.quantity - e.position;
+    if (worst_position > a.max_position) return ErrorCode::MAX_POSITION_EXCEEDED;
+    return ErrorCode::NONE;
 }
 
 bool RiskChecker::is_valid_symbol(const std::string& symbol) const {
-    return std::find(limits_.allowed_symbols.begin(),
-                     limits_.allowed_symbols.end(),
-                     symbol) != limits_.allowed_symbols.end();
+    return symbols_.find(symbol) != SymbolTable::NOT_FOUND;
+}
+
+uint32_t RiskChecker::account_id(const std::string& account) {
+    uint32_t id = accounts_.add(account);
+    if (id == account_state_.size()) {
+        account_state_.push_back(default_account_);
+        positions_.resize(positions_.size() + table_.size());
+    }
+    return id;
+}
+
+RiskChecker::PositionState* RiskChecker::position(uint32_t account, uint32_t symbol) {
+    if (symbol == SymbolTable::NOT_FOUND) return nullptr;
+    return &positions_[account * table_.size() + symbol];
+}
+
+void RiskChecker::update_collar(uint32_t symbol) {
+    ReferenceState& r = references_[symbol];
+    int64_t ref = r.last_trade > 0 ? r.last_trade : r.mid;
+    int64_t bps = table_[symbol].price_band_bps;
+    if (ref <= 0 || bps <= 0) {
+        r.collar = PriceCollar{};
+        return;
+    }
+    int64_t width = div_u64(mul_u64(static_cast<uint64_t>(ref), static_cast<uint64_t>(bps)),
+                            10000);
+    r.collar.lo = ref > width ? ref - width : 0;
+    r.collar.hi = width > INT64_MAX - ref ? INT64_MAX : ref + width;
+}
+
+void RiskChecker::on_rest(const Order& order) {
+    uint32_t acct = account_id(order.account_id);
+    AccountState& a = account_state_[acct];
+    a.open_orders++;
+    a.open_notional = add(a.open_notional, notional_of(order.price, order.remaining_qty));
+    if (auto* p = position(acct, symbols_.find(order.symbol))) {
+        (order.side == Side::BUY ? p->open_buy : p->open_sell) += order.remaining_qty;
+    }
+}
+
+void RiskChecker::on_unrest(const Order& order, int64_t qty) {
+    uint32_t acct = account_id(order.account_id);
+    AccountState& a = account_state_[acct];
+    if (qty >= order.remaining_qty) a.open_orders--;
+    a.open_notional = sub(a.open_notional, notional_of(order.price, qty));
+    if (auto* p = position(acct, symbols_.find(order.symbol))) {
+        (order.side == Side::BUY ? p->open_buy : p->open_sell) -= qty;
+    }
+}
+
+void RiskChecker::on_trade(const Trade& trade) {
+    uint32_t id = symbols_.find(trade.symbol);
+    if (auto* p = position(account_id(trade.buyer_account_id), id)) {
+        p->position += trade.quantity;
+    }
+    if (auto* p = position(account_id(trade.seller_account_id), id)) {
+        p->position -= trade.quantity;
+    }
+    if (id != SymbolTable::NOT_FOUND && references_[id].last_trade != trade.price) {
+        references_[id].last_trade = trade.price;
+        update_collar(id);
+    }
+}
+
+void RiskChecker::add_position(const std::string& account, std::string_view symbol,
+                               int64_t qty) {
+    if (auto* p = position(account_id(account), symbols_.find(symbol))) p->position += qty;
+}
+
+void RiskChecker::set_last_trade(std::string_view symbol, int64_t price) {
+    uint32_t id = symbols_.find(symbol);
+    if (id == SymbolTable::NOT_FOUND) return;
+    references_[id].last_trade = price;
+    update_collar(id);
+}
+
+void RiskChecker::on_bbo(std::string_view symbol, const Bbo& bbo) {
+    uint32_t id = symbols_.find(symbol);
+    if (id == SymbolTable::NOT_FOUND) return;
+    int64_t mid = 0;
+    if (bbo.has_bid() && bbo.has_ask()) mid = bbo.bid.price + (bbo.ask.price - bbo.bid.price) / 2;
+    if (references_[id].mid == mid) return;
+    references_[id].mid = mid;
+    if (references_[id].last_trade == 0) update_collar(id);
+}
+
+PriceCollar RiskChecker::collar(std::string_view symbol) const {
+    uint32_t id = symbols_.find(symbol);
+    return id == SymbolTable::NOT_FOUND ? PriceCollar{} : references_[id].collar;
+}
+
+int64_t RiskChecker::reference_price(std::string_view symbol) const {
+    uint32_t id = symbols_.find(symbol);
+    if (id == SymbolTable::NOT_FOUND) return 0;
+    const ReferenceState& r = references_[id];
+    return r.last_trade > 0 ? r.last_trade : r.mid;
+}
+
+void RiskChecker::reset_exposure() {
+    for (auto& a : account_state_) {
+        a.open_orders = 0;
+        a.open_notional = {};
+    }
+    std::fill(positions_.begin(), positions_.end(), PositionState{});
+    std::fill(references_.begin(), references_.end(), ReferenceState{});
+}
+
+AccountExposure RiskChecker::exposure(std::string_view account, std::string_view symbol) const {
+    AccountExposure e;
+    uint32_t acct = accounts_.find(account);
+    if (acct == SymbolTable::NOT_FOUND) return e;
+
+    const AccountState& a = account_state_[acct];
+    e.open_orders = a.open_orders;
+    e.open_notional = div_u64(a.open_notional, PRICE_SCALE);
+
+    uint32_t id = symbols_.find(symbol);
+    if (id != SymbolTable::NOT_FOUND) {
+        const PositionState& p = positions_[acct * table_.size() + id];
+        e.position = p.position;
+        e.open_buy_qty = p.open_buy;
+        e.open_sell_qty = p.open_sell;
+    }
+    return e;
 }
 
 }  // namespace exchange
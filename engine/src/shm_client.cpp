@@ -0,0 +1,20 @@
+// Atomic operations for the Python client of the shared-memory transport
+// (api/app/shm_transport.py), which can only do plain loads and stores on
+// the mapping. Built as a small shared library next to the engine binary and
+// called through ctypes; the operations match what ShmTransport uses on the
+// engine side, so both ends of the wakeup handshake are sequentially
+// consistent on any architecture.
+#include <atomic>
+#include <cstdint>
+
+extern "C" {
+
+uint32_t exchange_shm_fetch_add(uint32_t* word, uint32_t value) {
+    return std::atomic_ref<uint32_t>(*word).fetch_add(value);
+}
+
+void exchange_shm_store(uint32_t* word, uint32_t value) {
+    std::atomic_ref<uint32_t>(*word).store(value);
+}
+
+}  // extern "C"
@@ -0,0 +1,220 @@
+#include "exchange/shm_transport.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace exchange {
+
+namespace {
+
+constexpr int SPIN_ITERATIONS = 20000;
+constexpr long WAIT_TIMEOUT_NS = 100'000'000;  // re-check client_closed every 100ms
+
+struct ShmHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t ring_bytes;
+    std::atomic<uint32_t> client_closed;
+};
+
+struct ShmRingHeader {
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> tail;
+    alignas(64) std::atomic<uint32_t> seq;
+    std::atomic<uint32_t> waiting;
+};
+
+constexpr size_t FILE_HEADER_BYTES = 64;
+constexpr size_t RING_HEADER_BYTES = 192;
+
+static_assert(sizeof(ShmHeader) <= FILE_HEADER_BYTES);
+static_assert(sizeof(ShmRingHeader) == RING_HEADER_BYTES);
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+struct RingView {
+    ShmRingHeader* hdr;
+    char* data;
+    uint64_t size;
+
+    void copy_out(uint64_t pos, void* dst, size_t len) const {
+        size_t off = pos % size;
+        size_t first = std::min<size_t>(len, size - off);
+        std::memcpy(dst, data + off, first);
+        std::memcpy(static_cast<char*>(dst) + first, data, len - first);
+    }
+
+    void copy_in(uint64_t pos, const void* src, size_t len) {
+        size_t off = pos % size;
+        size_t first = std::min<size_t>(len, size - off);
+        std::memcpy(data + off, src, first);
+        std::memcpy(data, static_cast<const char*>(src) + first, len - first);
+    }
+};
+
+RingView ring_at(void* base, size_t index, uint32_t ring_bytes) {
+    char* p = static_cast<char*>(base) + FILE_HEADER_BYTES +
+              index * (RING_HEADER_BYTES + ring_bytes);
+    return RingView{reinterpret_cast<ShmRingHeader*>(p), p + RING_HEADER_BYTES, ring_bytes};
+}
+
+enum class ReadStatus { EMPTY, MESSAGE, CORRUPT };
+
+// The client owns the request ring, so its indices and length prefixes are
+// checked against the ring before anything is copied out
+ReadStatus try_read(RingView ring, std::string& out) {
+    uint64_t tail = ring.hdr->tail.load(std::memory_order_relaxed);
+    uint64_t head = ring.hdr->head.load(std::memory_order_acquire);
+    if (head == tail) return ReadStatus::EMPTY;
+
+    uint64_t available = head - tail;
+    if (available < sizeof(uint32_t) || available > ring.size) return ReadStatus::CORRUPT;
+
+    uint32_t len = 0;
+    ring.copy_out(tail, &len, sizeof(len));
+    if (len > available - sizeof(len)) return ReadStatus::CORRUPT;
+    out.resize(len);
+    ring.copy_out(tail + sizeof(len), out.data(), len);
+    ring.hdr->tail.store(tail + sizeof(len) + len, std::memory_order_release);
+    return ReadStatus::MESSAGE;
+}
+
+#ifdef __linux__
+// Shared (not FUTEX_PRIVATE) operations: the word lives in a cross-process mapping
+void futex_wait(std::atomic<uint32_t>* word, uint32_t expected) {
+    timespec timeout{0, WAIT_TIMEOUT_NS};
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, &timeout,
+            nullptr, 0);
+}
+
+void futex_wake(std::atomic<uint32_t>* word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+}
+#endif
+
+}  // namespace
+
+ShmTransport::ShmTransport(std::string name, uint32_t ring_bytes)
+    : name_(std::move(name)), ring_bytes_(ring_bytes) {}
+
+ShmTransport::~ShmTransport() {
+#ifdef __linux__
+    if (base_) {
+        munmap(base_, map_size_);
+        shm_unlink(("/" + name_).c_str());
+    }
+#endif
+}
+
+bool ShmTransport::create() {
+#ifdef __linux__
+    std::string shm_name = "/" + name_;
+    shm_unlink(shm_name.c_str());  // stale object from a crashed run
+
+    int fd = shm_open(shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) return false;
+
+    map_size_ = FILE_HEADER_BYTES + 2 * (RING_HEADER_BYTES + ring_bytes_);
+    if (ftruncate(fd, static_cast<off_t>(map_size_)) != 0) {
+        close(fd);
+        shm_unlink(shm_name.c_str());
+        return false;
+    }
+
+    base_ = mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base_ == MAP_FAILED) {
+        base_ = nullptr;
+        shm_unlink(shm_name.c_str());
+        return false;
+    }
+
+    // ftruncate zero-fills, so all indices and flags start at 0
+    auto* hdr = static_cast<ShmHeader*>(base_);
+    hdr->version = VERSION;
+    hdr->ring_bytes = ring_bytes_;
+    // Magic last: clients treat it as the ready signal
+    std::atomic_thread_fence(std::memory_order_release);
+    hdr->magic = MAGIC;
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool ShmTransport::receive(std::string& out) {
+#ifdef __linux__
+    auto* hdr = static_cast<ShmHeader*>(base_);
+    RingView ring = ring_at(base_, 0, ring_bytes_);
+
+    // Spinning only pays off when the client can run on another core
+    static const int spin_iterations = std::thread::hardware_concurrency() > 1 ? SPIN_ITERATIONS : 0;
+
+    while (true) {
+        for (int i = 0; i < spin_iterations; ++i) {
+            ReadStatus status = try_read(ring, out);
+            if (status != ReadStatus::EMPTY) return status == ReadStatus::MESSAGE;
+        }
+
+        // Snapshot the futex word before the final emptiness check so a
+        // concurrent send either shows up in the check or fails the wait
+        uint32_t seq = ring.hdr->seq.load();
+        ring.hdr->waiting.store(1);
+        ReadStatus status = try_read(ring, out);
+        if (status != ReadStatus::EMPTY) {
+            ring.hdr->waiting.store(0);
+            return status == ReadStatus::MESSAGE;
+        }
+        if (hdr->client_closed.load()) {
+            ring.hdr->waiting.store(0);
+            return false;
+        }
+        futex_wait(&ring.hdr->seq, seq);
+        ring.hdr->waiting.store(0);
+    }
+#else
+    (void)out;
+    return false;
+#endif
+}
+
+bool ShmTransport::send(const std::string& message) {
+#ifdef __linux__
+    auto* hdr = static_cast<ShmHeader*>(base_);
+    RingView ring = ring_at(base_, 1, ring_bytes_);
+
+    uint32_t len = static_cast<uint32_t>(message.size());
+    uint64_t needed = sizeof(len) + uint64_t{len};
+    if (needed > ring_bytes_) return false;
+
+    uint64_t head = ring.hdr->head.load(std::memory_order_relaxed);
+    while (head + needed - ring.hdr->tail.load(std::memory_order_acquire) > ring_bytes_) {
+        if (hdr->client_closed.load()) return false;
+        std::this_thread::yield();
+    }
+
+    ring.copy_in(head, &len, sizeof(len));
+    ring.copy_in(head + sizeof(len), message.data(), len);
+    ring.hdr->head.store(head + needed, std::memory_order_release);
+
+    ring.hdr->seq.fetch_add(1);
+    if (ring.hdr->waiting.load()) futex_wake(&ring.hdr->seq);
+    return true;
+#else
+    (void)message;
+    return false;
+#endif
+}
+
+}  // namespace exchange
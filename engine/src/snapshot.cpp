@@ -6,13 +6,55 @@
 
 namespace exchange {
 
+namespace {
+
+// Idempotency entries as [hi, lo, order_id, timestamp_ns, response]
+nlohmann::json idempotency_to_json(const std::deque<IdempotencyStore::Entry>& entries) {
+    auto arr = nlohmann::json::array();
+    for (const auto& e : entries) {
+        const auto& r = e.response;
+        arr.push_back({e.key.hi, e.key.lo, e.order_id, e.timestamp_ns,
+                       {{"success", r.success},
+                        {"error_code", r.error_code},
+                        {"order", r.order},
+                        {"trades", r.trades}}});
+    }
+    return arr;
+}
+
+std::deque<IdempotencyStore::Entry> idempotency_from_json(const nlohmann::json& arr) {
+    std::deque<IdempotencyStore::Entry> entries;
+    for (const auto& e : arr) {
+        IdempotencyStore::Entry entry{{e.at(0).get<uint64_t>(), e.at(1).get<uint64_t>()},
+                                      e.at(2).get<uint64_t>(),
+                                      e.at(3).get<uint64_t>(),
+                                      {}};
+        if (e.size() > 4) {
+            const auto& r = e.at(4);
+            entry.response.success = r.at("success").get<bool>();
+            r.at("error_code").get_to(entry.response.error_code);
+            r.at("order").get_to(entry.response.order);
+            r.at("trades").get_to(entry.response.trades);
+        }
+        entries.push_back(std::move(entry));
+    }
+    return entries;
+}
+
+}  // namespace
+
 void to_json(nlohmann::json& j, const Snapshot& s) {
     j = nlohmann::json{
         {"sequence", s.sequence},
         {"timestamp_ns", s.timestamp_ns},
         {"next_order_id", s.next_order_id},
         {"next_trade_id", s.next_trade_id},
-        {"orders", s.orders}};
+        {"orders", s.orders},
+        {"blocked_accounts", s.blocked_accounts},
+        {"symbol_states", s.symbol_states},
+        {"positions", s.positions},
+        {"last_trade_prices", s.last_trade_prices},
+        {"idempotency_keys", idempotency_to_json(s.idempotency_keys)}};
 }
 
 void from_json(const nlohmann::json& j, Snapshot& s) {
@@ -21,6 +63,13 @@ void from_json(const nlohmann::json& j, Snapshot& s) {
     j.at("next_order_id").get_to(s.next_order_id);
     j.at("next_trade_id").get_to(s.next_trade_id);
     j.at("orders").get_to(s.orders);
+    s.blocked_accounts = j.value("blocked_accounts", std::vector<std::string>{});
+    s.symbol_states = j.value("symbol_states", std::map<std::string, SymbolState>{});
+    s.positions = j.value("positions", Snapshot::Positions{});
+    s.last_trade_prices = j.value("last_trade_prices", std::map<std::string, int64_t>{});
+    if (j.contains("idempotency_keys")) {
+        s.idempotency_keys = idempotency_from_json(j.at("idempotency_keys"));
+    }
 }
 
 SnapshotManager::SnapshotManager(const std::string& path, uint64_t interval)
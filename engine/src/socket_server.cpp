@@ -0,0 +1,248 @@
+#include "exchange/socket_server.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace exchange {
+
+namespace {
+
+constexpr int MAX_EVENTS = 64;
+constexpr size_t READ_CHUNK = 64 * 1024;
+// Longest request line; a client sending more without a newline is dropped
+constexpr size_t MAX_LINE_BYTES = 1 << 20;
+// Reading from a connection pauses while this much output is queued for it,
+// so a client that sends without reading cannot grow its buffers unbounded
+constexpr size_t OUT_HIGH_WATER = 4 << 20;
+
+}  // namespace
+
+SocketServer::SocketServer(ProtocolHandler& handler, std::string path)
+    : handler_(handler), path_(std::move(path)) {}
+
+SocketServer::~SocketServer() {
+#ifdef __linux__
+    for (auto& [fd, _] : connections_) ::close(fd);
+    if (epoll_fd_ >= 0) ::close(epoll_fd_);
+    if (listen_fd_ >= 0) {
+        ::close(listen_fd_);
+        ::unlink(path_.c_str());
+    }
+#endif
+}
+
+bool SocketServer::listen() {
+#ifdef __linux__
+    sockaddr_un addr{};
+    if (path_.size() >= sizeof(addr.sun_path)) return false;
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path_.c_str(), path_.size() + 1);
+
+    ::unlink(path_.c_str());  // stale socket from a previous run
+
+    listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) return false;
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(listen_fd_, SOMAXCONN) != 0) {
+        return false;
+    }
+
+    epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ < 0) return false;
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = listen_fd_;
+    return ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &ev) == 0;
+#else
+    return false;
+#endif
+}
+
+void SocketServer::run() {
+#ifdef __linux__
+    epoll_event events[MAX_EVENTS];
+
+    while (!handler_.shutdown_requested()) {
+        int n = ::epoll_wait(epoll_fd_, events, MAX_EVENTS, -1);
+        stats_.wait_syscalls++;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "[ENGINE] epoll_wait failed: " << std::strerror(errno) << std::endl;
+            return;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == listen_fd_) {
+                accept_clients();
+                continue;
+            }
+
+            auto it = connections_.find(fd);
+            if (it == connections_.end()) continue;
+
+            bool keep;
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                keep = on_readable(fd, it->second);
+            } else {
+                keep = serve(fd, it->second);
+            }
+            if (!keep) close_connection(fd);
+        }
+    }
+
+    // Deliver the shutdown acknowledgement (and anything queued before it)
+    for (auto& [fd, conn] : connections_) {
+        int flags = ::fcntl(fd, F_GETFL);
+        ::fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+        flush(fd, conn);
+    }
+#endif
+}
+
+void SocketServer::accept_clients() {
+#ifdef __linux__
+    while (true) {
+        int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;  // EAGAIN: no more pending connections
+
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            ::close(fd);
+            continue;
+        }
+        connections_[fd].events = ev.events;
+        stats_.connections_accepted++;
+    }
+#endif
+}
+
+bool SocketServer::on_readable(int fd, Connection& conn) {
+#ifdef __linux__
+    char buf[READ_CHUNK];
+
+    while (!conn.peer_closed && conn.out.size() < OUT_HIGH_WATER) {
+        ssize_t r = ::read(fd, buf, sizeof(buf));
+        stats_.read_syscalls++;
+        if (r > 0) {
+            conn.in.append(buf, static_cast<size_t>(r));
+            if (!handle_lines(conn)) return false;
+            continue;
+        }
+        if (r == 0) {
+            conn.peer_closed = true;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            return false;
+        }
+        break;
+    }
+
+    return serve(fd, conn);
+#else
+    (void)fd;
+    (void)conn;
+    return false;
+#endif
+}
+
+bool SocketServer::serve(int fd, Connection& conn) {
+#ifdef __linux__
+    // Lines held back by the high-water mark are answered as output drains
+    do {
+        if (!handle_lines(conn) || !flush(fd, conn)) return false;
+    } while (conn.out.empty() && !handler_.shutdown_requested() &&
+             conn.in.find('\n') != std::string::npos);
+
+    update_events(fd, conn);
+    // A client that closed its side still gets every response it asked for
+    return !(conn.peer_closed && conn.out.empty());
+#else
+    (void)fd;
+    (void)conn;
+    return false;
+#endif
+}
+
+bool SocketServer::handle_lines(Connection& conn) {
+    // Each complete line is one request; a partial tail waits for more data
+    size_t start = 0;
+    size_t nl;
+    while (conn.out.size() < OUT_HIGH_WATER && !handler_.shutdown_requested() &&
+           (nl = conn.in.find('\n', start)) != std::string::npos) {
+        if (nl > start) {
+            conn.out += handler_.handle(conn.in.substr(start, nl - start));
+            conn.out += '\n';
+            stats_.requests++;
+        }
+        start = nl + 1;
+    }
+    conn.in.erase(0, start);
+
+    return conn.in.size() <= MAX_LINE_BYTES || conn.in.find('\n') != std::string::npos;
+}
+
+bool SocketServer::flush(int fd, Connection& conn) {
+#ifdef __linux__
+    size_t off = 0;
+    while (off < conn.out.size()) {
+        ssize_t w = ::send(fd, conn.out.data() + off, conn.out.size() - off, MSG_NOSIGNAL);
+        stats_.write_syscalls++;
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return false;
+        }
+        off += static_cast<size_t>(w);
+    }
+    conn.out.erase(0, off);
+    return true;
+#else
+    (void)fd;
+    (void)conn;
+    return false;
+#endif
+}
+
+void SocketServer::update_events(int fd, Connection& conn) {
+#ifdef __linux__
+    // Read only while there is room for the responses, and only watch for
+    // writability while output is backed up
+    uint32_t events = 0;
+    if (!conn.peer_closed && conn.out.size() < OUT_HIGH_WATER) events |= EPOLLIN;
+    if (!conn.out.empty()) events |= EPOLLOUT;
+    if (events == conn.events) return;
+
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.fd = fd;
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev);
+    conn.events = events;
+#else
+    (void)fd;
+    (void)conn;
+#endif
+}
+
+void SocketServer::close_connection(int fd) {
+#ifdef __linux__
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+#endif
+    connections_.erase(fd);
+}
+
+}  // namespace exchange
@@ -0,0 +1,78 @@
+#include "exchange/stop_book.hpp"
+
+#include <algorithm>
+
+namespace exchange {
+
+namespace {
+
+// Both maps are ordered next-to-fire first, so the triggered stops are the
+// prefix ending at upper_bound(price)
+template <typename Levels>
+void take_triggered(Levels& levels, int64_t price, std::vector<Order*>& out,
+                    std::unordered_map<uint64_t, Order*>& index) {
+    auto end = levels.upper_bound(price);
+    for (auto it = levels.begin(); it != end; ++it) {
+        for (Order* o : it->second) {
+            out.push_back(o);
+            index.erase(o->id);
+        }
+    }
+    levels.erase(levels.begin(), end);
+}
+
+template <typename Levels>
+void erase_from(Levels& levels, Order* order) {
+    auto it = levels.find(order->stop_price);
+    if (it == levels.end()) return;
+    auto& v = it->second;
+    v.erase(std::remove(v.begin(), v.end(), order), v.end());
+    if (v.empty()) levels.erase(it);
+}
+
+}  // namespace
+
+void StopBook::add(Order* order) {
+    if (order->side == Side::BUY) {
+        buys_[order->stop_price].push_back(order);
+    } else {
+        sells_[order->stop_price].push_back(order);
+    }
+    orders_[order->id] = order;
+}
+
+bool StopBook::remove(uint64_t order_id) {
+    auto it = orders_.find(order_id);
+    if (it == orders_.end()) return false;
+    Order* order = it->second;
+    if (order->side == Side::BUY) {
+        erase_from(buys_, order);
+    } else {
+        erase_from(sells_, order);
+    }
+    orders_.erase(it);
+    return true;
+}
+
+void StopBook::trigger(int64_t price, std::vector<Order*>& out) {
+    last_price_ = price;
+    if (orders_.empty()) return;
+    take_triggered(buys_, price, out, orders_);
+    take_triggered(sells_, price, out, orders_);
+}
+
+bool StopBook::is_triggered(const Order& order) const {
+    if (last_price_ == 0) return false;
+    return order.side == Side::BUY ? last_price_ >= order.stop_price
+                                   : last_price_ <= order.stop_price;
+}
+
+std::vector<Order*> StopBook::get_all() const {
+    std::vector<Order*> result;
+    result.reserve(orders_.size());
+    for (const auto& [_, level] : buys_) result.insert(result.end(), level.begin(), level.end());
+    for (const auto& [_, level] : sells_) result.insert(result.end(), level.begin(), level.end());
+    return result;
+}
+
+}  // namespace exchange
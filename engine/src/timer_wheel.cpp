@@ -0,0 +1,84 @@
+#include "exchange/timer_wheel.hpp"
+
+#include <bit>
+
+namespace exchange {
+
+void TimerWheel::schedule(uint64_t id, uint64_t deadline_ns) {
+    insert({id, deadline_ns / tick_ns_ + (deadline_ns % tick_ns_ != 0)});
+    ++size_;
+}
+
+// Files t relative to now_tick_: at the level of the highest slot digit where
+// its tick differs from now_tick_, so the slot is always ahead of the wheel
+void TimerWheel::insert(const Timer& t) {
+    if (t.tick <= now_tick_) {
+        due_.push_back(t);
+        return;
+    }
+    int level = 0;
+    while (level < LEVELS - 1 && (t.tick >> (SLOT_BITS * (level + 1))) !=
+                                     (now_tick_ >> (SLOT_BITS * (level + 1)))) {
+        ++level;
+    }
+    size_t slot = (t.tick >> (SLOT_BITS * level)) & SLOT_MASK;
+    slots_[level][slot].push_back(t);
+    occupied_[level] |= uint64_t{1} << slot;
+}
+
+void TimerWheel::advance(uint64_t now_ns, std::vector<uint64_t>& out) {
+    for (const Timer& t : due_) out.push_back(t.id);
+    size_ -= due_.size();
+    due_.clear();
+
+    const uint64_t target = now_ns / tick_ns_;
+    while (size_ > 0) {
+        // Earliest start tick of an occupied slot ahead of the wheel; every
+        // occupied slot is ahead of the current digit at its level
+        uint64_t next = UINT64_MAX;
+        int next_level = -1;
+        for (int level = 0; level < LEVELS; ++level) {
+            int shift = SLOT_BITS * level;
+            uint64_t digit = (now_tick_ >> shift) & SLOT_MASK;
+            // slots above digit; none once digit is 63, as 2 << 63 wraps to 0
+            uint64_t ahead = occupied_[level] & ~((uint64_t{2} << digit) - 1);
+            if (ahead == 0) continue;
+            auto slot = static_cast<uint64_t>(std::countr_zero(ahead));
+            uint64_t window = now_tick_ >> (shift + SLOT_BITS) << (shift + SLOT_BITS);
+            uint64_t start = window | (slot << shift);
+            if (start < next) {
+                next = start;
+                next_level = level;
+            }
+        }
+        if (next_level < 0 || next > target) break;
+
+        // Move the wheel to the slot and re-file its timers one level down,
+        // or out if due
+        now_tick_ = next;
+        size_t slot = (next >> (SLOT_BITS * next_level)) & SLOT_MASK;
+        std::vector<Timer> timers;
+        timers.swap(slots_[next_level][slot]);
+        occupied_[next_level] &= ~(uint64_t{1} << slot);
+        for (const Timer& t : timers) {
+            if (t.tick <= now_tick_) {
+                out.push_back(t.id);
+                --size_;
+            } else {
+                insert(t);
+            }
+        }
+    }
+    if (target > now_tick_) now_tick_ = target;
+}
+
+void TimerWheel::clear() {
+    for (auto& level : slots_) {
+        for (auto& slot : level) slot.clear();
+    }
+    occupied_.fill(0);
+    due_.clear();
+    size_ = 0;
+}
+
+}  // namespace exchange
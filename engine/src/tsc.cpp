@@ -0,0 +1,30 @@
+#include "exchange/tsc.hpp"
+
+namespace exchange {
+
+namespace {
+
+double calibrate() {
+    using Clock = std::chrono::steady_clock;
+    constexpr auto WINDOW = std::chrono::milliseconds(10);
+
+    auto c0 = Clock::now();
+    uint64_t t0 = rdtsc();
+    Clock::time_point c1;
+    do {
+        c1 = Clock::now();
+    } while (c1 - c0 < WINDOW);
+    uint64_t t1 = rdtsc();
+
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(c1 - c0).count();
+    return t1 > t0 ? static_cast<double>(ns) / static_cast<double>(t1 - t0) : 1.0;
+}
+
+}  // namespace
+
+double tsc_ns_per_tick() {
+    static const double ns_per_tick = calibrate();
+    return ns_per_tick;
+}
+
+}  // namespace exchange
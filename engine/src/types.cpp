@@ -1,5 +1,7 @@
 #include "exchange/types.hpp"
 
+#include "exchange/clock.hpp"
+
 namespace exchange {
 
 void to_json(nlohmann::json& j, const Order& o) {
@@ -8,11 +10,23 @@ void to_json(nlohmann::json& j, const Order& o) {
                        {"symbol", o.symbol},
                        {"side", o.side},
                        {"type", o.type},
+                       {"time_in_force", o.time_in_force},
+                       {"self_trade_prevention", o.self_trade_prevention},
                        {"price", o.price},
                        {"quantity", o.quantity},
                        {"remaining_qty", o.remaining_qty},
                        {"timestamp_ns", o.timestamp_ns},
                        {"status", o.status}};
+    if (o.stop_price != 0) {
+        j["stop_price"] = o.stop_price;
+    }
+    if (o.display_qty != 0) {
+        j["display_qty"] = o.display_qty;
+        j["visible_qty"] = o.visible_qty;
+    }
+    if (o.expire_ts_ns != 0) {
+        j["expire_ts_ns"] = o.expire_ts_ns;
+    }
     if (!o.idempotency_key.empty()) {
         j["idempotency_key"] = o.idempotency_key;
     }
@@ -26,11 +40,44 @@ void from_json(const nlohmann::json& j, Order& o) {
     j.at("symbol").get_to(o.symbol);
     j.at("side").get_to(o.side);
     j.at("type").get_to(o.type);
+    if (j.contains("time_in_force")) {
+        j.at("time_in_force").get_to(o.time_in_force);
+    }
+    if (j.contains("self_trade_prevention")) {
+        j.at("self_trade_prevention").get_to(o.self_trade_prevention);
+    }
     if (j.contains("price")) {
         j.at("price").get_to(o.price);
     }
+    if (j.contains("stop_price")) {
+        j.at("stop_price").get_to(o.stop_price);
+    }
+    if (j.contains("display_qty")) {
+        j.at("display_qty").get_to(o.display_qty);
+    }
     j.at("quantity").get_to(o.quantity);
     o.remaining_qty = o.quantity;
+    // Engine-assigned fields are present when reading back events and snapshots
+    if (j.contains("id")) {
+        j.at("id").get_to(o.id);
+    }
+    if (j.contains("remaining_qty")) {
+        j.at("remaining_qty").get_to(o.remaining_qty);
+    }
+    if (j.contains("timestamp_ns")) {
+        j.at("timestamp_ns").get_to(o.timestamp_ns);
+    }
+    if (j.contains("visible_qty")) {
+        j.at("visible_qty").get_to(o.visible_qty);
+    } else {
+        o.reset_display();
+    }
+    if (j.contains("expire_ts_ns") && !j["expire_ts_ns"].is_null()) {
+        j.at("expire_ts_ns").get_to(o.expire_ts_ns);
+    }
+    if (j.contains("status")) {
+        j.at("status").get_to(o.status);
+    }
     if (j.contains("idempotency_key") && !j["idempotency_key"].is_null()) {
         j.at("idempotency_key").get_to(o.idempotency_key);
     }
@@ -92,6 +139,12 @@ void to_json(nlohmann::json& j, const BookLevel& l) {
     j = nlohmann::json{{"price", l.price}, {"quantity", l.quantity}, {"order_count", l.order_count}};
 }
 
+void to_json(nlohmann::json& j, const Bbo& b) {
+    j = nlohmann::json{{"bid", nullptr}, {"ask", nullptr}};
+    if (b.has_bid()) j["bid"] = b.bid;
+    if (b.has_ask()) j["ask"] = b.ask;
+}
+
 std::string error_message(ErrorCode code) {
     switch (code) {
         case ErrorCode::NONE:
@@ -105,7 +158,7 @@ std::string error_message(ErrorCode code) {
         case ErrorCode::INVALID_SIDE:
             return "Side must be BUY or SELL";
         case ErrorCode::INVALID_ORDER_TYPE:
-            return "Order type must be LIMIT or MARKET";
+            return "Unknown order type, or post-only without a limit price";
         case ErrorCode::ORDER_NOT_FOUND:
             return "Order not found";
         case ErrorCode::INSUFFICIENT_BALANCE:
@@ -120,6 +173,36 @@ std::string error_message(ErrorCode code) {
             return "No liquidity available for market order";
         case ErrorCode::DUPLICATE_IDEMPOTENCY_KEY:
             return "Duplicate idempotency key";
+        case ErrorCode::INVALID_TICK_SIZE:
+            return "Price is not a multiple of the symbol's tick size";
+        case ErrorCode::INVALID_LOT_SIZE:
+            return "Quantity is not a multiple of the symbol's lot size";
+        case ErrorCode::PRICE_OUT_OF_BAND:
+            return "Price is outside the symbol's allowed band";
+        case ErrorCode::MAX_OPEN_ORDERS_EXCEEDED:
+            return "Account has too many open orders";
+        case ErrorCode::MAX_OPEN_NOTIONAL_EXCEEDED:
+            return "Account open order notional would exceed its limit";
+        case ErrorCode::MAX_POSITION_EXCEEDED:
+            return "Account position would exceed its limit";
+        case ErrorCode::ACCOUNT_BLOCKED:
+            return "Account is blocked from placing orders";
+        case ErrorCode::FOK_NOT_FILLABLE:
+            return "Fill-or-kill order cannot be filled in full";
+        case ErrorCode::POST_ONLY_WOULD_CROSS:
+            return "Post-only order would take liquidity";
+        case ErrorCode::SYMBOL_IN_AUCTION:
+            return "Symbol is in a call auction";
+        case ErrorCode::SYMBOL_HALTED:
+            return "Trading in the symbol is halted";
+        case ErrorCode::SYMBOL_CLOSED:
+            return "Symbol is closed";
+        case ErrorCode::INVALID_STATE_TRANSITION:
+            return "Symbol cannot move to that state from its current one";
+        case ErrorCode::INVALID_EXPIRY:
+            return "Expiry time has already passed";
+        case ErrorCode::DUPLICATE_CLIENT_ORDER_ID:
+            return "Client order id is already used by an open order of the account";
         case ErrorCode::INTERNAL_ERROR:
             return "Internal engine error";
     }
@@ -127,9 +210,7 @@ std::string error_message(ErrorCode code) {
 }
 
 uint64_t now_ns() {
-    auto now = std::chrono::high_resolution_clock::now();
-    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch());
-    return static_cast<uint64_t>(ns.count());
+    return TscClock::instance().now_ns();
 }
 
 }  // namespace exchange
\ No newline at end of file
@@ -0,0 +1,331 @@
+#include "exchange/workload.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <numbers>
+
+#include "exchange/matching_engine.hpp"
+
+namespace exchange {
+
+namespace {
+
+constexpr char TRACE_MAGIC[8] = {'A', 'Z', 'T', 'R', 'A', 'C', 'E', '1'};
+constexpr uint32_t TRACE_VERSION = 1;
+constexpr size_t OP_RECORD_BYTES = 36;
+
+// Cancels mostly hit recently placed orders, like real quote updates
+constexpr double RECENT_CANCEL_P = 0.1;
+
+void put_u8(std::string& out, uint8_t v) { out.push_back(static_cast<char>(v)); }
+
+void put_u32(std::string& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>(v >> (8 * i)));
+}
+
+void put_u64(std::string& out, uint64_t v) {
+    for (int i = 0; i < 8; ++i) out.push_back(static_cast<char>(v >> (8 * i)));
+}
+
+// Bounds-checked little-endian reader over the whole file
+struct Reader {
+    const std::string& buf;
+    size_t pos = 0;
+
+    bool has(size_t n) const { return buf.size() - pos >= n; }
+
+    uint8_t u8() { return static_cast<uint8_t>(buf[pos++]); }
+
+    uint32_t u32() {
+        uint32_t v = 0;
+        for (int i = 0; i < 4; ++i) v |= uint32_t{static_cast<uint8_t>(buf[pos++])} << (8 * i);
+        return v;
+    }
+
+    uint64_t u64() {
+        uint64_t v = 0;
+        for (int i = 0; i < 8; ++i) v |= uint64_t{static_cast<uint8_t>(buf[pos++])} << (8 * i);
+        return v;
+    }
+};
+
+}  // namespace
+
+WorkloadGenerator::WorkloadGenerator(WorkloadConfig config)
+    : config_(std::move(config)), rng_(config_.seed) {
+    if (config_.symbols.size() > 256) config_.symbols.resize(256);
+    if (config_.accounts == 0) config_.accounts = 1;
+    mids_.assign(config_.symbols.size(), config_.start_price);
+
+    double total = 0;
+    for (size_t i = 0; i < config_.symbols.size(); ++i) {
+        total += i < config_.symbol_weights.size() ? config_.symbol_weights[i] : 1.0;
+        symbol_cdf_.push_back(total);
+    }
+}
+
+double WorkloadGenerator::uniform() {
+    return static_cast<double>(rng_() >> 11) * 0x1.0p-53;
+}
+
+uint64_t WorkloadGenerator::geometric(double p) {
+    if (p >= 1.0) return 0;
+    p = std::max(p, 1e-6);
+    double u = uniform();
+    return static_cast<uint64_t>(std::floor(std::log1p(-u) / std::log1p(-p)));
+}
+
+uint8_t WorkloadGenerator::draw_symbol() {
+    double x = uniform() * symbol_cdf_.back();
+    auto it = std::upper_bound(symbol_cdf_.begin(), symbol_cdf_.end(), x);
+    auto idx = std::min<size_t>(static_cast<size_t>(it - symbol_cdf_.begin()),
+                                symbol_cdf_.size() - 1);
+    return static_cast<uint8_t>(idx);
+}
+
+int64_t WorkloadGenerator::draw_qty() {
+    // Box-Muller, one normal per call
+    double u1 = 1.0 - uniform();
+    double u2 = uniform();
+    double z = std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * std::numbers::pi * u2);
+    double qty = static_cast<double>(config_.median_qty) * std::exp(config_.qty_sigma * z);
+    return std::max<int64_t>(1, std::llround(qty));
+}
+
+uint64_t WorkloadGenerator::draw_gap() {
+    double mean = static_cast<double>(config_.mean_gap_ns);
+    if (burst_left_ > 0) {
+        burst_left_--;
+        mean /= 100.0;
+    } else if (uniform() < config_.burst_probability) {
+        burst_left_ = config_.burst_length;
+    }
+    return static_cast<uint64_t>(-std::log(1.0 - uniform()) * mean);
+}
+
+int64_t WorkloadGenerator::limit_price(uint8_t symbol, Side side) {
+    int64_t mid = mids_[symbol];
+    int64_t dir = side == Side::BUY ? -1 : 1;
+
+    int64_t ticks;
+    if (uniform() < config_.aggressive_ratio) {
+        ticks = -static_cast<int64_t>(1 + geometric(0.5));  // through the mid
+    } else {
+        uint64_t behind = std::min<uint64_t>(geometric(config_.level_decay),
+                                             config_.max_levels > 0 ? config_.max_levels - 1 : 0);
+        ticks = 1 + static_cast<int64_t>(behind);
+    }
+    return std::max(config_.tick, mid + dir * ticks * config_.tick);
+}
+
+WorkloadGenerator::LiveOrder WorkloadGenerator::take_live() {
+    size_t back = std::min<size_t>(geometric(RECENT_CANCEL_P), live_.size() - 1);
+    size_t idx = live_.size() - 1 - back;
+    LiveOrder o = live_[idx];
+    live_[idx] = live_.back();
+    live_.pop_back();
+    return o;
+}
+
+TraceOp WorkloadGenerator::next() {
+    TraceOp op;
+    op.gap_ns = draw_gap();
+
+    uint8_t sym = draw_symbol();
+    if (uniform() < config_.mid_move_probability) {
+        mids_[sym] += (uniform() < 0.5 ? -1 : 1) * config_.tick;
+        mids_[sym] = std::max(mids_[sym], 2 * config_.tick);
+    }
+
+    double u = uniform();
+    if (!live_.empty() && u < config_.cancel_ratio) {
+        LiveOrder target = take_live();
+        op.type = TraceOpType::CANCEL;
+        op.symbol = target.symbol;
+        op.side = target.side;
+        op.account = target.account;
+        op.ref = target.op;
+    } else if (!live_.empty() && u < config_.cancel_ratio + config_.replace_ratio) {
+        LiveOrder target = take_live();
+        op.type = TraceOpType::REPLACE;
+        op.symbol = target.symbol;
+        op.side = target.side;
+        op.account = target.account;
+        op.ref = target.op;
+        op.price = limit_price(op.symbol, op.side);
+        op.quantity = draw_qty();
+        live_.push_back({op_index_, op.symbol, op.side, op.account});
+    } else {
+        op.symbol = sym;
+        op.side = uniform() < 0.5 ? Side::BUY : Side::SELL;
+        op.account = static_cast<uint32_t>(uniform() * config_.accounts);
+        if (uniform() < config_.market_ratio) {
+            op.order_type = OrderType::MARKET;
+            op.quantity = draw_qty() * config_.sweep_multiplier;
+        } else {
+            op.price = limit_price(sym, op.side);
+            op.quantity = draw_qty();
+            live_.push_back({op_index_, op.symbol, op.side, op.account});
+        }
+    }
+
+    op_index_++;
+    return op;
+}
+
+Trace WorkloadGenerator::generate(size_t count) {
+    Trace t;
+    t.symbols = config_.symbols;
+    t.accounts = config_.accounts;
+    t.ops.reserve(count);
+    for (size_t i = 0; i < count; ++i) t.ops.push_back(next());
+    return t;
+}
+
+bool write_trace(const std::string& path, const Trace& trace) {
+    std::string out(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    put_u32(out, TRACE_VERSION);
+    put_u32(out, static_cast<uint32_t>(trace.symbols.size()));
+    for (const auto& s : trace.symbols) {
+        put_u8(out, static_cast<uint8_t>(std::min<size_t>(s.size(), 255)));
+        out.append(s, 0, 255);
+    }
+    put_u32(out, trace.accounts);
+    put_u64(out, trace.ops.size());
+
+    out.reserve(out.size() + trace.ops.size() * OP_RECORD_BYTES);
+    for (const auto& op : trace.ops) {
+        put_u32(out, static_cast<uint32_t>(std::min<uint64_t>(op.gap_ns, UINT32_MAX)));
+        put_u8(out, static_cast<uint8_t>(op.type));
+        put_u8(out, static_cast<uint8_t>(op.side));
+        put_u8(out, static_cast<uint8_t>(op.order_type));
+        put_u8(out, op.symbol);
+        put_u32(out, op.account);
+        put_u64(out, static_cast<uint64_t>(op.price));
+        put_u64(out, static_cast<uint64_t>(op.quantity));
+        put_u64(out, op.ref);
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) return false;
+    file.write(out.data(), static_cast<std::streamsize>(out.size()));
+    return static_cast<bool>(file);
+}
+
+std::optional<Trace> read_trace(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return std::nullopt;
+    std::string buf((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    Reader r{buf};
+    if (!r.has(sizeof(TRACE_MAGIC) + 8) ||
+        !std::equal(std::begin(TRACE_MAGIC), std::end(TRACE_MAGIC), buf.begin())) {
+        return std::nullopt;
+    }
+    r.pos = sizeof(TRACE_MAGIC);
+    if (r.u32() != TRACE_VERSION) return std::nullopt;
+
+    Trace t;
+    uint32_t symbol_count = r.u32();
+    if (symbol_count > 256) return std::nullopt;
+    for (uint32_t i = 0; i < symbol_count; ++i) {
+        if (!r.has(1)) return std::nullopt;
+        uint8_t len = r.u8();
+        if (!r.has(len)) return std::nullopt;
+        t.symbols.push_back(buf.substr(r.pos, len));
+        r.pos += len;
+    }
+
+    if (!r.has(12)) return std::nullopt;
+    t.accounts = r.u32();
+    uint64_t count = r.u64();
+    if ((buf.size() - r.pos) / OP_RECORD_BYTES < count) return std::nullopt;
+
+    t.ops.resize(count);
+    for (auto& op : t.ops) {
+        op.gap_ns = r.u32();
+        uint8_t type = r.u8();
+        uint8_t side = r.u8();
+        uint8_t order_type = r.u8();
+        op.symbol = r.u8();
+        op.account = r.u32();
+        op.price = static_cast<int64_t>(r.u64());
+        op.quantity = static_cast<int64_t>(r.u64());
+        op.ref = r.u64();
+        if (type > 2 || side > 1 || order_type > 1 || op.symbol >= t.symbols.size()) {
+            return std::nullopt;
+        }
+        op.type = static_cast<TraceOpType>(type);
+        op.side = static_cast<Side>(side);
+        op.order_type = static_cast<OrderType>(order_type);
+    }
+    return t;
+}
+
+Order trace_order(const Trace& trace, const TraceOp& op) {
+    Order o;
+    o.account_id = "acct" + std::to_string(op.account);
+    o.symbol = trace.symbols[op.symbol];
+    o.side = op.side;
+    o.type = op.order_type;
+    o.price = op.price;
+    o.quantity = op.quantity;
+    return o;
+}
+
+TraceRunner::TraceRunner(MatchingEngine& engine, const Trace& trace)
+    : engine_(engine), trace_(trace), order_ids_(trace.ops.size(), 0) {}
+
+bool TraceRunner::step() {
+    if (pos_ >= trace_.ops.size()) return false;
+    const auto& op = trace_.ops[pos_];
+
+    switch (op.type) {
+        case TraceOpType::PLACE:
+            place(op);
+            break;
+        case TraceOpType::CANCEL:
+            if (cancel(op.ref)) stats_.cancelled++;
+            break;
+        case TraceOpType::REPLACE:
+            // Replacing an order that is already gone is rejected as a whole
+            if (cancel(op.ref)) {
+                stats_.replaced++;
+                place(op);
+            }
+            break;
+    }
+
+    pos_++;
+    return true;
+}
+
+void TraceRunner::run() {
+    while (step()) {
+    }
+}
+
+void TraceRunner::place(const TraceOp& op) {
+    auto result = engine_.place_order(trace_order(trace_, op));
+    if (!result.success) {
+        stats_.rejected++;
+        return;
+    }
+    stats_.placed++;
+    stats_.trades += result.trades.size();
+    order_ids_[pos_] = result.order.id;
+}
+
+bool TraceRunner::cancel(uint64_t ref) {
+    uint64_t id = ref < order_ids_.size() ? order_ids_[ref] : 0;
+    if (id == 0 || !engine_.cancel_order(id).success) {
+        stats_.cancel_misses++;
+        return false;
+    }
+    order_ids_[ref] = 0;
+    return true;
+}
+
+}  // namespace exchange
@@ -183,4 +183,58 @@ TEST_CASE("Fuzz - Trade ID uniqueness", "[fuzz]") {
 
     // Should have generated 100 trades
     REQUIRE(seen_trade_ids.size() == 100);
-}
\ No newline at end of file
+}
+// Property: time in force is honoured and the book stays uncrossed, whatever
+// self-trade prevention does along the way
+TEST_CASE("Fuzz - Time in force invariants", "[fuzz]") {
+    std::mt19937 rng(789);
+    std::uniform_int_distribution<int64_t> price_dist(95, 105);
+    std::uniform_int_distribution<int64_t> qty_dist(1, 50);
+    std::uniform_int_distribution<int> side_dist(0, 1);
+    std::uniform_int_distribution<int> tif_dist(0, 4);
+    std::uniform_int_distribution<int> stp_dist(0, 4);
+
+    MatchingEngine engine;
+
+    for (int i = 0; i < 2000; ++i) {
+        Order order;
+        order.account_id = "trader" + std::to_string(i % 50);
+        order.symbol = "BTC-USD";
+        order.side = side_dist(rng) == 0 ? Side::BUY : Side::SELL;
+        order.type = OrderType::LIMIT;
+        order.time_in_force = static_cast<TimeInForce>(tif_dist(rng));
+        order.self_trade_prevention = static_cast<SelfTradePrevention>(stp_dist(rng));
+        order.price = price_dist(rng) * PRICE_SCALE;
+        order.quantity = qty_dist(rng);
+
+        auto result = engine.place_order(order);
+        const Order& o = result.order;
+        auto* book = engine.get_book("BTC-USD");
+        bool rests = book->get_order(o.id) != nullptr;
+
+        int64_t traded = 0;
+        for (const auto& trade : result.trades) traded += trade.quantity;
+        REQUIRE(traded == o.filled_qty());
+
+        switch (order.time_in_force) {
+            case TimeInForce::IOC:
+                REQUIRE_FALSE(rests);
+                break;
+            case TimeInForce::FOK:
+                // All or nothing
+                REQUIRE_FALSE(rests);
+                REQUIRE((traded == 0 || traded == o.quantity));
+                if (!result.success) REQUIRE(result.error_code == ErrorCode::FOK_NOT_FILLABLE);
+                break;
+            case TimeInForce::POST_ONLY:
+            case TimeInForce::POST_ONLY_SLIDE:
+                REQUIRE(traded == 0);
+                REQUIRE(rests == result.success);
+                break;
+            case TimeInForce::GTC:
+                break;
+        }
+
+        REQUIRE_FALSE(book->is_crossed());
+    }
+}
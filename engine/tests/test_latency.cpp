@@ -0,0 +1,156 @@
+#include <catch2/catch_all.hpp>
+
+#include <chrono>
+
+#include "exchange/clock.hpp"
+#include "exchange/latency_histogram.hpp"
+#include "exchange/protocol.hpp"
+
+using namespace exchange;
+
+TEST_CASE("LatencyHistogram - Small values are exact", "[latency]") {
+    LatencyHistogram h;
+    for (uint64_t v = 1; v <= 20; ++v) h.record(v);
+
+    REQUIRE(h.count() == 20);
+    REQUIRE(h.min() == 1);
+    REQUIRE(h.max() == 20);
+    REQUIRE(h.percentile(0.5) == 10);
+    REQUIRE(h.percentile(1.0) == 20);
+    REQUIRE(h.mean() == 10.5);
+}
+
+TEST_CASE("LatencyHistogram - Percentiles within bucket error", "[latency]") {
+    LatencyHistogram h;
+    for (uint64_t v = 1; v <= 100000; ++v) h.record(v * 100);
+
+    auto within = [](uint64_t got, uint64_t want) {
+        double err = (static_cast<double>(got) - static_cast<double>(want)) /
+                     static_cast<double>(want);
+        return err >= 0.0 && err <= 1.0 / LatencyHistogram::SUB_COUNT;
+    };
+    REQUIRE(within(h.percentile(0.50), 5000000));
+    REQUIRE(within(h.percentile(0.99), 9900000));
+    REQUIRE(within(h.percentile(0.999), 9990000));
+    REQUIRE(h.percentile(1.0) == 10000000);
+}
+
+TEST_CASE("LatencyHistogram - Bucket bounds cover every value", "[latency]") {
+    for (uint64_t v : {uint64_t{0}, uint64_t{31}, uint64_t{32}, uint64_t{33}, uint64_t{1000},
+                       uint64_t{123456789}, ~uint64_t{0}}) {
+        size_t i = LatencyHistogram::bucket_index(v);
+        REQUIRE(i < LatencyHistogram::BUCKETS);
+        REQUIRE(LatencyHistogram::bucket_upper(i) >= v);
+        if (i > 0) REQUIRE(LatencyHistogram::bucket_upper(i - 1) < v);
+    }
+}
+
+TEST_CASE("LatencyHistogram - Merge and reset", "[latency]") {
+    LatencyHistogram a, b;
+    a.record(10);
+    b.record(1000);
+    a.merge(b);
+    REQUIRE(a.count() == 2);
+    REQUIRE(a.min() == 10);
+    REQUIRE(a.max() == 1000);
+
+    a.reset();
+    REQUIRE(a.count() == 0);
+    REQUIRE(a.percentile(0.99) == 0);
+    REQUIRE(a.min() == 0);
+}
+
+TEST_CASE("Latency - get_latency reports per-stage histograms", "[latency]") {
+    MatchingEngine engine;
+    ProtocolHandler handler(engine);
+
+    for (int i = 0; i < 10; ++i) {
+        std::string side = i % 2 ? "BUY" : "SELL";
+        std::string account = i % 2 ? "buyer" : "seller";
+        (void)handler.handle(R"({"cmd":"place_order","order":{"account_id":")" + account +
+                             R"(","symbol":"BTC-USD","side":")" + side +
+                             R"(","type":"LIMIT","price":10000000000000,"quantity":1}})");
+    }
+
+    auto resp = nlohmann::json::parse(handler.handle(R"({"cmd":"get_latency","reset":true})"));
+    REQUIRE(resp["success"] == true);
+    const auto& data = resp["data"];
+    const auto& stages = data["stages"];
+    for (const char* name : LATENCY_STAGE_NAMES) REQUIRE(stages.contains(name));
+
+#ifdef EXCHANGE_LATENCY_STATS
+    REQUIRE(data["enabled"] == true);
+    REQUIRE(data["ns_per_tick"].get<double>() > 0.0);
+    REQUIRE(stages["place_order"]["count"] == 10);
+    REQUIRE(stages["risk_check"]["count"] == 10);
+    REQUIRE(stages["match"]["count"] == 10);
+    REQUIRE(stages["decode"]["count"] == 10);
+    REQUIRE(stages["event_log"]["count"] == 10);
+    REQUIRE(stages["parse"]["count"] == 11);
+    REQUIRE(stages["serialize"]["count"] == 10);  // get_latency's own not done yet
+    REQUIRE(stages["handle"]["count"] == 10);
+    REQUIRE(stages["handle"]["p50"].get<uint64_t>() >= stages["parse"]["p50"].get<uint64_t>());
+
+    // reset cleared everything recorded before it
+    auto after = nlohmann::json::parse(handler.handle(R"({"cmd":"get_latency"})"));
+    REQUIRE(after["data"]["stages"]["place_order"]["count"] == 0);
+    REQUIRE(after["data"]["stages"]["handle"]["count"] == 1);
+#else
+    REQUIRE(data["enabled"] == false);
+    REQUIRE(stages["handle"]["count"] == 0);
+#endif
+}
+
+TEST_CASE("TscClock - Tracks the system clock and never goes backwards", "[latency]") {
+    auto& clock = TscClock::instance();
+    auto system_ns = [] {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::system_clock::now().time_since_epoch())
+                                         .count());
+    };
+
+    uint64_t prev = clock.now_ns();
+    for (int i = 0; i < 100000; ++i) {
+        uint64_t t = clock.now_ns();
+        REQUIRE(t >= prev);
+        prev = t;
+    }
+
+    auto within_ms = [](uint64_t a, uint64_t b) { return (a > b ? a - b : b - a) < 1000000; };
+    REQUIRE(within_ms(clock.now_ns(), system_ns()));
+
+    uint64_t before = clock.now_ns();
+    clock.resync();
+    REQUIRE(clock.now_ns() >= before);
+    REQUIRE(within_ms(clock.now_ns(), system_ns()));
+}
+
+TEST_CASE("Latency - Halted symbols are refused and counted as rejects", "[latency]") {
+    MatchingEngine engine;
+    ProtocolHandler handler(engine);
+    const std::string order = R"({"cmd":"place_order","order":{"account_id":"a",)"
+                              R"("symbol":"BTC-USD","side":"BUY","type":"LIMIT",)"
+                              R"("price":10000000000000,"quantity":1}})";
+
+    auto resp = nlohmann::json::parse(handler.handle(
+        R"({"cmd":"set_symbol_state","symbol":"BTC-USD","state":"HALTED"})"));
+    REQUIRE(resp["success"] == true);
+    REQUIRE(resp["data"]["state"] == "HALTED");
+
+    resp = nlohmann::json::parse(handler.handle(order));
+    REQUIRE(resp["success"] == false);
+    REQUIRE(resp["error"]["code"] == "SYMBOL_HALTED");
+    REQUIRE(engine.get_stats().total_rejects == 1);
+
+    resp = nlohmann::json::parse(handler.handle(
+        R"({"cmd":"set_symbol_state","symbol":"BTC-USD","state":"PRE_OPEN"})"));
+    REQUIRE(resp["success"] == true);
+    resp = nlohmann::json::parse(handler.handle(
+        R"({"cmd":"get_symbol_state","symbol":"BTC-USD"})"));
+    REQUIRE(resp["data"]["state"] == "PRE_OPEN");
+    REQUIRE(nlohmann::json::parse(handler.handle(order))["success"] == true);
+
+#ifdef EXCHANGE_LATENCY_STATS
+    REQUIRE(engine.latency().histogram(LatencyStage::DECODE).count() == 2);
+#endif
+}
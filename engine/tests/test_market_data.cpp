@@ -0,0 +1,103 @@
+#include <catch2/catch_all.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#include "exchange/matching_engine.hpp"
+#include "exchange/spsc_ring.hpp"
+
+using namespace exchange;
+
+TEST_CASE("SpscRing - FIFO order and capacity", "[market_data]") {
+    SpscRing<int, 4> ring;
+    int out = 0;
+
+    REQUIRE_FALSE(ring.try_pop(out));
+    for (int i = 0; i < 4; ++i) REQUIRE(ring.try_push(i));
+    REQUIRE_FALSE(ring.try_push(99));  // full
+
+    for (int i = 0; i < 4; ++i) {
+        REQUIRE(ring.try_pop(out));
+        REQUIRE(out == i);
+    }
+    REQUIRE(ring.empty());
+}
+
+TEST_CASE("SpscRing - Cross-thread delivery", "[market_data]") {
+    static SpscRing<uint64_t, 1024> ring;
+    constexpr uint64_t count = 100000;
+
+    std::thread producer([] {
+        for (uint64_t i = 1; i <= count; ++i) {
+            while (!ring.try_push(i)) std::this_thread::yield();
+        }
+    });
+
+    uint64_t expected = 1;
+    uint64_t v = 0;
+    while (expected <= count) {
+        if (ring.try_pop(v)) {
+            REQUIRE(v == expected);
+            ++expected;
+        }
+    }
+    producer.join();
+}
+
+TEST_CASE("MarketDataFeed - L3 messages for add, execute and delete", "[market_data]") {
+    auto path = std::filesystem::temp_directory_path() /
+                ("aztec_l3_" + std::to_string(now_ns()) + ".jsonl");
+
+    {
+        MarketDataFeed feed(path.string());
+        REQUIRE(feed.start());
+
+        MatchingEngine engine;
+        engine.set_market_data_feed(&feed);
+
+        Order sell;
+        sell.account_id = "seller";
+        sell.symbol = "BTC-USD";
+        sell.side = Side::SELL;
+        sell.type = OrderType::LIMIT;
+        sell.price = 100 * PRICE_SCALE;
+        sell.quantity = 50;
+        engine.place_order(sell);
+
+        Order buy;
+        buy.account_id = "buyer";
+        buy.symbol = "BTC-USD";
+        buy.side = Side::BUY;
+        buy.type = OrderType::LIMIT;
+        buy.price = 100 * PRICE_SCALE;
+        buy.quantity = 20;
+        engine.place_order(buy);
+
+        engine.cancel_order(1);
+        REQUIRE(engine.market_data_sequence() == 3);
+        feed.stop();
+    }
+
+    std::vector<nlohmann::json> msgs;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) msgs.push_back(nlohmann::json::parse(line));
+    std::filesystem::remove(path);
+
+    // The aggressive buy fills completely and never rests, so it has no ADD
+    REQUIRE(msgs.size() == 3);
+    REQUIRE(msgs[0]["type"] == "ADD");
+    REQUIRE(msgs[0]["order_id"] == 1);
+    REQUIRE(msgs[0]["quantity"] == 50);
+    REQUIRE(msgs[1]["type"] == "EXECUTE");
+    REQUIRE(msgs[1]["order_id"] == 1);
+    REQUIRE(msgs[1]["quantity"] == 20);
+    REQUIRE(msgs[1]["trade_id"] == 1);
+    REQUIRE(msgs[2]["type"] == "DELETE");
+    REQUIRE(msgs[2]["order_id"] == 1);
+    for (size_t i = 0; i < msgs.size(); ++i) {
+        REQUIRE(msgs[i]["seq"] == i + 1);
+        REQUIRE(msgs[i]["symbol"] == "BTC-USD");
+    }
+}
@@ -1,5 +1,8 @@
 #include <catch2/catch_all.hpp>
 
+#include <filesystem>
+#include <thread>
+
 #include "exchange/matching_engine.hpp"
 
 using namespace exchange;
@@ -215,14 +218,44 @@ TEST_CASE("Matching - Idempotency key duplicate", "[matching]") {
     order1.quantity = 100;
     order1.idempotency_key = "unique-key-123";
 
+    Order ask = order1;
+    ask.account_id = "seller";
+    ask.side = Side::SELL;
+    ask.quantity = 30;
+    ask.idempotency_key.clear();
+    REQUIRE(engine.place_order(ask).success);
+
     auto result1 = engine.place_order(order1);
     REQUIRE(result1.success);
+    REQUIRE(result1.trades.size() == 1);
+
+    // Fills after the placement do not change what a retry is told
+    ask.quantity = 70;
+    REQUIRE(engine.place_order(ask).trades.size() == 1);
 
-    // Same idempotency key should be rejected
+    // Same idempotency key gets the original result back and places nothing
     Order order2 = order1;
     auto result2 = engine.place_order(order2);
-    REQUIRE_FALSE(result2.success);
-    REQUIRE(result2.error_code == ErrorCode::DUPLICATE_IDEMPOTENCY_KEY);
+    REQUIRE(result2.success);
+    REQUIRE(result2.duplicate);
+    REQUIRE(result2.order.id == result1.order.id);
+    REQUIRE(result2.order.status == OrderStatus::PARTIAL);
+    REQUIRE(result2.order.remaining_qty == 70);
+    REQUIRE(result2.trades.size() == 1);
+    REQUIRE(result2.trades[0].id == result1.trades[0].id);
+    REQUIRE(engine.get_order(result1.order.id)->status == OrderStatus::FILLED);
+    REQUIRE(engine.get_stats().total_orders == 3);
+
+    // A placement that failed is answered with the same failure
+    Order market = order1;
+    market.type = OrderType::MARKET;
+    market.idempotency_key = "market-key";
+    REQUIRE(engine.place_order(market).error_code == ErrorCode::NO_LIQUIDITY);
+    auto retry = engine.place_order(market);
+    REQUIRE(retry.duplicate);
+    REQUIRE_FALSE(retry.success);
+    REQUIRE(retry.error_code == ErrorCode::NO_LIQUIDITY);
+    REQUIRE(retry.order.status == OrderStatus::REJECTED);
 }
 
 TEST_CASE("Matching - Price-time priority", "[matching]") {
@@ -260,4 +293,883 @@ TEST_CASE("Matching - Price-time priority", "[matching]") {
     auto result = engine.place_order(buy);
     REQUIRE(result.trades.size() == 1);
     REQUIRE(result.trades[0].sell_order_id == 1);  // First sell order
-}
\ No newline at end of file
+}
+TEST_CASE("Matching - BBO listener fires only on top-of-book change", "[matching]") {
+    MatchingEngine engine;
+
+    std::vector<Bbo> updates;
+    std::vector<uint64_t> stamps;
+    int flushes = 0;
+    engine.set_bbo_listener(
+        [&](const std::string& symbol, const Bbo& bbo, uint64_t timestamp_ns) {
+            REQUIRE(symbol == "BTC-USD");
+            updates.push_back(bbo);
+            stamps.push_back(timestamp_ns);
+        },
+        [&] { ++flushes; });
+
+    Order sell;
+    sell.account_id = "seller";
+    sell.symbol = "BTC-USD";
+    sell.side = Side::SELL;
+    sell.type = OrderType::LIMIT;
+    sell.price = 100 * PRICE_SCALE;
+    sell.quantity = 50;
+    auto placed = engine.place_order(sell);
+    REQUIRE(updates.size() == 1);
+    REQUIRE(updates.back().ask.quantity == 50);
+    REQUIRE(stamps.back() == placed.order.timestamp_ns);
+    REQUIRE(flushes == 1);
+
+    // A deeper ask leaves the top unchanged
+    Order deeper = sell;
+    deeper.price = 105 * PRICE_SCALE;
+    engine.place_order(deeper);
+    REQUIRE(updates.size() == 1);
+
+    Order buy;
+    buy.account_id = "buyer";
+    buy.symbol = "BTC-USD";
+    buy.side = Side::BUY;
+    buy.type = OrderType::LIMIT;
+    buy.price = 100 * PRICE_SCALE;
+    buy.quantity = 20;
+    engine.place_order(buy);
+    REQUIRE(updates.size() == 2);
+    REQUIRE(updates.back().ask.quantity == 30);
+    REQUIRE_FALSE(updates.back().has_bid());
+
+    engine.cancel_order(1);
+    REQUIRE(updates.size() == 3);
+    REQUIRE(updates.back().ask.price == 105 * PRICE_SCALE);
+    REQUIRE(flushes == 3);
+}
+
+TEST_CASE("Matching - One timestamp per command", "[matching]") {
+    auto dir = std::filesystem::temp_directory_path() / "aztec_test_command_ts";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    MatchingEngine engine((dir / "events.jsonl").string());
+
+    for (int i = 0; i < 3; ++i) {
+        Order sell;
+        sell.account_id = "seller";
+        sell.symbol = "BTC-USD";
+        sell.side = Side::SELL;
+        sell.price = (10000 + i) * PRICE_SCALE;
+        sell.quantity = 10;
+        REQUIRE(engine.place_order(sell).success);
+    }
+
+    Order buy;
+    buy.account_id = "buyer";
+    buy.symbol = "BTC-USD";
+    buy.side = Side::BUY;
+    buy.type = OrderType::MARKET;
+    buy.quantity = 30;
+    auto r = engine.place_order(buy);
+    REQUIRE(r.trades.size() == 3);
+    for (const auto& t : r.trades) REQUIRE(t.timestamp_ns == r.order.timestamp_ns);
+
+    // ORDER_PLACED plus three TRADE_EXECUTED, all stamped with the command time
+    auto events = engine.event_log().read_all();
+    REQUIRE(events.size() == 7);
+    for (size_t i = 3; i < events.size(); ++i) {
+        REQUIRE(events[i].timestamp_ns == r.order.timestamp_ns);
+    }
+    REQUIRE(events[2].timestamp_ns <= r.order.timestamp_ns);
+    std::filesystem::remove_all(dir);
+}
+
+namespace {
+
+Order resting(const std::string& account, const std::string& symbol, Side side, int64_t price) {
+    Order o;
+    o.account_id = account;
+    o.symbol = symbol;
+    o.side = side;
+    o.type = OrderType::LIMIT;
+    o.price = price * PRICE_SCALE;
+    o.quantity = 10;
+    return o;
+}
+
+}  // namespace
+
+TEST_CASE("Matching - Mass cancel by account and symbol", "[matching]") {
+    MatchingEngine engine;
+    std::vector<uint64_t> ids;
+    for (const char* acct : {"alice", "bob"}) {
+        for (const char* sym : {"BTC-USD", "ETH-USD"}) {
+            ids.push_back(engine.place_order(resting(acct, sym, Side::BUY, 100)).order.id);
+            ids.push_back(engine.place_order(resting(acct, sym, Side::SELL, 200)).order.id);
+        }
+    }
+
+    auto r = engine.mass_cancel({"alice", "ETH-USD", false});
+    REQUIRE(r.order_ids == std::vector<uint64_t>{ids[2], ids[3]});
+    REQUIRE(engine.get_order(ids[2])->status == OrderStatus::CANCELLED);
+    REQUIRE(engine.get_order(ids[0])->status == OrderStatus::NEW);
+
+    r = engine.mass_cancel({"", "BTC-USD", false});
+    REQUIRE(r.order_ids == std::vector<uint64_t>{ids[0], ids[1], ids[4], ids[5]});
+    REQUIRE_FALSE(engine.get_book("BTC-USD")->best_bid_price());
+
+    r = engine.mass_cancel({});
+    REQUIRE(r.order_ids == std::vector<uint64_t>{ids[6], ids[7]});
+    REQUIRE(engine.get_stats().total_cancels == 8);
+    REQUIRE(engine.mass_cancel({}).order_ids.empty());
+}
+
+TEST_CASE("Matching - Mass cancel skips filled orders and blocks the account", "[matching]") {
+    MatchingEngine engine;
+    auto first = engine.place_order(resting("alice", "BTC-USD", Side::SELL, 100));
+    auto second = engine.place_order(resting("alice", "BTC-USD", Side::SELL, 101));
+    REQUIRE(engine.place_order(resting("bob", "BTC-USD", Side::BUY, 100)).trades.size() == 1);
+
+    auto r = engine.mass_cancel({"alice", "", true});
+    REQUIRE(r.order_ids == std::vector<uint64_t>{second.order.id});
+    REQUIRE(engine.get_order(first.order.id)->status == OrderStatus::FILLED);
+    REQUIRE(engine.is_blocked("alice"));
+
+    auto rejected = engine.place_order(resting("alice", "BTC-USD", Side::SELL, 100));
+    REQUIRE(rejected.error_code == ErrorCode::ACCOUNT_BLOCKED);
+    REQUIRE(engine.place_order(resting("bob", "BTC-USD", Side::SELL, 100)).success);
+
+    REQUIRE(engine.unblock_account("alice"));
+    REQUIRE_FALSE(engine.unblock_account("alice"));
+    REQUIRE(engine.place_order(resting("alice", "BTC-USD", Side::SELL, 102)).success);
+}
+
+TEST_CASE("Matching - Modify keeps priority only when shrinking in place", "[matching]") {
+    MatchingEngine engine;
+    auto first = engine.place_order(resting("alice", "BTC-USD", Side::SELL, 100)).order.id;
+    auto second = engine.place_order(resting("bob", "BTC-USD", Side::SELL, 100)).order.id;
+
+    // Smaller at the same price: still first in the queue
+    auto r = engine.modify_order(first, 100 * PRICE_SCALE, 6);
+    REQUIRE(r.success);
+    REQUIRE(r.order.remaining_qty == 6);
+    REQUIRE(engine.get_book("BTC-USD")->get_ask_levels(1)[0].quantity == 16);
+    auto fill = engine.place_order(resting("carol", "BTC-USD", Side::BUY, 100));
+    REQUIRE(fill.trades.size() == 2);
+    REQUIRE(fill.trades[0].sell_order_id == first);
+    REQUIRE(fill.trades[0].quantity == 6);
+
+    // Total size counts fills: bob has 6 left of 10, so 12 means 8 remaining,
+    // and the increase sends it to the back behind dave
+    auto third = engine.place_order(resting("dave", "BTC-USD", Side::SELL, 100)).order.id;
+    r = engine.modify_order(second, 100 * PRICE_SCALE, 12);
+    REQUIRE(r.success);
+    REQUIRE(r.order.id == second);
+    REQUIRE(r.order.remaining_qty == 8);
+    REQUIRE(r.order.status == OrderStatus::PARTIAL);
+    fill = engine.place_order(resting("carol", "BTC-USD", Side::BUY, 100));
+    REQUIRE(fill.trades[0].sell_order_id == third);
+
+    REQUIRE(engine.modify_order(second, 100 * PRICE_SCALE, 4).error_code ==
+            ErrorCode::INVALID_QUANTITY);
+    REQUIRE(engine.modify_order(third, 100 * PRICE_SCALE, 5).error_code ==
+            ErrorCode::ORDER_NOT_FOUND);
+}
+
+TEST_CASE("Matching - Modify checks the new quantity on both paths", "[matching]") {
+    SymbolRiskConfig cfg;
+    cfg.symbol = "BTC-USD";
+    cfg.lot_size = 5;
+    cfg.min_qty = 5;
+    RiskLimits limits;
+    limits.symbols = {cfg};
+    MatchingEngine engine;
+    engine.set_risk_limits(limits);
+    auto id = engine.place_order(resting("alice", "BTC-USD", Side::SELL, 100)).order.id;
+
+    // In place (same price, smaller) and re-queued (new price) alike
+    for (int64_t price : {100, 101}) {
+        auto r = engine.modify_order(id, price * PRICE_SCALE, 7);
+        REQUIRE(r.error_code == ErrorCode::INVALID_LOT_SIZE);
+        REQUIRE(r.order.remaining_qty == 10);
+    }
+    REQUIRE(engine.modify_order(id, 100 * PRICE_SCALE, 3).error_code ==
+            ErrorCode::INVALID_QUANTITY);
+    REQUIRE(engine.get_book("BTC-USD")->get_ask_levels(1)[0].quantity == 10);
+    REQUIRE(engine.get_stats().total_rejects == 3);
+    REQUIRE(engine.modify_order(id, 100 * PRICE_SCALE, 5).success);
+}
+
+TEST_CASE("Matching - Modify to a crossing price trades", "[matching]") {
+    MatchingEngine engine;
+    auto bid = engine.place_order(resting("alice", "BTC-USD", Side::BUY, 99)).order.id;
+    auto ask = engine.place_order(resting("bob", "BTC-USD", Side::SELL, 101)).order.id;
+
+    auto r = engine.modify_order(ask, 99 * PRICE_SCALE, 15);
+    REQUIRE(r.success);
+    REQUIRE(r.trades.size() == 1);
+    REQUIRE(r.trades[0].buy_order_id == bid);
+    REQUIRE(r.trades[0].sell_order_id == ask);
+    REQUIRE(r.order.remaining_qty == 5);
+    REQUIRE(engine.get_book("BTC-USD")->best_ask_price() == 99 * PRICE_SCALE);
+    REQUIRE_FALSE(engine.get_book("BTC-USD")->best_bid_price());
+}
+
+TEST_CASE("Matching - A refused modify leaves the original resting", "[matching]") {
+    MatchingEngine engine;
+    engine.place_order(resting("alice", "BTC-USD", Side::SELL, 101));
+    auto* book = engine.get_book("BTC-USD");
+
+    SECTION("Post-only moved to a crossing price") {
+        Order post = resting("bob", "BTC-USD", Side::BUY, 99);
+        post.time_in_force = TimeInForce::POST_ONLY;
+        auto id = engine.place_order(post).order.id;
+        auto behind = engine.place_order(resting("carol", "BTC-USD", Side::BUY, 99)).order.id;
+
+        auto r = engine.modify_order(id, 101 * PRICE_SCALE, 10);
+        REQUIRE(r.error_code == ErrorCode::POST_ONLY_WOULD_CROSS);
+        REQUIRE(r.order.price == 99 * PRICE_SCALE);
+        REQUIRE(engine.get_order(id)->status == OrderStatus::NEW);
+        REQUIRE(book->get_bid_levels(1)[0].quantity == 20);
+
+        // Still ahead of carol
+        auto fill = engine.place_order(resting("dave", "BTC-USD", Side::SELL, 99));
+        REQUIRE(fill.trades[0].buy_order_id == id);
+        REQUIRE(engine.get_order(behind)->status == OrderStatus::NEW);
+    }
+
+    SECTION("Self-trade prevention against the account's own order") {
+        auto id = engine.place_order(resting("alice", "BTC-USD", Side::BUY, 99)).order.id;
+        auto behind = engine.place_order(resting("carol", "BTC-USD", Side::BUY, 99)).order.id;
+
+        auto mode = GENERATE(SelfTradePrevention::CANCEL_INCOMING,
+                             SelfTradePrevention::CANCEL_BOTH, SelfTradePrevention::SKIP);
+        Order probe = resting("alice", "BTC-USD", Side::BUY, 90);
+        probe.self_trade_prevention = mode;
+        auto probe_id = engine.place_order(probe).order.id;
+
+        auto r = engine.modify_order(probe_id, 101 * PRICE_SCALE, 10);
+        REQUIRE(r.error_code == ErrorCode::SELF_TRADE_PREVENTED);
+        REQUIRE(r.trades.empty());
+        REQUIRE(engine.get_order(probe_id)->status == OrderStatus::NEW);
+        REQUIRE(engine.get_order(probe_id)->price == 90 * PRICE_SCALE);
+        REQUIRE(book->best_ask_price() == 101 * PRICE_SCALE);
+        REQUIRE(book->best_bid_price() == 99 * PRICE_SCALE);
+
+        auto fill = engine.place_order(resting("dave", "BTC-USD", Side::SELL, 99));
+        REQUIRE(fill.trades[0].buy_order_id == id);
+        REQUIRE(engine.get_order(behind)->status == OrderStatus::NEW);
+    }
+}
+
+TEST_CASE("Matching - IOC trades what it can and never rests", "[matching][tif]") {
+    MatchingEngine engine;
+    engine.place_order(resting("alice", "BTC-USD", Side::SELL, 100));
+
+    Order ioc = resting("bob", "BTC-USD", Side::BUY, 100);
+    ioc.quantity = 25;
+    ioc.time_in_force = TimeInForce::IOC;
+    auto r = engine.place_order(ioc);
+    REQUIRE(r.success);
+    REQUIRE(r.trades.size() == 1);
+    REQUIRE(r.order.filled_qty() == 10);
+    REQUIRE(r.order.status == OrderStatus::CANCELLED);
+    REQUIRE_FALSE(engine.get_book("BTC-USD")->best_bid_price());
+
+    // Nothing to take: cancelled untouched rather than rejected
+    r = engine.place_order(ioc);
+    REQUIRE(r.success);
+    REQUIRE(r.trades.empty());
+    REQUIRE(r.order.status == OrderStatus::CANCELLED);
+    REQUIRE_FALSE(engine.get_book("BTC-USD")->best_bid_price());
+}
+
+TEST_CASE("Matching - FOK fills completely or leaves the book alone", "[matching][tif]") {
+    MatchingEngine engine;
+    engine.place_order(resting("alice", "BTC-USD", Side::SELL, 100));
+    engine.place_order(resting("bob", "BTC-USD", Side::SELL, 101));
+    engine.place_order(resting("carol", "BTC-USD", Side::SELL, 102));
+
+    // 20 available up to 101, so 25 is refused without a single fill
+    Order fok = resting("dave", "BTC-USD", Side::BUY, 101);
+    fok.quantity = 25;
+    fok.time_in_force = TimeInForce::FOK;
+    auto r = engine.place_order(fok);
+    REQUIRE_FALSE(r.success);
+    REQUIRE(r.error_code == ErrorCode::FOK_NOT_FILLABLE);
+    REQUIRE(r.order.status == OrderStatus::REJECTED);
+    REQUIRE(engine.get_book("BTC-USD")->get_ask_levels(10).size() == 3);
+
+    fok.quantity = 20;
+    r = engine.place_order(fok);
+    REQUIRE(r.success);
+    REQUIRE(r.trades.size() == 2);
+    REQUIRE(r.order.status == OrderStatus::FILLED);
+
+    // Own liquidity does not count: self-trade prevention would stop on it
+    engine.place_order(resting("dave", "BTC-USD", Side::SELL, 102));
+    fok.price = 102 * PRICE_SCALE;
+    REQUIRE(engine.place_order(fok).error_code == ErrorCode::FOK_NOT_FILLABLE);
+
+    Order market = fok;
+    market.type = OrderType::MARKET;
+    market.account_id = "erin";
+    REQUIRE(engine.place_order(market).success);
+}
+
+TEST_CASE("Matching - Post-only rejects or slides instead of crossing", "[matching][tif]") {
+    MatchingEngine engine;
+    engine.place_order(resting("alice", "BTC-USD", Side::SELL, 100));
+
+    Order post = resting("bob", "BTC-USD", Side::BUY, 100);
+    post.time_in_force = TimeInForce::POST_ONLY;
+    auto r = engine.place_order(post);
+    REQUIRE(r.error_code == ErrorCode::POST_ONLY_WOULD_CROSS);
+    REQUIRE(r.trades.empty());
+    REQUIRE_FALSE(engine.get_book("BTC-USD")->best_bid_price());
+
+    post.price = 99 * PRICE_SCALE;
+    r = engine.place_order(post);
+    REQUIRE(r.success);
+    REQUIRE(r.order.status == OrderStatus::NEW);
+
+    // Slid one tick (1 unit by default) behind the best ask
+    post.price = 105 * PRICE_SCALE;
+    post.time_in_force = TimeInForce::POST_ONLY_SLIDE;
+    r = engine.place_order(post);
+    REQUIRE(r.success);
+    REQUIRE(r.trades.empty());
+    REQUIRE(r.order.price == 100 * PRICE_SCALE - 1);
+    REQUIRE(engine.get_book("BTC-USD")->best_bid_price() == 100 * PRICE_SCALE - 1);
+
+    post.type = OrderType::MARKET;
+    REQUIRE(engine.place_order(post).error_code == ErrorCode::INVALID_ORDER_TYPE);
+}
+
+TEST_CASE("Matching - Self-trade prevention modes", "[matching][stp]") {
+    MatchingEngine engine;
+    // alice's own ask sits at the front with bob's liquidity behind it
+    auto own = engine.place_order(resting("alice", "BTC-USD", Side::SELL, 100)).order.id;
+    auto other = engine.place_order(resting("bob", "BTC-USD", Side::SELL, 100)).order.id;
+    auto* book = engine.get_book("BTC-USD");
+    Order buy = resting("alice", "BTC-USD", Side::BUY, 100);
+
+    SECTION("CANCEL_INCOMING rejects an order that has not traded") {
+        auto r = engine.place_order(buy);
+        REQUIRE(r.error_code == ErrorCode::SELF_TRADE_PREVENTED);
+        REQUIRE(book->get_ask_levels(1)[0].quantity == 20);
+    }
+
+    SECTION("CANCEL_RESTING clears the way to other accounts") {
+        buy.self_trade_prevention = SelfTradePrevention::CANCEL_RESTING;
+        auto r = engine.place_order(buy);
+        REQUIRE(r.success);
+        REQUIRE(r.trades.size() == 1);
+        REQUIRE(r.trades[0].sell_order_id == other);
+        REQUIRE(r.order.status == OrderStatus::FILLED);
+        REQUIRE(engine.get_order(own)->status == OrderStatus::CANCELLED);
+        REQUIRE_FALSE(book->best_ask_price());
+    }
+
+    SECTION("CANCEL_BOTH") {
+        buy.self_trade_prevention = SelfTradePrevention::CANCEL_BOTH;
+        auto r = engine.place_order(buy);
+        REQUIRE(r.error_code == ErrorCode::SELF_TRADE_PREVENTED);
+        REQUIRE(engine.get_order(own)->status == OrderStatus::CANCELLED);
+        REQUIRE(engine.get_order(other)->status == OrderStatus::NEW);
+    }
+
+    SECTION("DECREMENT_AND_CANCEL shrinks both without a trade") {
+        buy.self_trade_prevention = SelfTradePrevention::DECREMENT_AND_CANCEL;
+        buy.quantity = 14;
+        auto r = engine.place_order(buy);
+        REQUIRE(r.success);
+        REQUIRE(r.trades.size() == 1);
+        REQUIRE(r.trades[0].quantity == 4);
+        REQUIRE(r.order.quantity == 4);
+        REQUIRE(r.order.status == OrderStatus::FILLED);
+        REQUIRE(engine.get_order(own)->status == OrderStatus::CANCELLED);
+        REQUIRE(engine.get_order(own)->filled_qty() == 0);
+        REQUIRE(book->get_ask_levels(1)[0].quantity == 6);
+
+        // Smaller incoming: the resting order keeps the difference
+        auto big = engine.place_order(resting("bob", "BTC-USD", Side::BUY, 90)).order.id;
+        Order sell = resting("bob", "BTC-USD", Side::SELL, 90);
+        sell.quantity = 4;
+        sell.self_trade_prevention = SelfTradePrevention::DECREMENT_AND_CANCEL;
+        // Taken down to nothing without a trade: cancelled, not rejected
+        r = engine.place_order(sell);
+        REQUIRE(r.success);
+        REQUIRE(r.trades.empty());
+        REQUIRE(r.order.status == OrderStatus::CANCELLED);
+        REQUIRE(r.order.remaining_qty == 0);
+        REQUIRE(engine.get_order(big)->remaining_qty == 6);
+        REQUIRE(engine.get_order(big)->quantity == 6);
+    }
+
+    SECTION("SKIP trades behind its own order and never crosses it") {
+        buy.self_trade_prevention = SelfTradePrevention::SKIP;
+        buy.quantity = 15;
+        auto r = engine.place_order(buy);
+        REQUIRE(r.success);
+        REQUIRE(r.trades.size() == 1);
+        REQUIRE(r.trades[0].sell_order_id == other);
+        REQUIRE(r.order.status == OrderStatus::CANCELLED);
+        REQUIRE(engine.get_order(own)->status == OrderStatus::NEW);
+        REQUIRE_FALSE(book->is_crossed());
+
+        // Across levels too
+        engine.place_order(resting("carol", "BTC-USD", Side::SELL, 101));
+        buy.price = 101 * PRICE_SCALE;
+        buy.quantity = 10;
+        r = engine.place_order(buy);
+        REQUIRE(r.order.status == OrderStatus::FILLED);
+        REQUIRE(r.trades[0].price == 101 * PRICE_SCALE);
+    }
+
+    auto stats = engine.get_stats();
+    uint64_t fired = 0;
+    for (uint64_t n : stats.self_trade_prevented) fired += n;
+    REQUIRE(fired >= 1);
+    REQUIRE(nlohmann::json(stats).at("self_trade_prevented").size() == 5);
+}
+
+TEST_CASE("Matching - Stop orders trigger and cascade", "[matching][stop]") {
+    MatchingEngine engine;
+    // Bids at 99, 98, 97 and two sell stops that will walk them
+    for (int64_t price : {99, 98, 97}) {
+        engine.place_order(resting("bob", "BTC-USD", Side::BUY, price));
+    }
+    Order stop = resting("alice", "BTC-USD", Side::SELL, 0);
+    stop.type = OrderType::STOP;
+    stop.stop_price = 99 * PRICE_SCALE;
+    auto first = engine.place_order(stop);
+    REQUIRE(first.success);
+    REQUIRE(first.trades.empty());
+    REQUIRE(engine.get_stop_book("BTC-USD")->size() == 1);
+
+    Order stop_limit = resting("carol", "BTC-USD", Side::SELL, 96);
+    stop_limit.type = OrderType::STOP_LIMIT;
+    stop_limit.stop_price = 98 * PRICE_SCALE;
+    stop_limit.quantity = 30;
+    auto second = engine.place_order(stop_limit);
+    REQUIRE(engine.get_stop_book("BTC-USD")->size() == 2);
+
+    // A trade at 99 fires alice's stop, which sells into 98 and fires
+    // carol's stop-limit; it takes 97 and rests the rest at 96
+    auto r = engine.place_order(resting("dave", "BTC-USD", Side::SELL, 99));
+    REQUIRE(r.trades.size() == 1);
+    REQUIRE(engine.get_stop_book("BTC-USD")->empty());
+    REQUIRE(engine.get_order(first.order.id)->status == OrderStatus::FILLED);
+    REQUIRE(engine.get_order(first.order.id)->type == OrderType::MARKET);
+    auto carol = engine.get_order(second.order.id);
+    REQUIRE(carol->type == OrderType::LIMIT);
+    REQUIRE(carol->remaining_qty == 20);
+    REQUIRE(engine.get_book("BTC-USD")->best_ask_price() == 96 * PRICE_SCALE);
+    REQUIRE_FALSE(engine.get_book("BTC-USD")->best_bid_price());
+
+    // Already through the last trade (97): fires on placement
+    stop.stop_price = 97 * PRICE_SCALE;
+    stop.side = Side::BUY;
+    stop.account_id = "erin";
+    r = engine.place_order(stop);
+    REQUIRE(r.trades.size() == 1);
+    REQUIRE(r.order.type == OrderType::MARKET);
+}
+
+TEST_CASE("Matching - Pending stops are cancelled like resting orders", "[matching][stop]") {
+    MatchingEngine engine;
+    Order stop = resting("alice", "BTC-USD", Side::BUY, 0);
+    stop.type = OrderType::STOP;
+    stop.stop_price = 110 * PRICE_SCALE;
+    auto a = engine.place_order(stop).order.id;
+    auto b = engine.place_order(stop).order.id;
+
+    REQUIRE(engine.cancel_order(a).success);
+    REQUIRE(engine.mass_cancel({"alice", "", false}).order_ids == std::vector<uint64_t>{b});
+    REQUIRE(engine.get_stop_book("BTC-USD")->empty());
+
+    stop.stop_price = 0;
+    REQUIRE(engine.place_order(stop).error_code == ErrorCode::INVALID_PRICE);
+}
+
+TEST_CASE("Matching - Iceberg slices trade in turn with the level", "[matching][iceberg]") {
+    MatchingEngine engine;
+    Order treasury = resting("treasury", "BTC-USD", Side::SELL, 100);
+    treasury.quantity = 50;
+    treasury.display_qty = 10;
+    auto iceberg = engine.place_order(treasury);
+    REQUIRE(iceberg.order.visible_qty == 10);
+    auto behind = engine.place_order(resting("bob", "BTC-USD", Side::SELL, 100)).order.id;
+    REQUIRE(engine.get_book("BTC-USD")->get_ask_levels(1)[0].quantity == 20);
+
+    // 10 from the slice, then bob's order is ahead of the refill
+    Order buy = resting("carol", "BTC-USD", Side::BUY, 100);
+    buy.quantity = 25;
+    auto r = engine.place_order(buy);
+    REQUIRE(r.trades.size() == 3);
+    REQUIRE(r.trades[0].sell_order_id == iceberg.order.id);
+    REQUIRE(r.trades[0].quantity == 10);
+    REQUIRE(r.trades[1].sell_order_id == behind);
+    REQUIRE(r.trades[2].sell_order_id == iceberg.order.id);
+    REQUIRE(r.trades[2].quantity == 5);
+
+    auto left = engine.get_order(iceberg.order.id);
+    REQUIRE(left->remaining_qty == 35);
+    REQUIRE(left->visible_qty == 5);
+    REQUIRE(engine.get_book("BTC-USD")->get_ask_levels(1)[0].quantity == 5);
+
+    // A full-size taker sweeps slice after slice
+    buy.quantity = 35;
+    r = engine.place_order(buy);
+    REQUIRE(r.trades.size() == 4);
+    REQUIRE(r.order.status == OrderStatus::FILLED);
+
+    Order hidden_market = treasury;
+    hidden_market.type = OrderType::MARKET;
+    REQUIRE(engine.place_order(hidden_market).error_code == ErrorCode::INVALID_ORDER_TYPE);
+}
+
+TEST_CASE("Matching - Pro-rata allocation over a level", "[matching][allocation]") {
+    MatchingEngine engine;
+    SymbolRiskConfig cfg;
+    cfg.symbol = "BTC-USD";
+
+    auto setup = [&](Allocation allocation, int64_t lot) {
+        cfg.allocation = allocation;
+        cfg.lot_size = lot;
+        RiskLimits limits;
+        limits.symbols = {cfg};
+        engine.set_risk_limits(limits);
+        std::vector<uint64_t> ids;
+        for (auto [account, qty] : {std::pair{"alice", 30}, {"bob", 10}, {"carol", 60}}) {
+            Order o = resting(account, "BTC-USD", Side::SELL, 100);
+            o.quantity = qty;
+            ids.push_back(engine.place_order(o).order.id);
+        }
+        return ids;
+    };
+    auto buy = [&](int64_t qty, SelfTradePrevention stp = SelfTradePrevention::CANCEL_INCOMING) {
+        Order o = resting("dave", "BTC-USD", Side::BUY, 100);
+        o.quantity = qty;
+        o.self_trade_prevention = stp;
+        return engine.place_order(o);
+    };
+    auto fills = [](const PlaceOrderResult& r) {
+        std::vector<std::pair<uint64_t, int64_t>> out;
+        for (const auto& t : r.trades) out.emplace_back(t.sell_order_id, t.quantity);
+        return out;
+    };
+    using Fills = std::vector<std::pair<uint64_t, int64_t>>;
+
+    SECTION("Pro rata, with the rounding remainder in time priority") {
+        auto ids = setup(Allocation::PRO_RATA, 1);
+        // 2.1, 0.7 and 4.2 round down to 2, 0 and 4; the spare 1 goes to alice
+        auto r = buy(7);
+        REQUIRE(fills(r) == Fills{{ids[0], 3}, {ids[2], 4}});
+        REQUIRE(engine.get_book("BTC-USD")->get_ask_levels(1)[0].quantity == 93);
+    }
+
+    SECTION("Shares are rounded to the lot") {
+        auto ids = setup(Allocation::PRO_RATA, 5);
+        // 13.5, 4.5 and 27 round to 10, 0 and 25; the spare 10 goes to alice
+        auto r = buy(45);
+        REQUIRE(fills(r) == Fills{{ids[0], 20}, {ids[2], 25}});
+    }
+
+    SECTION("Top order first, then pro rata") {
+        auto ids = setup(Allocation::FIFO_PRO_RATA, 1);
+        // alice fills; 10 left split 1.4 / 8.6 over bob and carol
+        auto r = buy(40);
+        REQUIRE(fills(r) == Fills{{ids[0], 30}, {ids[1], 2}, {ids[2], 8}});
+    }
+
+    SECTION("A taker larger than the level sweeps it") {
+        auto ids = setup(Allocation::PRO_RATA, 1);
+        auto r = buy(120);
+        REQUIRE(fills(r) == Fills{{ids[0], 30}, {ids[1], 10}, {ids[2], 60}});
+        REQUIRE(r.order.remaining_qty == 20);
+    }
+
+    SECTION("Own orders are left out of the split") {
+        auto ids = setup(Allocation::PRO_RATA, 1);
+        Order own = resting("dave", "BTC-USD", Side::SELL, 100);
+        own.quantity = 50;
+        auto own_id = engine.place_order(own).order.id;
+        auto r = buy(7, SelfTradePrevention::SKIP);
+        REQUIRE(fills(r) == Fills{{ids[0], 3}, {ids[2], 4}});
+        REQUIRE(engine.get_order(own_id)->remaining_qty == 50);
+
+        r = buy(7);
+        REQUIRE(r.trades.empty());
+        REQUIRE(r.error_code == ErrorCode::SELF_TRADE_PREVENTED);
+    }
+
+    SECTION("Own orders are passed over once per level") {
+        auto ids = setup(Allocation::PRO_RATA, 1);
+        Order own = resting("dave", "BTC-USD", Side::SELL, 100);
+        auto first = engine.place_order(own).order.id;
+        auto second = engine.place_order(own).order.id;
+
+        // Covers the 100 others, then finds only its own orders at the price
+        auto skip = static_cast<size_t>(SelfTradePrevention::SKIP);
+        auto r = buy(120, SelfTradePrevention::SKIP);
+        REQUIRE(fills(r) == Fills{{ids[0], 30}, {ids[1], 10}, {ids[2], 60}});
+        REQUIRE(r.order.status == OrderStatus::CANCELLED);
+        REQUIRE(engine.get_stats().self_trade_prevented[skip] == 2);
+        REQUIRE(engine.get_order(first)->remaining_qty == 10);
+        REQUIRE(engine.get_order(second)->remaining_qty == 10);
+    }
+
+    SECTION("Self-trade prevention stops once the taker is used up") {
+        setup(Allocation::PRO_RATA, 1);
+        Order own = resting("dave", "BTC-USD", Side::SELL, 100);
+        auto first = engine.place_order(own).order.id;
+        auto second = engine.place_order(own).order.id;
+
+        auto decrement = static_cast<size_t>(SelfTradePrevention::DECREMENT_AND_CANCEL);
+        auto r = buy(7, SelfTradePrevention::DECREMENT_AND_CANCEL);
+        REQUIRE(r.trades.empty());
+        REQUIRE(r.order.status == OrderStatus::CANCELLED);
+        REQUIRE(engine.get_stats().self_trade_prevented[decrement] == 1);
+        REQUIRE(engine.get_order(first)->remaining_qty == 3);
+        REQUIRE(engine.get_order(second)->remaining_qty == 10);
+    }
+}
+
+TEST_CASE("Matching - Call auction accumulates, then uncrosses at one price",
+          "[matching][auction]") {
+    MatchingEngine engine;
+    REQUIRE(engine.set_symbol_state("BTC-USD", SymbolState::AUCTION).success);
+    REQUIRE(engine.set_symbol_state("BTC-USD", SymbolState::AUCTION).error_code ==
+            ErrorCode::INVALID_STATE_TRANSITION);
+    REQUIRE(engine.set_symbol_state("XRP-USD", SymbolState::AUCTION).error_code ==
+            ErrorCode::INVALID_SYMBOL);
+
+    auto place = [&](const std::string& account, Side side, int64_t price, int64_t qty) {
+        Order o = resting(account, "BTC-USD", side, price);
+        o.quantity = qty;
+        return engine.place_order(o);
+    };
+    auto b105 = place("alice", Side::BUY, 105, 10);
+    auto b103 = place("bob", Side::BUY, 103, 20);
+    place("carol", Side::BUY, 100, 5);
+    auto s99 = place("dave", Side::SELL, 99, 15);
+    auto s102 = place("erin", Side::SELL, 102, 10);
+    place("frank", Side::SELL, 104, 20);
+    REQUIRE(b105.trades.empty());
+    REQUIRE(s99.trades.empty());
+    REQUIRE(engine.get_book("BTC-USD")->is_crossed());
+
+    Order market = resting("gina", "BTC-USD", Side::BUY, 0);
+    market.type = OrderType::MARKET;
+    REQUIRE(engine.place_order(market).error_code == ErrorCode::SYMBOL_IN_AUCTION);
+    Order ioc = resting("gina", "BTC-USD", Side::BUY, 110);
+    ioc.time_in_force = TimeInForce::IOC;
+    REQUIRE(engine.place_order(ioc).error_code == ErrorCode::SYMBOL_IN_AUCTION);
+
+    auto r = engine.set_symbol_state("BTC-USD", SymbolState::CONTINUOUS);
+    REQUIRE(r.success);
+    REQUIRE(r.uncross.price == 102 * PRICE_SCALE);
+    REQUIRE(r.uncross.volume == 25);
+    REQUIRE(r.trades.size() == 3);
+    for (const auto& t : r.trades) REQUIRE(t.price == 102 * PRICE_SCALE);
+    REQUIRE(r.trades[0].buy_order_id == b105.order.id);
+    REQUIRE(r.trades[0].sell_order_id == s99.order.id);
+    REQUIRE(r.trades[2].buy_order_id == b103.order.id);
+    REQUIRE(r.trades[2].sell_order_id == s102.order.id);
+
+    auto* book = engine.get_book("BTC-USD");
+    REQUIRE_FALSE(book->is_crossed());
+    REQUIRE(book->best_bid_price() == 103 * PRICE_SCALE);
+    REQUIRE(engine.get_order(b103.order.id)->remaining_qty == 5);
+    REQUIRE(book->best_ask_price() == 104 * PRICE_SCALE);
+
+    // Back to continuous matching
+    REQUIRE(engine.symbol_state("BTC-USD") == SymbolState::CONTINUOUS);
+    REQUIRE(place("gina", Side::SELL, 103, 5).trades.size() == 1);
+}
+
+TEST_CASE("Matching - Symbol states gate orders and transitions", "[matching][auction]") {
+    MatchingEngine engine;
+    auto resting_id = engine.place_order(resting("alice", "BTC-USD", Side::BUY, 100)).order.id;
+    REQUIRE(engine.symbol_state("BTC-USD") == SymbolState::CONTINUOUS);
+
+    REQUIRE(engine.set_symbol_state("BTC-USD", SymbolState::HALTED).success);
+    REQUIRE(engine.place_order(resting("bob", "BTC-USD", Side::SELL, 100)).error_code ==
+            ErrorCode::SYMBOL_HALTED);
+    REQUIRE(engine.modify_order(resting_id, 99 * PRICE_SCALE, 10).error_code ==
+            ErrorCode::SYMBOL_HALTED);
+    // Cancels still go through, and other symbols trade on
+    REQUIRE(engine.place_order(resting("bob", "ETH-USD", Side::SELL, 100)).success);
+
+    // A halt reopens through an auction; CLOSED only leads to a new session
+    REQUIRE(engine.set_symbol_state("BTC-USD", SymbolState::PRE_OPEN).success);
+    REQUIRE(engine.place_order(resting("bob", "BTC-USD", Side::SELL, 100)).trades.empty());
+    REQUIRE(engine.set_symbol_state("BTC-USD", SymbolState::CLOSED).success);
+    REQUIRE(engine.place_order(resting("carol", "BTC-USD", Side::SELL, 90)).error_code ==
+            ErrorCode::SYMBOL_CLOSED);
+    REQUIRE(engine.set_symbol_state("BTC-USD", SymbolState::AUCTION).error_code ==
+            ErrorCode::INVALID_STATE_TRANSITION);
+    REQUIRE(engine.cancel_order(resting_id).success);
+
+    REQUIRE(engine.set_symbol_state("BTC-USD", SymbolState::CONTINUOUS).success);
+    auto r = engine.place_order(resting("carol", "BTC-USD", Side::BUY, 100));
+    REQUIRE(r.trades.size() == 1);
+}
+
+TEST_CASE("Matching - Good-till-time orders expire at the next command",
+          "[matching][expiry]") {
+    MatchingEngine engine;
+    uint64_t now = now_ns();
+
+    Order late = resting("alice", "BTC-USD", Side::BUY, 99);
+    late.expire_ts_ns = now - 1;
+    REQUIRE(engine.place_order(late).error_code == ErrorCode::INVALID_EXPIRY);
+
+    Order gtt = resting("alice", "BTC-USD", Side::BUY, 100);
+    gtt.expire_ts_ns = now + 20000000;  // 20 ms
+    auto bid = engine.place_order(gtt).order.id;
+    Order stop = resting("alice", "BTC-USD", Side::BUY, 0);
+    stop.type = OrderType::STOP;
+    stop.stop_price = 110 * PRICE_SCALE;
+    stop.expire_ts_ns = now + 20000000;
+    auto pending = engine.place_order(stop).order.id;
+    gtt.expire_ts_ns = now + 60000000000;  // a minute
+    auto kept = engine.place_order(gtt).order.id;
+    // Cancelled before it is due: its timer is skipped when it fires
+    gtt.expire_ts_ns = now + 20000000;
+    gtt.price = 90 * PRICE_SCALE;
+    auto cancelled = engine.place_order(gtt).order.id;
+    REQUIRE(engine.get_book("BTC-USD")->bid_count() == 3);
+
+    // Not due yet: nothing expires
+    REQUIRE(engine.cancel_order(cancelled).success);
+    auto events = engine.get_stats().event_sequence;
+    (void)engine.cancel_order(999);
+    REQUIRE(engine.get_stats().event_sequence == events);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    // Any command runs expiry first, whatever it does itself
+    REQUIRE_FALSE(engine.cancel_order(999).success);
+    REQUIRE(engine.get_stats().event_sequence == events + 1);
+    REQUIRE(engine.get_order(bid)->status == OrderStatus::EXPIRED);
+    REQUIRE(engine.get_order(pending)->status == OrderStatus::EXPIRED);
+    REQUIRE(engine.get_order(cancelled)->status == OrderStatus::CANCELLED);
+    REQUIRE(engine.get_order(kept)->is_active());
+    REQUIRE(engine.get_book("BTC-USD")->bid_count() == 1);
+    REQUIRE(engine.get_stop_book("BTC-USD")->empty());
+
+    // Expired orders can no longer be cancelled
+    REQUIRE_FALSE(engine.cancel_order(bid).success);
+    REQUIRE(engine.mass_cancel({"alice", "", false}).order_ids == std::vector<uint64_t>{kept});
+}
+
+TEST_CASE("Matching - Idempotency keys are evicted by count and age", "[matching]") {
+    MatchingEngine engine;
+    engine.set_idempotency_limits(2, 20000000);  // 20 ms
+
+    auto keyed = [](const std::string& key) {
+        Order o = resting("trader", "BTC-USD", Side::BUY, 100);
+        o.idempotency_key = key;
+        return o;
+    };
+    auto a = engine.place_order(keyed("a")).order.id;
+    (void)engine.place_order(keyed("b"));
+    (void)engine.place_order(keyed("c"));
+    auto stats = engine.get_stats();
+    REQUIRE(stats.idempotency_keys == 2);
+    REQUIRE(stats.idempotency_bytes > 0);
+
+    // "a" was the oldest and made room for "c"
+    auto again = engine.place_order(keyed("a"));
+    REQUIRE(again.success);
+    REQUIRE(again.order.id != a);
+    REQUIRE(engine.place_order(keyed("c")).duplicate);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    auto fresh = engine.place_order(keyed("c"));
+    REQUIRE(fresh.success);
+    REQUIRE_FALSE(fresh.duplicate);
+    REQUIRE(engine.get_stats().idempotency_keys == 1);
+}
+
+TEST_CASE("Matching - Open orders are found and cancelled by client order id",
+          "[matching][client_order_id]") {
+    MatchingEngine engine;
+    Order bid = resting("alice", "BTC-USD", Side::BUY, 100);
+    bid.client_order_id = "bid-1";
+    auto id = engine.place_order(bid).order.id;
+
+    REQUIRE(engine.get_order("alice", "bid-1")->id == id);
+    REQUIRE_FALSE(engine.get_order("bob", "bid-1"));
+    REQUIRE(engine.place_order(bid).error_code == ErrorCode::DUPLICATE_CLIENT_ORDER_ID);
+    // Another account may use the same id
+    Order other = resting("bob", "BTC-USD", Side::BUY, 99);
+    other.client_order_id = "bid-1";
+    REQUIRE(engine.place_order(other).success);
+
+    auto r = engine.cancel_order("alice", "bid-1");
+    REQUIRE(r.success);
+    REQUIRE(r.order.id == id);
+    REQUIRE_FALSE(engine.get_order("alice", "bid-1"));
+    REQUIRE(engine.cancel_order("alice", "bid-1").error_code == ErrorCode::ORDER_NOT_FOUND);
+
+    // Free again once closed; a fill drops it like a cancel
+    auto again = engine.place_order(bid).order.id;
+    REQUIRE(again != id);
+    REQUIRE(engine.get_order("alice", "bid-1")->id == again);
+    Order ask = resting("carol", "BTC-USD", Side::SELL, 100);
+    ask.client_order_id = "ask-1";
+    REQUIRE(engine.place_order(ask).trades.size() == 1);
+    REQUIRE_FALSE(engine.get_order("alice", "bid-1"));
+    REQUIRE_FALSE(engine.get_order("carol", "ask-1"));  // never rested
+
+    // Pending stops are indexed too
+    Order stop = resting("alice", "BTC-USD", Side::BUY, 0);
+    stop.type = OrderType::STOP;
+    stop.stop_price = 110 * PRICE_SCALE;
+    stop.client_order_id = "stop-1";
+    (void)engine.place_order(stop);
+    REQUIRE(engine.get_order("alice", "stop-1"));
+    REQUIRE(engine.mass_cancel({"alice", "", false}).order_ids.size() == 1);
+    REQUIRE_FALSE(engine.get_order("alice", "stop-1"));
+}
+
+TEST_CASE("Matching - Open orders per account", "[matching][open_orders]") {
+    MatchingEngine engine;
+    auto ids = [](const std::vector<Order>& orders) {
+        std::vector<uint64_t> out;
+        for (const auto& o : orders) out.push_back(o.id);
+        return out;
+    };
+
+    auto a = engine.place_order(resting("alice", "BTC-USD", Side::BUY, 100)).order.id;
+    auto b = engine.place_order(resting("alice", "ETH-USD", Side::SELL, 50)).order.id;
+    Order stop = resting("alice", "BTC-USD", Side::BUY, 0);
+    stop.type = OrderType::STOP;
+    stop.stop_price = 110 * PRICE_SCALE;
+    auto c = engine.place_order(stop).order.id;
+    auto d = engine.place_order(resting("alice", "BTC-USD", Side::BUY, 99)).order.id;
+    (void)engine.place_order(resting("bob", "BTC-USD", Side::BUY, 98));
+
+    REQUIRE(ids(engine.get_open_orders("alice")) == std::vector<uint64_t>{a, b, c, d});
+    REQUIRE(ids(engine.get_open_orders("alice", "BTC-USD")) == std::vector<uint64_t>{a, c, d});
+    REQUIRE(engine.get_open_orders("carol").empty());
+
+    // Unlinked from the middle, the front and the back
+    REQUIRE(engine.cancel_order(c).success);
+    REQUIRE(ids(engine.get_open_orders("alice")) == std::vector<uint64_t>{a, b, d});
+    (void)engine.place_order(resting("bob", "BTC-USD", Side::SELL, 100));  // fills a
+    REQUIRE(ids(engine.get_open_orders("alice")) == std::vector<uint64_t>{b, d});
+    REQUIRE(engine.cancel_order(d).success);
+    REQUIRE(ids(engine.get_open_orders("alice")) == std::vector<uint64_t>{b});
+
+    // Partial fills stay listed with their remaining quantity
+    Order taker = resting("bob", "ETH-USD", Side::BUY, 50);
+    taker.quantity = 4;
+    (void)engine.place_order(taker);
+    auto open = engine.get_open_orders("alice");
+    REQUIRE(open.size() == 1);
+    REQUIRE(open[0].remaining_qty == 6);
+
+    REQUIRE(engine.mass_cancel({"alice", "", false}).order_ids == std::vector<uint64_t>{b});
+    REQUIRE(engine.get_open_orders("alice").empty());
+}
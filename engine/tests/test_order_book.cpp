@@ -1,9 +1,24 @@
 #include <catch2/catch_all.hpp>
 
 #include "exchange/order_book.hpp"
+#include "exchange/stop_book.hpp"
 
 using namespace exchange;
 
+namespace {
+
+Order resting(uint64_t id, Side side, int64_t price, int64_t qty, uint64_t ts) {
+    Order o;
+    o.id = id;
+    o.side = side;
+    o.price = price;
+    o.remaining_qty = qty;
+    o.timestamp_ns = ts;
+    return o;
+}
+
+}  // namespace
+
 TEST_CASE("OrderBook - Empty book", "[orderbook]") {
     OrderBook book("BTC-USD");
 
@@ -51,9 +66,9 @@ TEST_CASE("OrderBook - Add single ask", "[orderbook]") {
 TEST_CASE("OrderBook - Price priority for bids", "[orderbook]") {
     OrderBook book("BTC-USD");
 
-    Order o1{.id = 1, .side = Side::BUY, .price = 100, .remaining_qty = 10, .timestamp_ns = 1};
-    Order o2{.id = 2, .side = Side::BUY, .price = 200, .remaining_qty = 20, .timestamp_ns = 2};
-    Order o3{.id = 3, .side = Side::BUY, .price = 150, .remaining_qty = 15, .timestamp_ns = 3};
+    Order o1 = resting(1, Side::BUY, 100, 10, 1);
+    Order o2 = resting(2, Side::BUY, 200, 20, 2);
+    Order o3 = resting(3, Side::BUY, 150, 15, 3);
 
     book.add_order(&o1);
     book.add_order(&o2);
@@ -71,9 +86,9 @@ TEST_CASE("OrderBook - Price priority for bids", "[orderbook]") {
 TEST_CASE("OrderBook - Time priority within same price", "[orderbook]") {
     OrderBook book("BTC-USD");
 
-    Order o1{.id = 1, .side = Side::BUY, .price = 100, .remaining_qty = 10, .timestamp_ns = 1000};
-    Order o2{.id = 2, .side = Side::BUY, .price = 100, .remaining_qty = 20, .timestamp_ns = 500};
-    Order o3{.id = 3, .side = Side::BUY, .price = 100, .remaining_qty = 15, .timestamp_ns = 2000};
+    Order o1 = resting(1, Side::BUY, 100, 10, 1000);
+    Order o2 = resting(2, Side::BUY, 100, 20, 500);
+    Order o3 = resting(3, Side::BUY, 100, 15, 2000);
 
     book.add_order(&o1);
     book.add_order(&o2);
@@ -89,8 +104,8 @@ TEST_CASE("OrderBook - Time priority within same price", "[orderbook]") {
 TEST_CASE("OrderBook - Remove order", "[orderbook]") {
     OrderBook book("BTC-USD");
 
-    Order o1{.id = 1, .side = Side::BUY, .price = 100, .remaining_qty = 10, .timestamp_ns = 1};
-    Order o2{.id = 2, .side = Side::BUY, .price = 100, .remaining_qty = 20, .timestamp_ns = 2};
+    Order o1 = resting(1, Side::BUY, 100, 10, 1);
+    Order o2 = resting(2, Side::BUY, 100, 20, 2);
 
     book.add_order(&o1);
     book.add_order(&o2);
@@ -112,8 +127,8 @@ TEST_CASE("OrderBook - Remove nonexistent order", "[orderbook]") {
 TEST_CASE("OrderBook - Crossed detection", "[orderbook]") {
     OrderBook book("BTC-USD");
 
-    Order bid{.id = 1, .side = Side::BUY, .price = 100, .remaining_qty = 10, .timestamp_ns = 1};
-    Order ask{.id = 2, .side = Side::SELL, .price = 100, .remaining_qty = 10, .timestamp_ns = 2};
+    Order bid = resting(1, Side::BUY, 100, 10, 1);
+    Order ask = resting(2, Side::SELL, 100, 10, 2);
 
     book.add_order(&bid);
     book.add_order(&ask);
@@ -124,9 +139,9 @@ TEST_CASE("OrderBook - Crossed detection", "[orderbook]") {
 TEST_CASE("OrderBook - Get levels aggregation", "[orderbook]") {
     OrderBook book("BTC-USD");
 
-    Order o1{.id = 1, .side = Side::BUY, .price = 100, .remaining_qty = 10, .timestamp_ns = 1};
-    Order o2{.id = 2, .side = Side::BUY, .price = 100, .remaining_qty = 20, .timestamp_ns = 2};
-    Order o3{.id = 3, .side = Side::BUY, .price = 90, .remaining_qty = 30, .timestamp_ns = 3};
+    Order o1 = resting(1, Side::BUY, 100, 10, 1);
+    Order o2 = resting(2, Side::BUY, 100, 20, 2);
+    Order o3 = resting(3, Side::BUY, 90, 30, 3);
 
     book.add_order(&o1);
     book.add_order(&o2);
@@ -140,4 +155,170 @@ TEST_CASE("OrderBook - Get levels aggregation", "[orderbook]") {
     REQUIRE(levels[1].price == 90);
     REQUIRE(levels[1].quantity == 30);
     REQUIRE(levels[1].order_count == 1);
-}
\ No newline at end of file
+}
+TEST_CASE("OrderBook - BBO tracks add, fill and cancel", "[orderbook]") {
+    OrderBook book("BTC-USD");
+
+    REQUIRE_FALSE(book.bbo().has_bid());
+    REQUIRE_FALSE(book.bbo().has_ask());
+
+    Order b1 = resting(1, Side::BUY, 100, 10, 1);
+    Order b2 = resting(2, Side::BUY, 100, 20, 2);
+    Order b3 = resting(3, Side::BUY, 90, 30, 3);
+    Order a1 = resting(4, Side::SELL, 110, 5, 4);
+
+    book.add_order(&b1);
+    book.add_order(&b2);
+    book.add_order(&b3);
+    book.add_order(&a1);
+
+    REQUIRE(book.bbo().bid.price == 100);
+    REQUIRE(book.bbo().bid.quantity == 30);
+    REQUIRE(book.bbo().bid.order_count == 2);
+    REQUIRE(book.bbo().ask.price == 110);
+    REQUIRE(book.bbo().ask.quantity == 5);
+
+    // Partial fill reduces the aggregate
+    book.update_order_qty(1, 4);
+    REQUIRE(book.bbo().bid.quantity == 24);
+    REQUIRE(book.bbo().bid.order_count == 2);
+
+    // Full fill removes the order
+    book.update_order_qty(1, 0);
+    REQUIRE(book.bbo().bid.quantity == 20);
+    REQUIRE(book.bbo().bid.order_count == 1);
+
+    // Cancelling the last order at the best level falls through to the next one
+    book.remove_order(2);
+    REQUIRE(book.bbo().bid.price == 90);
+    REQUIRE(book.bbo().bid.quantity == 30);
+
+    book.remove_order(4);
+    REQUIRE_FALSE(book.bbo().has_ask());
+}
+
+TEST_CASE("OrderBook - BBO change polling ignores deeper levels", "[orderbook]") {
+    OrderBook book("BTC-USD");
+
+    Order b1 = resting(1, Side::BUY, 100, 10, 1);
+    Order b2 = resting(2, Side::BUY, 90, 10, 2);
+
+    book.add_order(&b1);
+    REQUIRE(book.poll_bbo_change());
+    REQUIRE_FALSE(book.poll_bbo_change());
+
+    book.add_order(&b2);
+    REQUIRE_FALSE(book.poll_bbo_change());
+
+    book.remove_order(2);
+    REQUIRE_FALSE(book.poll_bbo_change());
+
+    book.remove_order(1);
+    REQUIRE(book.poll_bbo_change());
+}
+
+TEST_CASE("StopBook - Trades fire only the stops they reach, nearest first", "[orderbook][stop]") {
+    StopBook stops;
+    std::vector<Order> orders(5);
+    const std::pair<Side, int64_t> specs[] = {
+        {Side::BUY, 105}, {Side::BUY, 103}, {Side::BUY, 103}, {Side::SELL, 95}, {Side::SELL, 97}};
+    for (size_t i = 0; i < orders.size(); ++i) {
+        orders[i].id = i + 1;
+        orders[i].side = specs[i].first;
+        orders[i].stop_price = specs[i].second;
+        stops.add(&orders[i]);
+    }
+
+    std::vector<Order*> fired;
+    stops.trigger(100, fired);
+    REQUIRE(fired.empty());
+    REQUIRE(stops.last_price() == 100);
+
+    stops.trigger(104, fired);
+    REQUIRE(fired == std::vector<Order*>{&orders[1], &orders[2]});
+
+    fired.clear();
+    REQUIRE(stops.remove(5));
+    REQUIRE_FALSE(stops.remove(5));
+    stops.trigger(94, fired);
+    REQUIRE(fired == std::vector<Order*>{&orders[3]});
+    REQUIRE(stops.size() == 1);
+
+    // Already through the last trade price
+    Order late;
+    late.side = Side::SELL;
+    late.stop_price = 95;
+    REQUIRE(stops.is_triggered(late));
+    late.stop_price = 93;
+    REQUIRE_FALSE(stops.is_triggered(late));
+}
+
+TEST_CASE("OrderBook - Icebergs show one slice and refill at the back", "[orderbook][iceberg]") {
+    OrderBook book("BTC-USD");
+    Order iceberg;
+    iceberg.id = 1;
+    iceberg.side = Side::SELL;
+    iceberg.price = 100;
+    iceberg.quantity = iceberg.remaining_qty = 25;
+    iceberg.display_qty = 10;
+    iceberg.reset_display();
+    Order plain = iceberg;
+    plain.id = 2;
+    plain.display_qty = 0;
+    plain.quantity = plain.remaining_qty = 5;
+
+    book.add_order(&iceberg);
+    book.add_order(&plain);
+    REQUIRE(book.get_ask_levels(1)[0].quantity == 15);
+    REQUIRE(book.bbo().ask.quantity == 15);
+    REQUIRE(book.fillable_qty(Side::BUY, 100, 100) == 30);
+
+    // Part of the slice: stays at the front
+    book.update_order_qty(1, 21);
+    REQUIRE(iceberg.visible_qty == 6);
+    REQUIRE(book.get_all_asks().front() == &iceberg);
+
+    // Rest of the slice: the next one shows, behind the plain order
+    book.update_order_qty(1, 15);
+    REQUIRE(iceberg.visible_qty == 10);
+    REQUIRE(book.get_all_asks() == std::vector<Order*>{&plain, &iceberg});
+    REQUIRE(book.get_ask_levels(1)[0].quantity == 15);
+
+    // Last slice is smaller than the peak
+    book.update_order_qty(1, 5);
+    REQUIRE(iceberg.visible_qty == 5);
+    book.remove_order(2);
+    book.update_order_qty(1, 0);
+    REQUIRE_FALSE(book.best_ask_price());
+}
+
+TEST_CASE("OrderBook - Auction price maximises volume, then balance", "[orderbook][auction]") {
+    OrderBook book("BTC-USD");
+    std::vector<Order> orders;
+    orders.reserve(6);
+    auto add = [&](Side side, int64_t price, int64_t qty) {
+        Order o;
+        o.id = orders.size() + 1;
+        o.side = side;
+        o.price = price;
+        o.quantity = o.remaining_qty = qty;
+        orders.push_back(o);
+        book.add_order(&orders.back());
+    };
+    add(Side::BUY, 100, 5);
+    add(Side::SELL, 104, 20);
+    REQUIRE(book.auction_price().volume == 0);
+
+    add(Side::BUY, 105, 10);
+    add(Side::BUY, 103, 20);
+    add(Side::SELL, 99, 15);
+    add(Side::SELL, 102, 10);
+
+    // 25 trade at 102 and 103, leaving 5 bids over; the lower price wins
+    auto a = book.auction_price();
+    REQUIRE(a.price == 102);
+    REQUIRE(a.volume == 25);
+    REQUIRE(a.imbalance == 5);
+    // unless the reference price is nearer the other
+    REQUIRE(book.auction_price(103).price == 103);
+}
@@ -1,6 +1,7 @@
 #include <catch2/catch_all.hpp>
 #include <filesystem>
 #include <fstream>
+#include <thread>
 
 #include "exchange/matching_engine.hpp"
 
@@ -165,4 +166,560 @@ TEST_CASE("Replay - Empty event log returns false", "[replay]") {
     
     // With no events and no snapshot, recover should return false
     REQUIRE_FALSE(engine.recover());
-}
\ No newline at end of file
+}
+TEST_CASE("Replay - Mass cancel and account block are recovered", "[replay]") {
+    TempDir temp;
+    std::string event_log = temp.path() + "/events.jsonl";
+
+    uint64_t kept = 0;
+    {
+        MatchingEngine engine(event_log);
+        Order o;
+        o.account_id = "alice";
+        o.symbol = "BTC-USD";
+        o.side = Side::BUY;
+        o.price = 100 * PRICE_SCALE;
+        o.quantity = 10;
+        for (int i = 0; i < 3; ++i) (void)engine.place_order(o);
+        o.account_id = "bob";
+        kept = engine.place_order(o).order.id;
+
+        REQUIRE(engine.mass_cancel({"alice", "", true}).order_ids.size() == 3);
+        size_t mass = 0;
+        for (const auto& e : engine.event_log().read_all()) {
+            mass += e.type == EventType::MASS_CANCEL;
+        }
+        REQUIRE(mass == 1);
+    }
+
+    MatchingEngine engine(event_log);
+    REQUIRE(engine.recover());
+    REQUIRE(engine.is_blocked("alice"));
+    auto levels = engine.get_book("BTC-USD")->get_bid_levels(10);
+    REQUIRE(levels.size() == 1);
+    REQUIRE(levels[0].quantity == 10);
+
+    // The account index was rebuilt too
+    REQUIRE(engine.mass_cancel({"bob", "", false}).order_ids == std::vector<uint64_t>{kept});
+}
+
+TEST_CASE("Replay - Modified orders are recovered", "[replay]") {
+    TempDir temp;
+    std::string event_log = temp.path() + "/events.jsonl";
+
+    auto order = [](const std::string& account, Side side, int64_t price, int64_t qty) {
+        Order o;
+        o.account_id = account;
+        o.symbol = "BTC-USD";
+        o.side = side;
+        o.price = price * PRICE_SCALE;
+        o.quantity = qty;
+        return o;
+    };
+
+    std::vector<BookLevel> bids, asks;
+    uint64_t shrunk = 0;
+    {
+        MatchingEngine engine(event_log);
+        shrunk = engine.place_order(order("alice", Side::SELL, 101, 10)).order.id;
+        auto moved = engine.place_order(order("bob", Side::SELL, 102, 10)).order.id;
+        (void)engine.place_order(order("carol", Side::BUY, 99, 10));
+
+        REQUIRE(engine.modify_order(shrunk, 101 * PRICE_SCALE, 4).success);
+        REQUIRE(engine.modify_order(moved, 99 * PRICE_SCALE, 15).trades.size() == 1);
+
+        auto events = engine.event_log().read_all();
+        REQUIRE(std::count_if(events.begin(), events.end(), [](const Event& e) {
+                    return e.type == EventType::ORDER_MODIFIED;
+                }) == 2);
+        bids = engine.get_book("BTC-USD")->get_bid_levels(10);
+        asks = engine.get_book("BTC-USD")->get_ask_levels(10);
+    }
+
+    MatchingEngine engine(event_log);
+    REQUIRE(engine.recover());
+    auto* book = engine.get_book("BTC-USD");
+    REQUIRE(book->get_bid_levels(10).size() == bids.size());
+    auto recovered = book->get_ask_levels(10);
+    REQUIRE(recovered.size() == asks.size());
+    for (size_t i = 0; i < asks.size(); ++i) {
+        REQUIRE(recovered[i].price == asks[i].price);
+        REQUIRE(recovered[i].quantity == asks[i].quantity);
+    }
+    REQUIRE(engine.get_order(shrunk)->quantity == 4);
+}
+
+TEST_CASE("Replay - Time in force outcomes are recovered", "[replay]") {
+    TempDir temp;
+    std::string event_log = temp.path() + "/events.jsonl";
+
+    auto order = [](const std::string& account, Side side, int64_t price, TimeInForce tif) {
+        Order o;
+        o.account_id = account;
+        o.symbol = "BTC-USD";
+        o.side = side;
+        o.price = price * PRICE_SCALE;
+        o.quantity = 10;
+        o.time_in_force = tif;
+        return o;
+    };
+
+    uint64_t ioc = 0, rejected = 0, slid = 0;
+    {
+        MatchingEngine engine(event_log);
+        (void)engine.place_order(order("alice", Side::SELL, 101, TimeInForce::GTC));
+        ioc = engine.place_order(order("bob", Side::BUY, 100, TimeInForce::IOC)).order.id;
+        rejected = engine.place_order(order("bob", Side::BUY, 101, TimeInForce::POST_ONLY))
+                       .order.id;
+        slid = engine.place_order(order("bob", Side::BUY, 101, TimeInForce::POST_ONLY_SLIDE))
+                   .order.id;
+        (void)engine.place_order(order("carol", Side::BUY, 100, TimeInForce::FOK));
+    }
+
+    MatchingEngine engine(event_log);
+    REQUIRE(engine.recover());
+    auto* book = engine.get_book("BTC-USD");
+    REQUIRE_FALSE(book->is_crossed());
+    REQUIRE(book->get_bid_levels(10).size() == 1);
+    REQUIRE(book->best_bid_price() == 101 * PRICE_SCALE - 1);
+    REQUIRE(engine.get_order(ioc)->status == OrderStatus::CANCELLED);
+    REQUIRE(engine.get_order(rejected)->status == OrderStatus::REJECTED);
+    REQUIRE(engine.get_order(slid)->price == 101 * PRICE_SCALE - 1);
+}
+
+TEST_CASE("Replay - Self-trade prevention is recovered", "[replay]") {
+    TempDir temp;
+    std::string event_log = temp.path() + "/events.jsonl";
+
+    auto order = [](const std::string& account, Side side, int64_t price, int64_t qty,
+                    SelfTradePrevention mode) {
+        Order o;
+        o.account_id = account;
+        o.symbol = "BTC-USD";
+        o.side = side;
+        o.price = price * PRICE_SCALE;
+        o.quantity = qty;
+        o.self_trade_prevention = mode;
+        return o;
+    };
+    using STP = SelfTradePrevention;
+
+    std::vector<Order> before;
+    {
+        MatchingEngine engine(event_log);
+        (void)engine.place_order(order("alice", Side::SELL, 100, 10, STP::CANCEL_INCOMING));
+        (void)engine.place_order(order("bob", Side::SELL, 100, 10, STP::CANCEL_INCOMING));
+        (void)engine.place_order(order("alice", Side::SELL, 101, 10, STP::CANCEL_INCOMING));
+        // Cancels alice's ask at 100, fills 10 from bob and rests 5
+        (void)engine.place_order(order("alice", Side::BUY, 100, 15, STP::CANCEL_RESTING));
+        // Takes 3 off both; the incoming order is used up
+        (void)engine.place_order(order("alice", Side::SELL, 100, 3, STP::DECREMENT_AND_CANCEL));
+        // Passes over alice's ask at 101 to carol's behind it
+        (void)engine.place_order(order("carol", Side::SELL, 101, 10, STP::CANCEL_INCOMING));
+        (void)engine.place_order(order("alice", Side::BUY, 101, 5, STP::SKIP));
+        for (uint64_t id = 1; id <= 7; ++id) before.push_back(*engine.get_order(id));
+    }
+
+    MatchingEngine engine(event_log);
+    REQUIRE(engine.recover());
+    REQUIRE_FALSE(engine.get_book("BTC-USD")->is_crossed());
+    REQUIRE(before[3].remaining_qty == 2);
+    REQUIRE(before[4].status == OrderStatus::CANCELLED);
+    REQUIRE(before[6].status == OrderStatus::FILLED);
+    for (const auto& o : before) {
+        auto recovered = engine.get_order(o.id);
+        REQUIRE(recovered);
+        INFO("order " << o.id);
+        REQUIRE(recovered->status == o.status);
+        REQUIRE(recovered->quantity == o.quantity);
+        REQUIRE(recovered->remaining_qty == o.remaining_qty);
+    }
+}
+
+TEST_CASE("Replay - Stop cascades are recovered", "[replay]") {
+    TempDir temp;
+    std::string event_log = temp.path() + "/events.jsonl";
+
+    auto order = [](const std::string& account, Side side, OrderType type, int64_t price,
+                    int64_t stop_price) {
+        Order o;
+        o.account_id = account;
+        o.symbol = "BTC-USD";
+        o.side = side;
+        o.type = type;
+        o.price = price * PRICE_SCALE;
+        o.stop_price = stop_price * PRICE_SCALE;
+        o.quantity = 10;
+        return o;
+    };
+
+    std::vector<Order> before;
+    {
+        MatchingEngine engine(event_log);
+        for (int64_t price : {99, 98}) {
+            (void)engine.place_order(order("bob", Side::BUY, OrderType::LIMIT, price, 0));
+        }
+        (void)engine.place_order(order("alice", Side::SELL, OrderType::STOP, 0, 99));
+        (void)engine.place_order(order("carol", Side::SELL, OrderType::STOP_LIMIT, 97, 98));
+        (void)engine.place_order(order("erin", Side::SELL, OrderType::STOP, 0, 90));
+        (void)engine.place_order(order("dave", Side::SELL, OrderType::LIMIT, 99, 0));
+        for (uint64_t id = 1; id <= 6; ++id) before.push_back(*engine.get_order(id));
+    }
+    REQUIRE(before[3].type == OrderType::LIMIT);
+    REQUIRE(before[4].type == OrderType::STOP);
+
+    MatchingEngine engine(event_log);
+    REQUIRE(engine.recover());
+    for (const auto& o : before) {
+        auto recovered = engine.get_order(o.id);
+        INFO("order " << o.id);
+        REQUIRE(recovered->type == o.type);
+        REQUIRE(recovered->status == o.status);
+        REQUIRE(recovered->remaining_qty == o.remaining_qty);
+    }
+    REQUIRE(engine.get_book("BTC-USD")->best_ask_price() == 97 * PRICE_SCALE);
+    REQUIRE(engine.get_stop_book("BTC-USD")->size() == 1);
+
+    // The recovered stop still fires, into an empty book
+    (void)engine.place_order(order("bob", Side::BUY, OrderType::LIMIT, 90, 0));
+    REQUIRE(engine.place_order(order("frank", Side::SELL, OrderType::LIMIT, 90, 0)).success);
+    REQUIRE(engine.get_stop_book("BTC-USD")->empty());
+    REQUIRE(engine.get_order(before[4].id)->status == OrderStatus::REJECTED);
+}
+
+TEST_CASE("Replay - Iceberg queue state is recovered", "[replay]") {
+    TempDir temp;
+    std::string event_log = temp.path() + "/events.jsonl";
+
+    auto order = [](const std::string& account, Side side, int64_t qty, int64_t display) {
+        Order o;
+        o.account_id = account;
+        o.symbol = "BTC-USD";
+        o.side = side;
+        o.price = 100 * PRICE_SCALE;
+        o.quantity = qty;
+        o.display_qty = display;
+        return o;
+    };
+
+    std::vector<Order> asks;
+    {
+        MatchingEngine engine(event_log);
+        (void)engine.place_order(order("alice", Side::SELL, 40, 10));
+        (void)engine.place_order(order("bob", Side::SELL, 10, 0));
+        (void)engine.place_order(order("carol", Side::SELL, 30, 8));
+        // Taker iceberg: consumes its own slices too before resting
+        (void)engine.place_order(order("dave", Side::BUY, 23, 5));
+        (void)engine.place_order(order("erin", Side::BUY, 7, 0));
+        for (Order* o : engine.get_book("BTC-USD")->get_all_asks()) asks.push_back(*o);
+    }
+
+    MatchingEngine engine(event_log);
+    REQUIRE(engine.recover());
+    auto recovered = engine.get_book("BTC-USD")->get_all_asks();
+    REQUIRE(recovered.size() == asks.size());
+    for (size_t i = 0; i < asks.size(); ++i) {
+        REQUIRE(recovered[i]->id == asks[i].id);
+        REQUIRE(recovered[i]->remaining_qty == asks[i].remaining_qty);
+        REQUIRE(recovered[i]->visible_qty == asks[i].visible_qty);
+    }
+}
+
+TEST_CASE("Replay - Pro-rata fills replay from the journal", "[replay]") {
+    TempDir temp;
+    std::string event_log = temp.path() + "/events.jsonl";
+
+    auto order = [](const std::string& account, Side side, int64_t qty) {
+        Order o;
+        o.account_id = account;
+        o.symbol = "BTC-USD";
+        o.side = side;
+        o.price = 100 * PRICE_SCALE;
+        o.quantity = qty;
+        return o;
+    };
+
+    std::vector<Order> bids;
+    {
+        MatchingEngine engine(event_log);
+        RiskLimits limits;
+        SymbolRiskConfig cfg;
+        cfg.symbol = "BTC-USD";
+        cfg.allocation = Allocation::PRO_RATA;
+        limits.symbols = {cfg};
+        engine.set_risk_limits(limits);
+        (void)engine.place_order(order("alice", Side::BUY, 30));
+        (void)engine.place_order(order("bob", Side::BUY, 70));
+        (void)engine.place_order(order("carol", Side::SELL, 15));
+        for (Order* o : engine.get_book("BTC-USD")->get_all_bids()) bids.push_back(*o);
+    }
+    REQUIRE(bids[0].remaining_qty == 25);  // FIFO would leave 15 and 70
+    REQUIRE(bids[1].remaining_qty == 60);
+
+    // The recovering engine matches FIFO, but replay applies journaled trades
+    MatchingEngine engine(event_log);
+    REQUIRE(engine.recover());
+    auto recovered = engine.get_book("BTC-USD")->get_all_bids();
+    REQUIRE(recovered.size() == bids.size());
+    for (size_t i = 0; i < bids.size(); ++i) {
+        REQUIRE(recovered[i]->id == bids[i].id);
+        REQUIRE(recovered[i]->remaining_qty == bids[i].remaining_qty);
+    }
+}
+
+TEST_CASE("Replay - Call auction state and uncross are recovered", "[replay]") {
+    TempDir temp;
+    std::string event_log = temp.path() + "/events.jsonl";
+
+    auto order = [](const std::string& account, Side side, int64_t price, int64_t qty) {
+        Order o;
+        o.account_id = account;
+        o.symbol = "BTC-USD";
+        o.side = side;
+        o.price = price * PRICE_SCALE;
+        o.quantity = qty;
+        return o;
+    };
+
+    {
+        MatchingEngine engine(event_log);
+        REQUIRE(engine.set_symbol_state("BTC-USD", SymbolState::AUCTION).success);
+        (void)engine.place_order(order("alice", Side::BUY, 105, 10));
+        (void)engine.place_order(order("bob", Side::SELL, 99, 4));
+        (void)engine.place_order(order("carol", Side::SELL, 101, 4));
+    }
+
+    std::vector<Trade> trades;
+    {
+        MatchingEngine engine(event_log);
+        REQUIRE(engine.recover());
+        REQUIRE(engine.symbol_state("BTC-USD") == SymbolState::AUCTION);
+        REQUIRE(engine.get_book("BTC-USD")->is_crossed());
+        auto snap = nlohmann::json(engine.create_snapshot()).get<Snapshot>();
+        REQUIRE(snap.symbol_states.at("BTC-USD") == SymbolState::AUCTION);
+        auto r = engine.set_symbol_state("BTC-USD", SymbolState::CONTINUOUS);
+        REQUIRE(r.uncross.volume == 8);
+        trades = r.trades;
+    }
+
+    MatchingEngine engine(event_log);
+    REQUIRE(engine.recover());
+    REQUIRE(engine.symbol_state("BTC-USD") == SymbolState::CONTINUOUS);
+    REQUIRE(engine.get_trades("BTC-USD", 10).size() == trades.size());
+    REQUIRE(engine.get_order(1)->remaining_qty == 2);
+    REQUIRE(engine.get_book("BTC-USD")->bid_count() == 1);
+    REQUIRE(engine.get_book("BTC-USD")->ask_count() == 0);
+}
+
+TEST_CASE("Replay - Expired orders and pending deadlines are recovered", "[replay]") {
+    TempDir temp;
+    std::string event_log = temp.path() + "/events.jsonl";
+
+    auto order = [](int64_t price, uint64_t expire_ts_ns) {
+        Order o;
+        o.account_id = "alice";
+        o.symbol = "BTC-USD";
+        o.side = Side::BUY;
+        o.price = price * PRICE_SCALE;
+        o.quantity = 10;
+        o.expire_ts_ns = expire_ts_ns;
+        return o;
+    };
+
+    uint64_t now = now_ns();
+    {
+        MatchingEngine engine(event_log);
+        (void)engine.place_order(order(100, now + 10000000));
+        (void)engine.place_order(order(101, now + 60000000));
+        (void)engine.place_order(order(102, 0));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        REQUIRE_FALSE(engine.cancel_order(999).success);
+        REQUIRE(engine.get_order(1)->status == OrderStatus::EXPIRED);
+    }
+
+    {
+        MatchingEngine engine(event_log);
+        REQUIRE(engine.recover());
+        REQUIRE(engine.get_order(1)->status == OrderStatus::EXPIRED);
+        REQUIRE(engine.get_order(2)->expire_ts_ns == now + 60000000);
+        REQUIRE(engine.get_book("BTC-USD")->bid_count() == 2);
+        auto snap = nlohmann::json(engine.create_snapshot()).get<Snapshot>();
+        REQUIRE(snap.orders.size() == 2);
+    }
+
+    // Order 2 came due while the engine was down: it expires on the first
+    // command after recovery
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    MatchingEngine engine(event_log);
+    REQUIRE(engine.recover());
+    REQUIRE(engine.get_order(2)->is_active());
+    REQUIRE_FALSE(engine.cancel_order(999).success);
+    REQUIRE(engine.get_order(2)->status == OrderStatus::EXPIRED);
+    REQUIRE(engine.get_order(3)->is_active());
+    REQUIRE(engine.get_book("BTC-USD")->bid_count() == 1);
+}
+
+TEST_CASE("Replay - Idempotency keys survive snapshots and replay", "[replay]") {
+    TempDir temp;
+    std::string event_log = temp.path() + "/events.jsonl";
+    std::string snapshot_dir = temp.path() + "/snapshots";
+
+    auto keyed = [](const std::string& key, Side side) {
+        Order o;
+        o.account_id = key;
+        o.symbol = "BTC-USD";
+        o.side = side;
+        o.price = 100 * PRICE_SCALE;
+        o.quantity = 10;
+        o.idempotency_key = key;
+        return o;
+    };
+
+    {
+        MatchingEngine engine(event_log, snapshot_dir);
+        (void)engine.place_order(keyed("filled", Side::SELL));
+        (void)engine.place_order(keyed("taker", Side::BUY));
+        SnapshotManager(snapshot_dir).save(engine.create_snapshot());
+        // After the snapshot: recovered from the journal
+        (void)engine.place_order(keyed("late", Side::SELL));
+        Order lift = keyed("lift", Side::BUY);
+        lift.quantity = 4;
+        (void)engine.place_order(lift);
+    }
+
+    MatchingEngine engine(event_log, snapshot_dir);
+    REQUIRE(engine.recover());
+    REQUIRE(engine.get_stats().idempotency_keys == 4);
+
+    // Both orders were done before the snapshot and are not loaded; the
+    // snapshot kept what their placements returned
+    auto r = engine.place_order(keyed("filled", Side::SELL));
+    REQUIRE(r.duplicate);
+    REQUIRE(r.success);
+    REQUIRE(r.order.id == 1);
+    REQUIRE(r.order.status == OrderStatus::NEW);
+    REQUIRE(r.trades.empty());
+    r = engine.place_order(keyed("taker", Side::BUY));
+    REQUIRE(r.duplicate);
+    REQUIRE(r.order.id == 2);
+    REQUIRE(r.order.status == OrderStatus::FILLED);
+    REQUIRE(r.trades.size() == 1);
+    REQUIRE(r.trades[0].sell_order_id == 1);
+
+    // Journaled responses are rebuilt by replay
+    r = engine.place_order(keyed("late", Side::SELL));
+    REQUIRE(r.duplicate);
+    REQUIRE(r.order.id == 3);
+    REQUIRE(r.order.remaining_qty == 10);
+    r = engine.place_order(keyed("lift", Side::BUY));
+    REQUIRE(r.duplicate);
+    REQUIRE(r.order.id == 4);
+    REQUIRE(r.order.status == OrderStatus::FILLED);
+    REQUIRE(r.trades.size() == 1);
+    REQUIRE(r.trades[0].id == 2);
+    REQUIRE(r.trades[0].quantity == 4);
+
+    REQUIRE(engine.get_stats().total_orders == 0);
+    REQUIRE(engine.get_book("BTC-USD")->ask_count() == 1);
+    REQUIRE(engine.get_order(3)->remaining_qty == 6);
+}
+
+TEST_CASE("Replay - Client order id index is rebuilt", "[replay]") {
+    TempDir temp;
+    std::string event_log = temp.path() + "/events.jsonl";
+
+    auto order = [](const std::string& cl_id, const std::string& symbol, Side side,
+                    int64_t qty) {
+        Order o;
+        o.account_id = "alice";
+        o.symbol = symbol;
+        o.side = side;
+        o.price = 100 * PRICE_SCALE;
+        o.quantity = qty;
+        o.client_order_id = cl_id;
+        return o;
+    };
+
+    {
+        MatchingEngine engine(event_log);
+        (void)engine.place_order(order("open", "BTC-USD", Side::BUY, 10));
+        (void)engine.place_order(order("gone", "BTC-USD", Side::BUY, 10));
+        REQUIRE(engine.cancel_order("alice", "gone").success);
+        (void)engine.place_order(order("eth", "ETH-USD", Side::SELL, 5));
+        Order stop = order("stop", "BTC-USD", Side::SELL, 3);
+        stop.type = OrderType::STOP;
+        stop.stop_price = 90 * PRICE_SCALE;
+        (void)engine.place_order(stop);
+        (void)engine.place_order(order("eth2", "ETH-USD", Side::SELL, 7));
+        (void)engine.place_order(order("btc", "BTC-USD", Side::BUY, 4));
+    }
+
+    MatchingEngine engine(event_log);
+    REQUIRE(engine.recover());
+    REQUIRE(engine.get_order("alice", "open")->id == 1);
+    REQUIRE_FALSE(engine.get_order("alice", "gone"));
+
+    // Oldest first across symbols, the untriggered stop in its place
+    std::vector<std::string> ids;
+    for (const Order& o : engine.get_open_orders("alice")) ids.push_back(o.client_order_id);
+    REQUIRE(ids == std::vector<std::string>{"open", "eth", "stop", "eth2", "btc"});
+    ids.clear();
+    for (const Order& o : engine.get_open_orders("alice", "BTC-USD")) {
+        ids.push_back(o.client_order_id);
+    }
+    REQUIRE(ids == std::vector<std::string>{"open", "stop", "btc"});
+
+    REQUIRE(engine.place_order(order("open", "BTC-USD", Side::BUY, 10)).error_code ==
+            ErrorCode::DUPLICATE_CLIENT_ORDER_ID);
+    REQUIRE(engine.place_order(order("gone", "BTC-USD", Side::BUY, 10)).success);
+}
+
+TEST_CASE("Replay - Open orders keep placement order across recovery", "[replay]") {
+    TempDir temp;
+    std::string event_log = temp.path() + "/events.jsonl";
+    std::string snapshot_dir = temp.path() + "/snapshots";
+
+    auto order = [](const std::string& account, Side side, int64_t price) {
+        Order o;
+        o.account_id = account;
+        o.symbol = "BTC-USD";
+        o.side = side;
+        o.price = price * PRICE_SCALE;
+        o.quantity = 10;
+        return o;
+    };
+    auto ids = [](const std::vector<Order>& orders) {
+        std::vector<uint64_t> out;
+        for (const auto& o : orders) out.push_back(o.id);
+        return out;
+    };
+
+    std::vector<uint64_t> live;
+    {
+        MatchingEngine engine(event_log);
+        auto a = engine.place_order(order("alice", Side::BUY, 100)).order.id;
+        auto b = engine.place_order(order("alice", Side::BUY, 99)).order.id;
+        Order stop = order("alice", Side::BUY, 104);
+        stop.type = OrderType::STOP_LIMIT;
+        stop.stop_price = 105 * PRICE_SCALE;
+        auto s = engine.place_order(stop).order.id;
+        auto d = engine.place_order(order("alice", Side::BUY, 98)).order.id;
+
+        // The stop fires and rests, then a is re-queued at a new price; both
+        // are re-linked but keep their places
+        (void)engine.place_order(order("bob", Side::SELL, 105));
+        (void)engine.place_order(order("carol", Side::BUY, 105));
+        REQUIRE(engine.get_order(s)->type == OrderType::LIMIT);
+        REQUIRE(engine.modify_order(a, 101 * PRICE_SCALE, 10).success);
+
+        live = ids(engine.get_open_orders("alice"));
+        REQUIRE(live == std::vector<uint64_t>{a, b, s, d});
+        SnapshotManager(snapshot_dir).save(engine.create_snapshot());
+    }
+
+    for (const std::string& snapshots : {std::string{}, snapshot_dir}) {
+        MatchingEngine engine(event_log, snapshots);
+        REQUIRE(engine.recover());
+        REQUIRE(ids(engine.get_open_orders("alice")) == live);
+    }
+}
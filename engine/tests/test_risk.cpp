@@ -1,5 +1,9 @@
 #include <catch2/catch_all.hpp>
 
+#include <filesystem>
+#include <fstream>
+
+#include "exchange/matching_engine.hpp"
 #include "exchange/risk_checks.hpp"
 
 using namespace exchange;
@@ -74,6 +78,29 @@ TEST_CASE("RiskChecker - Invalid symbol fails", "[risk]") {
     REQUIRE(result.error_code == ErrorCode::INVALID_SYMBOL);
 }
 
+TEST_CASE("RiskChecker - Symbols longer than the L3 field are refused", "[risk]") {
+    RiskLimits limits;
+    limits.allowed_symbols = {"ABCDEFGHI-USD", "ABCDEFGHIJ-USD"};  // 13 and 14 chars
+    RiskChecker checker(limits);
+    REQUIRE(checker.is_valid_symbol("ABCDEFGHI-USD"));
+    REQUIRE_FALSE(checker.is_valid_symbol("ABCDEFGHIJ-USD"));
+
+    Order order;
+    order.symbol = "ABCDEFGHIJ-USD";
+    order.type = OrderType::LIMIT;
+    order.price = 100 * PRICE_SCALE;
+    order.quantity = 1;
+    REQUIRE(checker.check_order(order).error_code == ErrorCode::INVALID_SYMBOL);
+
+    auto path = std::filesystem::temp_directory_path() / "aztec_test_long_symbol.json";
+    {
+        std::ofstream out(path);
+        out << R"({"symbols": [{"symbol": "BTC-USD"}, {"symbol": "ABCDEFGHIJ-USD"}]})";
+    }
+    REQUIRE_FALSE(load_risk_config(path.string()));
+    std::filesystem::remove(path);
+}
+
 TEST_CASE("RiskChecker - Max order size exceeded", "[risk]") {
     RiskLimits limits;
     limits.max_order_size = 100;
@@ -88,4 +115,435 @@ TEST_CASE("RiskChecker - Max order size exceeded", "[risk]") {
     auto result = checker.check_order(order);
     REQUIRE_FALSE(result.passed);
     REQUIRE(result.error_code == ErrorCode::MAX_ORDER_SIZE_EXCEEDED);
-}
\ No newline at end of file
+}
+TEST_CASE("RiskChecker - Per-symbol tick, lot and quantity bounds", "[risk]") {
+    RiskLimits limits;
+    SymbolRiskConfig cfg;
+    cfg.symbol = "SOL-USD";
+    cfg.tick_size = PRICE_SCALE / 100;
+    cfg.lot_size = 10;
+    cfg.min_qty = 20;
+    cfg.max_qty = 1000;
+    limits.symbols.push_back(cfg);
+    RiskChecker checker(limits);
+
+    REQUIRE(checker.is_valid_symbol("SOL-USD"));
+    REQUIRE(checker.is_valid_symbol("BTC-USD"));
+
+    Order order;
+    order.symbol = "SOL-USD";
+    order.type = OrderType::LIMIT;
+    order.price = 150 * PRICE_SCALE + PRICE_SCALE / 100;
+    order.quantity = 100;
+    REQUIRE(checker.check_order(order).passed);
+
+    order.price += 1;
+    REQUIRE(checker.check_order(order).error_code == ErrorCode::INVALID_TICK_SIZE);
+
+    order.price = 150 * PRICE_SCALE;
+    order.quantity = 105;
+    REQUIRE(checker.check_order(order).error_code == ErrorCode::INVALID_LOT_SIZE);
+
+    order.quantity = 10;
+    REQUIRE(checker.check_order(order).error_code == ErrorCode::INVALID_QUANTITY);
+
+    order.quantity = 1010;
+    REQUIRE(checker.check_order(order).error_code == ErrorCode::MAX_ORDER_SIZE_EXCEEDED);
+
+    // Tick size does not apply to market orders
+    order.type = OrderType::MARKET;
+    order.price = 1;
+    order.quantity = 100;
+    REQUIRE(checker.check_order(order).passed);
+}
+
+TEST_CASE("RiskChecker - Price band", "[risk]") {
+    RiskLimits limits;
+    SymbolRiskConfig cfg;
+    cfg.symbol = "BTC-USD";
+    cfg.min_price = 1000 * PRICE_SCALE;
+    cfg.max_price = 100000 * PRICE_SCALE;
+    limits.symbols.push_back(cfg);
+    RiskChecker checker(limits);
+
+    Order order;
+    order.symbol = "BTC-USD";
+    order.type = OrderType::LIMIT;
+    order.quantity = 1;
+
+    order.price = 1000 * PRICE_SCALE;
+    REQUIRE(checker.check_order(order).passed);
+    order.price = 100000 * PRICE_SCALE;
+    REQUIRE(checker.check_order(order).passed);
+
+    order.price = 999 * PRICE_SCALE;
+    REQUIRE(checker.check_order(order).error_code == ErrorCode::PRICE_OUT_OF_BAND);
+    order.price = 100001 * PRICE_SCALE;
+    REQUIRE(checker.check_order(order).error_code == ErrorCode::PRICE_OUT_OF_BAND);
+}
+
+TEST_CASE("RiskChecker - Notional is checked exactly", "[risk]") {
+    RiskLimits limits;
+    limits.max_order_size = INT64_MAX;
+    limits.max_notional = 1000 * PRICE_SCALE;
+    RiskChecker checker(limits);
+
+    Order order;
+    order.symbol = "BTC-USD";
+    order.type = OrderType::LIMIT;
+    order.price = 10 * PRICE_SCALE;
+    order.quantity = 100 * PRICE_SCALE;
+    REQUIRE(checker.check_order(order).passed);  // exactly at the limit
+
+    order.quantity += 1;
+    REQUIRE(checker.check_order(order).error_code == ErrorCode::MAX_NOTIONAL_EXCEEDED);
+
+    // price * qty overflows 64 bits
+    order.price = INT64_MAX / 2;
+    order.quantity = INT64_MAX / 2;
+    REQUIRE(checker.check_order(order).error_code == ErrorCode::MAX_NOTIONAL_EXCEEDED);
+}
+
+TEST_CASE("RiskChecker - Unknown symbol keeps check precedence", "[risk]") {
+    RiskChecker checker;
+
+    Order order;
+    order.symbol = "INVALID-PAIR";
+    order.type = OrderType::LIMIT;
+    order.price = 10000 * PRICE_SCALE;
+    order.quantity = 0;
+    REQUIRE(checker.check_order(order).error_code == ErrorCode::INVALID_QUANTITY);
+
+    order.quantity = 100;
+    order.price = -1;
+    REQUIRE(checker.check_order(order).error_code == ErrorCode::INVALID_PRICE);
+}
+
+TEST_CASE("RiskChecker - Limits load from JSON", "[risk]") {
+    auto j = nlohmann::json::parse(R"({
+        "max_order_size": 500,
+        "symbols": [
+            {"symbol": "DOGE-USD", "tick_size": 100000, "lot_size": 5,
+             "allocation": "PRO_RATA"},
+            {"symbol": "ETH-USD"}
+        ]
+    })");
+    auto limits = j.get<RiskLimits>();
+    RiskChecker checker(limits);
+
+    // A symbols list without allowed_symbols is the whole symbol set
+    REQUIRE(checker.symbols().size() == 2);
+    REQUIRE_FALSE(checker.is_valid_symbol("BTC-USD"));
+    REQUIRE(checker.symbol_id("DOGE-USD") == 0);
+
+    const auto& doge = checker.symbol_limits(checker.symbol_id("DOGE-USD"));
+    REQUIRE(doge.tick_size == 100000);
+    REQUIRE(doge.lot_size == 5);
+    REQUIRE(doge.max_qty == 500);
+    REQUIRE(doge.allocation == Allocation::PRO_RATA);
+    REQUIRE(checker.symbol_limits(checker.symbol_id("ETH-USD")).allocation == Allocation::FIFO);
+
+    RiskLimits round_trip = nlohmann::json(limits).get<RiskLimits>();
+    REQUIRE(round_trip.symbols.size() == 2);
+    REQUIRE(round_trip.symbols[0].lot_size == 5);
+    REQUIRE(round_trip.symbols[0].allocation == Allocation::PRO_RATA);
+    REQUIRE(round_trip.allowed_symbols.empty());
+}
+
+TEST_CASE("SymbolTable - Dense ids", "[risk]") {
+    SymbolTable table;
+    for (int i = 0; i < 100; ++i) {
+        REQUIRE(table.add("SYM" + std::to_string(i)) == static_cast<uint32_t>(i));
+    }
+    REQUIRE(table.add("SYM42") == 42);
+    REQUIRE(table.size() == 100);
+    for (int i = 0; i < 100; ++i) {
+        REQUIRE(table.find("SYM" + std::to_string(i)) == static_cast<uint32_t>(i));
+    }
+    REQUIRE(table.find("SYM100") == SymbolTable::NOT_FOUND);
+    REQUIRE(table.name(7) == "SYM7");
+}
+
+namespace {
+
+Order limit_order(const std::string& account, Side side, int64_t price, int64_t qty) {
+    Order o;
+    o.account_id = account;
+    o.symbol = "BTC-USD";
+    o.side = side;
+    o.type = OrderType::LIMIT;
+    o.price = price;
+    o.quantity = qty;
+    return o;
+}
+
+}  // namespace
+
+TEST_CASE("RiskChecker - Open order count limit", "[risk]") {
+    RiskLimits limits;
+    limits.max_open_orders = 2;
+    MatchingEngine engine;
+    engine.set_risk_limits(limits);
+
+    auto first = engine.place_order(limit_order("alice", Side::BUY, 100 * PRICE_SCALE, 10));
+    REQUIRE(engine.place_order(limit_order("alice", Side::BUY, 99 * PRICE_SCALE, 10)).success);
+
+    auto r = engine.place_order(limit_order("alice", Side::BUY, 98 * PRICE_SCALE, 10));
+    REQUIRE(r.error_code == ErrorCode::MAX_OPEN_ORDERS_EXCEEDED);
+    REQUIRE(engine.place_order(limit_order("bob", Side::BUY, 98 * PRICE_SCALE, 10)).success);
+
+    // A full fill frees a slot, as does a cancel
+    REQUIRE(engine.place_order(limit_order("bob", Side::SELL, 100 * PRICE_SCALE, 10)).success);
+    REQUIRE(engine.risk_checker().exposure("alice", "BTC-USD").open_orders == 1);
+    REQUIRE(engine.place_order(limit_order("alice", Side::BUY, 98 * PRICE_SCALE, 10)).success);
+    REQUIRE(engine.cancel_order(first.order.id + 1).success);
+    REQUIRE(engine.risk_checker().exposure("alice", "BTC-USD").open_orders == 1);
+}
+
+TEST_CASE("RiskChecker - Open notional limit", "[risk]") {
+    RiskLimits limits;
+    limits.accounts.push_back({"alice", 0, 1000 * PRICE_SCALE, 0});
+    MatchingEngine engine;
+    engine.set_risk_limits(limits);
+
+    REQUIRE(engine.place_order(limit_order("alice", Side::BUY, 10 * PRICE_SCALE,
+                                           60 * PRICE_SCALE)).success);
+    auto r = engine.place_order(limit_order("alice", Side::BUY, 10 * PRICE_SCALE,
+                                            50 * PRICE_SCALE));
+    REQUIRE(r.error_code == ErrorCode::MAX_OPEN_NOTIONAL_EXCEEDED);
+    REQUIRE(engine.risk_checker().exposure("alice", "BTC-USD").open_notional ==
+            600 * PRICE_SCALE);
+
+    // The limit is per account
+    REQUIRE(engine.place_order(limit_order("bob", Side::BUY, 10 * PRICE_SCALE,
+                                           200 * PRICE_SCALE)).success);
+
+    // A partial fill releases the filled part
+    REQUIRE(engine.place_order(limit_order("carol", Side::SELL, 10 * PRICE_SCALE,
+                                           20 * PRICE_SCALE)).success);
+    REQUIRE(engine.risk_checker().exposure("alice", "BTC-USD").open_notional ==
+            400 * PRICE_SCALE);
+    REQUIRE(engine.place_order(limit_order("alice", Side::BUY, 10 * PRICE_SCALE,
+                                           50 * PRICE_SCALE)).success);
+}
+
+TEST_CASE("RiskChecker - Position limit counts open orders", "[risk]") {
+    RiskLimits limits;
+    limits.max_position = 100;
+    MatchingEngine engine;
+    engine.set_risk_limits(limits);
+
+    REQUIRE(engine.place_order(limit_order("alice", Side::BUY, 100 * PRICE_SCALE, 60)).success);
+    REQUIRE(engine.place_order(limit_order("bob", Side::SELL, 100 * PRICE_SCALE, 60)).success);
+
+    auto e = engine.risk_checker().exposure("alice", "BTC-USD");
+    REQUIRE(e.position == 60);
+    REQUIRE(e.open_buy_qty == 0);
+    REQUIRE(engine.risk_checker().exposure("bob", "BTC-USD").position == -60);
+
+    REQUIRE(engine.place_order(limit_order("alice", Side::BUY, 99 * PRICE_SCALE, 30)).success);
+    auto r = engine.place_order(limit_order("alice", Side::BUY, 99 * PRICE_SCALE, 20));
+    REQUIRE(r.error_code == ErrorCode::MAX_POSITION_EXCEEDED);
+
+    // Selling reduces the long first, so 160 only reaches -100
+    REQUIRE(engine.place_order(limit_order("alice", Side::SELL, 101 * PRICE_SCALE, 160)).success);
+    r = engine.place_order(limit_order("alice", Side::SELL, 101 * PRICE_SCALE, 1));
+    REQUIRE(r.error_code == ErrorCode::MAX_POSITION_EXCEEDED);
+
+    // Market orders are bounded too
+    Order market = limit_order("bob", Side::SELL, 0, 50);
+    market.type = OrderType::MARKET;
+    REQUIRE(engine.place_order(market).error_code == ErrorCode::MAX_POSITION_EXCEEDED);
+}
+
+TEST_CASE("RiskChecker - Exposure is rebuilt on recovery", "[risk]") {
+    auto dir = std::filesystem::temp_directory_path() / "aztec_test_risk_recovery";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    auto log = (dir / "events.jsonl").string();
+
+    AccountExposure before;
+    {
+        MatchingEngine engine(log);
+        (void)engine.place_order(limit_order("alice", Side::BUY, 100 * PRICE_SCALE, 60));
+        (void)engine.place_order(limit_order("alice", Side::BUY, 99 * PRICE_SCALE, 40));
+        (void)engine.place_order(limit_order("bob", Side::SELL, 100 * PRICE_SCALE, 25));
+        before = engine.risk_checker().exposure("alice", "BTC-USD");
+    }
+
+    MatchingEngine engine(log);
+    REQUIRE(engine.recover());
+    auto after = engine.risk_checker().exposure("alice", "BTC-USD");
+    REQUIRE(after.open_orders == before.open_orders);
+    REQUIRE(after.open_notional == before.open_notional);
+    REQUIRE(after.position == 25);
+    REQUIRE(after.open_buy_qty == 75);
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("RiskChecker - Positions and reference prices survive snapshots", "[risk]") {
+    auto dir = std::filesystem::temp_directory_path() / "aztec_test_risk_snapshot";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    auto log = (dir / "events.jsonl").string();
+    auto snapshots = (dir / "snapshots").string();
+
+    RiskLimits limits;
+    limits.max_position = 100;
+    limits.price_band_bps = 1000;  // 10%
+    {
+        MatchingEngine engine(log, snapshots);
+        engine.set_risk_limits(limits);
+        (void)engine.place_order(limit_order("bob", Side::SELL, 100 * PRICE_SCALE, 60));
+        (void)engine.place_order(limit_order("alice", Side::BUY, 100 * PRICE_SCALE, 60));
+        SnapshotManager(snapshots).save(engine.create_snapshot());
+        // After the snapshot: replayed from the journal on top of it
+        (void)engine.place_order(limit_order("bob", Side::SELL, 101 * PRICE_SCALE, 10));
+        (void)engine.place_order(limit_order("alice", Side::BUY, 101 * PRICE_SCALE, 10));
+    }
+
+    MatchingEngine engine(log, snapshots);
+    engine.set_risk_limits(limits);
+    REQUIRE(engine.recover());
+    REQUIRE(engine.get_trades("BTC-USD", 10).size() == 1);
+    REQUIRE(engine.risk_checker().exposure("alice", "BTC-USD").position == 70);
+    REQUIRE(engine.risk_checker().exposure("bob", "BTC-USD").position == -70);
+    REQUIRE(engine.risk_checker().reference_price("BTC-USD") == 101 * PRICE_SCALE);
+
+    auto r = engine.place_order(limit_order("alice", Side::BUY, 100 * PRICE_SCALE, 31));
+    REQUIRE(r.error_code == ErrorCode::MAX_POSITION_EXCEEDED);
+    r = engine.place_order(limit_order("carol", Side::BUY, 112 * PRICE_SCALE, 1));
+    REQUIRE(r.error_code == ErrorCode::PRICE_OUT_OF_BAND);
+    REQUIRE(engine.place_order(limit_order("alice", Side::BUY, 100 * PRICE_SCALE, 30)).success);
+
+    // A snapshot of the recovered engine carries the same totals
+    auto snap = engine.create_snapshot();
+    REQUIRE(snap.positions.at("alice").at("BTC-USD") == 70);
+    REQUIRE(snap.last_trade_prices.at("BTC-USD") == 101 * PRICE_SCALE);
+    REQUIRE_FALSE(snap.positions.count("carol"));
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("RiskChecker - Price collar around the reference price", "[risk]") {
+    RiskLimits limits;
+    limits.price_band_bps = 1000;  // 10%
+    MatchingEngine engine;
+    engine.set_risk_limits(limits);
+    const auto& risk = engine.risk_checker();
+
+    // No reference yet: anything goes
+    REQUIRE(risk.reference_price("BTC-USD") == 0);
+    REQUIRE(engine.place_order(limit_order("alice", Side::BUY, 90 * PRICE_SCALE, 10)).success);
+
+    // Two-sided book: the mid is the reference
+    REQUIRE(engine.place_order(limit_order("bob", Side::SELL, 110 * PRICE_SCALE, 10)).success);
+    REQUIRE(risk.reference_price("BTC-USD") == 100 * PRICE_SCALE);
+    REQUIRE(engine.place_order(limit_order("bob", Side::SELL, 89 * PRICE_SCALE, 10)).error_code ==
+            ErrorCode::PRICE_OUT_OF_BAND);
+
+    // After a trade the last price is the reference
+    REQUIRE(engine.place_order(limit_order("carol", Side::BUY, 110 * PRICE_SCALE, 5)).success);
+    REQUIRE(risk.reference_price("BTC-USD") == 110 * PRICE_SCALE);
+    auto c = risk.collar("BTC-USD");
+    REQUIRE(c.lo == 99 * PRICE_SCALE);
+    REQUIRE(c.hi == 121 * PRICE_SCALE);
+    REQUIRE(engine.place_order(limit_order("carol", Side::BUY, 122 * PRICE_SCALE, 5)).error_code ==
+            ErrorCode::PRICE_OUT_OF_BAND);
+    REQUIRE(engine.place_order(limit_order("carol", Side::BUY, 121 * PRICE_SCALE, 5)).success);
+}
+
+TEST_CASE("RiskChecker - Market orders stop at the collar", "[risk]") {
+    RiskLimits limits;
+    limits.price_band_bps = 1000;
+    MatchingEngine engine;
+    engine.set_risk_limits(limits);
+
+    // Asks rest before there is a reference price, then a trade at 100 sets it
+    for (int64_t px : {105, 109, 115}) {
+        REQUIRE(engine.place_order(limit_order("carol", Side::SELL, px * PRICE_SCALE, 10)).success);
+    }
+    REQUIRE(engine.place_order(limit_order("alice", Side::SELL, 100 * PRICE_SCALE, 10)).success);
+    REQUIRE(engine.place_order(limit_order("bob", Side::BUY, 100 * PRICE_SCALE, 10)).success);
+
+    Order sweep = limit_order("bob", Side::BUY, 0, 30);
+    sweep.type = OrderType::MARKET;
+    auto r = engine.place_order(sweep);
+    REQUIRE(r.success);
+    REQUIRE(r.trades.size() == 2);
+    REQUIRE(r.trades.back().price == 109 * PRICE_SCALE);
+    REQUIRE(r.order.remaining_qty == 10);
+    REQUIRE(engine.get_book("BTC-USD")->best_ask_price() == 115 * PRICE_SCALE);
+
+    // With nothing inside the band the order is rejected, not left unfilled
+    limits.price_band_bps = 100;
+    engine.set_risk_limits(limits);
+    sweep.quantity = 10;
+    r = engine.place_order(sweep);
+    REQUIRE_FALSE(r.success);
+    REQUIRE(r.error_code == ErrorCode::PRICE_OUT_OF_BAND);
+}
+
+TEST_CASE("RiskChecker - Parked stops count as open orders", "[risk]") {
+    RiskLimits limits;
+    limits.max_open_orders = 2;
+    limits.max_position = 100;
+    MatchingEngine engine;
+    engine.set_risk_limits(limits);
+
+    auto stop = [](OrderType type, int64_t stop_price) {
+        Order o = limit_order("alice", Side::BUY, type == OrderType::STOP ? 0 : 120 * PRICE_SCALE,
+                              40);
+        o.type = type;
+        o.stop_price = stop_price * PRICE_SCALE;
+        return o;
+    };
+    auto first = engine.place_order(stop(OrderType::STOP, 110));
+    REQUIRE(first.success);
+    REQUIRE(engine.place_order(stop(OrderType::STOP_LIMIT, 115)).success);
+    auto e = engine.risk_checker().exposure("alice", "BTC-USD");
+    REQUIRE(e.open_orders == 2);
+    REQUIRE(e.open_notional == 120 * 40);
+    REQUIRE(e.open_buy_qty == 80);
+
+    REQUIRE(engine.place_order(stop(OrderType::STOP, 112)).error_code ==
+            ErrorCode::MAX_OPEN_ORDERS_EXCEEDED);
+    REQUIRE(engine.place_order(limit_order("alice", Side::BUY, 90 * PRICE_SCALE, 10))
+                .error_code == ErrorCode::MAX_OPEN_ORDERS_EXCEEDED);
+
+    // Cancelling a stop frees its slot and position headroom
+    REQUIRE(engine.cancel_order(first.order.id).success);
+    e = engine.risk_checker().exposure("alice", "BTC-USD");
+    REQUIRE(e.open_orders == 1);
+    REQUIRE(e.open_buy_qty == 40);
+    REQUIRE(engine.place_order(limit_order("alice", Side::BUY, 90 * PRICE_SCALE, 60)).success);
+    REQUIRE(engine.place_order(limit_order("alice", Side::BUY, 90 * PRICE_SCALE, 1)).error_code ==
+            ErrorCode::MAX_OPEN_ORDERS_EXCEEDED);
+}
+
+TEST_CASE("RiskChecker - Stops are checked again when they fire", "[risk]") {
+    RiskLimits limits;
+    limits.price_band_bps = 1000;  // 10%
+    MatchingEngine engine;
+    engine.set_risk_limits(limits);
+    REQUIRE(engine.place_order(limit_order("bob", Side::SELL, 100 * PRICE_SCALE, 10)).success);
+    REQUIRE(engine.place_order(limit_order("carol", Side::BUY, 100 * PRICE_SCALE, 10)).success);
+
+    // Inside the collar around 100 when parked
+    Order stop = limit_order("alice", Side::BUY, 95 * PRICE_SCALE, 10);
+    stop.type = OrderType::STOP_LIMIT;
+    stop.stop_price = 105 * PRICE_SCALE;
+    auto id = engine.place_order(stop).order.id;
+    REQUIRE(engine.risk_checker().exposure("alice", "BTC-USD").open_orders == 1);
+
+    // The trade that fires it moves the collar to [99, 121]
+    REQUIRE(engine.place_order(limit_order("bob", Side::SELL, 110 * PRICE_SCALE, 10)).success);
+    REQUIRE(engine.place_order(limit_order("carol", Side::BUY, 110 * PRICE_SCALE, 10)).success);
+    auto fired = engine.get_order(id);
+    REQUIRE(fired->type == OrderType::LIMIT);
+    REQUIRE(fired->status == OrderStatus::REJECTED);
+    REQUIRE(engine.risk_checker().exposure("alice", "BTC-USD").open_orders == 0);
+    REQUIRE_FALSE(engine.get_book("BTC-USD")->best_bid_price());
+    REQUIRE(engine.get_open_orders("alice").empty());
+}
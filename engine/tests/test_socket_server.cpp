@@ -0,0 +1,149 @@
+#include <catch2/catch_all.hpp>
+
+#ifdef __linux__
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <filesystem>
+#include <thread>
+
+#include "exchange/socket_server.hpp"
+
+using namespace exchange;
+
+namespace {
+
+int connect_to(const std::string& path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    REQUIRE(::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    return fd;
+}
+
+std::string read_line(int fd) {
+    std::string line;
+    char c;
+    while (::read(fd, &c, 1) == 1 && c != '\n') line += c;
+    return line;
+}
+
+void send_line(int fd, const std::string& s) {
+    std::string msg = s + "\n";
+    REQUIRE(::write(fd, msg.data(), msg.size()) == static_cast<ssize_t>(msg.size()));
+}
+
+std::string socket_path() {
+    return (std::filesystem::temp_directory_path() /
+            ("aztec_sock_" + std::to_string(now_ns()) + ".sock"))
+        .string();
+}
+
+}  // namespace
+
+TEST_CASE("SocketServer - Multiple clients share one engine", "[socket]") {
+    auto path = socket_path();
+
+    MatchingEngine engine;
+    ProtocolHandler handler(engine);
+    SocketServer server(handler, path);
+    REQUIRE(server.listen());
+    std::thread loop([&] { server.run(); });
+
+    int a = connect_to(path);
+    int b = connect_to(path);
+
+    send_line(a, R"({"cmd":"place_order","req_id":"a1","order":{"account_id":"A","symbol":"BTC-USD","side":"SELL","type":"LIMIT","price":100,"quantity":10}})");
+    auto ra = nlohmann::json::parse(read_line(a));
+    REQUIRE(ra["req_id"] == "a1");
+    REQUIRE(ra["success"] == true);
+
+    // Two requests in one write come back in order on the same connection
+    send_line(b, R"({"cmd":"place_order","req_id":"b1","order":{"account_id":"B","symbol":"BTC-USD","side":"BUY","type":"LIMIT","price":100,"quantity":4}})"
+                 "\n"
+                 R"({"cmd":"get_bbo","req_id":"b2","symbol":"BTC-USD"})");
+    auto rb1 = nlohmann::json::parse(read_line(b));
+    auto rb2 = nlohmann::json::parse(read_line(b));
+    REQUIRE(rb1["req_id"] == "b1");
+    REQUIRE(rb1["data"]["trades"].size() == 1);
+    REQUIRE(rb2["req_id"] == "b2");
+    REQUIRE(rb2["data"]["ask"]["quantity"] == 6);
+
+    send_line(a, R"({"cmd":"shutdown","req_id":"bye"})");
+    REQUIRE(nlohmann::json::parse(read_line(a))["req_id"] == "bye");
+    loop.join();
+
+    REQUIRE(server.stats().connections_accepted == 2);
+    REQUIRE(server.stats().requests == 4);
+    ::close(a);
+    ::close(b);
+}
+
+TEST_CASE("SocketServer - Responses outlive the client's half-close", "[socket]") {
+    auto path = socket_path();
+    MatchingEngine engine;
+    ProtocolHandler handler(engine);
+    SocketServer server(handler, path);
+    REQUIRE(server.listen());
+    std::thread loop([&] { server.run(); });
+
+    // Enough requests that the responses cannot all be sent in one write
+    int a = connect_to(path);
+    std::string batch;
+    for (int i = 0; i < 2000; ++i) {
+        batch += R"({"cmd":"get_bbo","req_id":"r)" + std::to_string(i) +
+                 R"(","symbol":"BTC-USD"})" "\n";
+    }
+    ssize_t written = 0;
+    std::thread writer([&] {
+        written = ::write(a, batch.data(), batch.size());
+        ::shutdown(a, SHUT_WR);
+    });
+    for (int i = 0; i < 2000; ++i) {
+        REQUIRE(nlohmann::json::parse(read_line(a))["req_id"] == "r" + std::to_string(i));
+    }
+    writer.join();
+    REQUIRE(written == static_cast<ssize_t>(batch.size()));
+    char c;
+    REQUIRE(::read(a, &c, 1) == 0);  // closed once everything was delivered
+    ::close(a);
+
+    int b = connect_to(path);
+    send_line(b, R"({"cmd":"shutdown","req_id":"bye"})");
+    REQUIRE(nlohmann::json::parse(read_line(b))["req_id"] == "bye");
+    loop.join();
+    ::close(b);
+}
+
+TEST_CASE("SocketServer - Overlong request lines drop the connection", "[socket]") {
+    auto path = socket_path();
+    MatchingEngine engine;
+    ProtocolHandler handler(engine);
+    SocketServer server(handler, path);
+    REQUIRE(server.listen());
+    std::thread loop([&] { server.run(); });
+
+    int a = connect_to(path);
+    std::string junk(2 << 20, 'x');
+    size_t sent = 0;
+    while (sent < junk.size()) {
+        ssize_t w = ::send(a, junk.data() + sent, junk.size() - sent, MSG_NOSIGNAL);
+        if (w <= 0) break;
+        sent += static_cast<size_t>(w);
+    }
+    char c;
+    REQUIRE(::read(a, &c, 1) <= 0);
+    ::close(a);
+
+    int b = connect_to(path);
+    send_line(b, R"({"cmd":"shutdown","req_id":"bye"})");
+    REQUIRE(nlohmann::json::parse(read_line(b))["req_id"] == "bye");
+    loop.join();
+    ::close(b);
+}
+
+#endif
@@ -0,0 +1,77 @@
+#include <catch2/catch_all.hpp>
+
+#include <algorithm>
+
+#include "exchange/timer_wheel.hpp"
+
+using namespace exchange;
+
+namespace {
+
+std::vector<uint64_t> advance(TimerWheel& wheel, uint64_t now_ns) {
+    std::vector<uint64_t> out;
+    wheel.advance(now_ns, out);
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+}  // namespace
+
+TEST_CASE("TimerWheel - Fires at the deadline, not before", "[timer_wheel]") {
+    TimerWheel wheel(1000);
+    wheel.schedule(1, 5500);
+    wheel.schedule(2, 7000);
+    REQUIRE(wheel.size() == 2);
+
+    // 5500 rounds up to tick 6
+    REQUIRE(advance(wheel, 5999).empty());
+    REQUIRE(advance(wheel, 6000) == std::vector<uint64_t>{1});
+    REQUIRE(advance(wheel, 6999).empty());
+    REQUIRE(advance(wheel, 7000) == std::vector<uint64_t>{2});
+    REQUIRE(wheel.empty());
+}
+
+TEST_CASE("TimerWheel - Cascades across levels", "[timer_wheel]") {
+    TimerWheel wheel(1);
+    // One timer per level boundary, plus a few in between
+    std::vector<uint64_t> deadlines = {1, 63, 64, 65, 4095, 4096, 4097, 262143, 262144,
+                                       1ULL << 30, (1ULL << 30) + 1, 1ULL << 40};
+    for (size_t i = 0; i < deadlines.size(); ++i) wheel.schedule(i, deadlines[i]);
+
+    // Step through each deadline and just before it
+    for (size_t i = 0; i < deadlines.size(); ++i) {
+        REQUIRE(advance(wheel, deadlines[i] - 1).empty());
+        REQUIRE(advance(wheel, deadlines[i]) == std::vector<uint64_t>{i});
+    }
+    REQUIRE(wheel.empty());
+}
+
+TEST_CASE("TimerWheel - One large jump fires everything due", "[timer_wheel]") {
+    TimerWheel wheel(1);
+    for (uint64_t i = 1; i <= 1000; ++i) wheel.schedule(i, i * 997);
+    wheel.schedule(5000, 2000000);
+
+    auto fired = advance(wheel, 997000);
+    REQUIRE(fired.size() == 1000);
+    REQUIRE(fired.front() == 1);
+    REQUIRE(fired.back() == 1000);
+    REQUIRE(wheel.size() == 1);
+
+    // Timers scheduled after a jump are filed relative to the new time
+    wheel.schedule(6000, 997001);
+    REQUIRE(advance(wheel, 997001) == std::vector<uint64_t>{6000});
+    REQUIRE(advance(wheel, 2000000) == std::vector<uint64_t>{5000});
+}
+
+TEST_CASE("TimerWheel - Past deadlines fire on the next advance", "[timer_wheel]") {
+    TimerWheel wheel(10);
+    REQUIRE(advance(wheel, 1000).empty());
+    wheel.schedule(7, 500);
+    wheel.schedule(8, 1000);
+    REQUIRE(advance(wheel, 1000) == std::vector<uint64_t>{7, 8});
+
+    wheel.schedule(9, 2000);
+    wheel.clear();
+    REQUIRE(wheel.empty());
+    REQUIRE(advance(wheel, 5000).empty());
+}
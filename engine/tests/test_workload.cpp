@@ -0,0 +1,122 @@
+#include <catch2/catch_all.hpp>
+
+#include <cmath>
+#include <filesystem>
+
+#include "exchange/matching_engine.hpp"
+#include "exchange/workload.hpp"
+
+using namespace exchange;
+
+namespace {
+
+bool same_op(const TraceOp& a, const TraceOp& b) {
+    return a.gap_ns == b.gap_ns && a.type == b.type && a.side == b.side &&
+           a.order_type == b.order_type && a.symbol == b.symbol && a.account == b.account &&
+           a.price == b.price && a.quantity == b.quantity && a.ref == b.ref;
+}
+
+}  // namespace
+
+TEST_CASE("Workload - Same seed gives the same trace", "[workload]") {
+    WorkloadConfig cfg;
+    cfg.seed = 7;
+    auto a = WorkloadGenerator(cfg).generate(5000);
+    auto b = WorkloadGenerator(cfg).generate(5000);
+    cfg.seed = 8;
+    auto c = WorkloadGenerator(cfg).generate(5000);
+
+    REQUIRE(a.ops.size() == 5000);
+    bool all_same = true;
+    bool any_diff = false;
+    for (size_t i = 0; i < a.ops.size(); ++i) {
+        all_same = all_same && same_op(a.ops[i], b.ops[i]);
+        any_diff = any_diff || !same_op(a.ops[i], c.ops[i]);
+    }
+    REQUIRE(all_same);
+    REQUIRE(any_diff);
+}
+
+TEST_CASE("Workload - Op mix follows the configured ratios", "[workload]") {
+    WorkloadConfig cfg;
+    cfg.cancel_ratio = 0.4;
+    cfg.replace_ratio = 0.1;
+    cfg.market_ratio = 0.05;
+    cfg.mid_move_probability = 0;  // fixed mid, so price distance = ticks from touch
+    auto trace = WorkloadGenerator(cfg).generate(20000);
+
+    size_t cancels = 0, replaces = 0, markets = 0, near_touch = 0, limits = 0;
+    for (size_t i = 0; i < trace.ops.size(); ++i) {
+        const auto& op = trace.ops[i];
+        if (op.type == TraceOpType::CANCEL) cancels++;
+        if (op.type == TraceOpType::REPLACE) replaces++;
+        if (op.type != TraceOpType::PLACE) REQUIRE(op.ref < i);
+        if (op.type == TraceOpType::PLACE && op.order_type == OrderType::MARKET) markets++;
+        if (op.order_type == OrderType::LIMIT && op.type != TraceOpType::CANCEL) {
+            limits++;
+            REQUIRE(op.price > 0);
+            auto ticks = std::abs(op.price - cfg.start_price) / cfg.tick;
+            if (ticks <= 5) near_touch++;
+        }
+        REQUIRE(op.symbol < cfg.symbols.size());
+        REQUIRE(op.account < cfg.accounts);
+    }
+
+    double n = static_cast<double>(trace.ops.size());
+    REQUIRE(std::abs(cancels / n - 0.4) < 0.02);
+    REQUIRE(std::abs(replaces / n - 0.1) < 0.02);
+    REQUIRE(markets > 0);
+    // Most resting interest clusters near the touch
+    REQUIRE(static_cast<double>(near_touch) / static_cast<double>(limits) > 0.8);
+}
+
+TEST_CASE("Workload - Trace file round trip", "[workload]") {
+    auto path = (std::filesystem::temp_directory_path() / "aztec_test_trace.bin").string();
+    auto trace = WorkloadGenerator(WorkloadConfig{}).generate(1000);
+    REQUIRE(write_trace(path, trace));
+    REQUIRE(std::filesystem::file_size(path) < 1000 * 40);
+
+    auto loaded = read_trace(path);
+    REQUIRE(loaded.has_value());
+    REQUIRE(loaded->symbols == trace.symbols);
+    REQUIRE(loaded->accounts == trace.accounts);
+    REQUIRE(loaded->ops.size() == trace.ops.size());
+    for (size_t i = 0; i < trace.ops.size(); ++i) {
+        REQUIRE(same_op(loaded->ops[i], trace.ops[i]));
+    }
+
+    // Truncated files are rejected rather than half-read
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 10);
+    REQUIRE_FALSE(read_trace(path).has_value());
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Workload - Replaying a trace is deterministic", "[workload]") {
+    auto trace = WorkloadGenerator(WorkloadConfig{}).generate(5000);
+
+    MatchingEngine a;
+    MatchingEngine b;
+    TraceRunner ra(a, trace);
+    TraceRunner rb(b, trace);
+    ra.run();
+    rb.run();
+
+    REQUIRE(ra.stats().placed > 0);
+    REQUIRE(ra.stats().cancelled > 0);
+    REQUIRE(ra.stats().replaced > 0);
+    REQUIRE(ra.stats().trades > 0);
+    REQUIRE(ra.stats().trades == rb.stats().trades);
+    REQUIRE(ra.stats().cancel_misses == rb.stats().cancel_misses);
+    REQUIRE(a.get_stats().total_trades == b.get_stats().total_trades);
+
+    for (const auto& symbol : trace.symbols) {
+        auto* ba = a.get_book(symbol);
+        auto* bb = b.get_book(symbol);
+        REQUIRE(ba != nullptr);
+        REQUIRE(bb != nullptr);
+        REQUIRE(ba->bbo() == bb->bbo());
+        REQUIRE(ba->bid_count() == bb->bid_count());
+        REQUIRE(ba->ask_count() == bb->ask_count());
+        REQUIRE_FALSE(ba->is_crossed());
+    }
+}
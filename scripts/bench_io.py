@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+"""Syscalls per order and latency of the epoll vs io_uring socket backends.
+
+Starts the engine with --listen and an event log, once per backend, and
+streams orders from a few pipelined clients. The engine prints an io_stats
+line on shutdown; syscalls per order is read from there. When the engine was
+built without liburing, --io-uring falls back to epoll and only the epoll row
+is reported. Linux only.
+"""
+
+import json
+import os
+import socket
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+from pathlib import Path
+
+NUM_CLIENTS = 4
+ORDERS_PER_CLIENT = 5000
+PIPELINE_DEPTH = 16
+
+
+def order_cmd(client_id: int, i: int) -> bytes:
+    cmd = {
+        "cmd": "place_order",
+        "req_id": f"{client_id}-{i}",
+        "order": {
+            "account_id": f"c{client_id}-t{i % 10}",
+            "symbol": "BTC-USD",
+            "side": "SELL" if (i + client_id) % 2 == 0 else "BUY",
+            "type": "LIMIT",
+            "price": (10000 + (i % 50)) * 100000000,
+            "quantity": 100,
+        },
+    }
+    return json.dumps(cmd).encode() + b"\n"
+
+
+def client(path: str, client_id: int, latencies: list[float]) -> None:
+    sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    sock.connect(path)
+    reader = sock.makefile("rb")
+    cmds = [order_cmd(client_id, i) for i in range(ORDERS_PER_CLIENT)]
+
+    # Keep PIPELINE_DEPTH requests outstanding so the server has batches to work with
+    sent_at = []
+    next_send = 0
+    for done in range(len(cmds)):
+        while next_send < len(cmds) and next_send - done < PIPELINE_DEPTH:
+            sent_at.append(time.perf_counter_ns())
+            sock.sendall(cmds[next_send])
+            next_send += 1
+        reader.readline()
+        latencies.append((time.perf_counter_ns() - sent_at[done]) / 1000)
+    sock.close()
+
+
+def run_backend(engine_path: str, use_io_uring: bool) -> dict:
+    tmp = tempfile.mkdtemp(prefix="aztec-io-")
+    path = os.path.join(tmp, "engine.sock")
+    args = [engine_path, "--listen", path, "--event-log", os.path.join(tmp, "events.jsonl")]
+    if use_io_uring:
+        args.append("--io-uring")
+    proc = subprocess.Popen(args, stderr=subprocess.PIPE, text=True)
+
+    deadline = time.monotonic() + 5
+    while not os.path.exists(path):
+        if time.monotonic() > deadline:
+            proc.kill()
+            raise RuntimeError("Engine did not start listening")
+        time.sleep(0.01)
+
+    per_client: list[list[float]] = [[] for _ in range(NUM_CLIENTS)]
+    threads = [
+        threading.Thread(target=client, args=(path, c, per_client[c])) for c in range(NUM_CLIENTS)
+    ]
+    t0 = time.perf_counter()
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    elapsed = time.perf_counter() - t0
+
+    with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as s:
+        s.connect(path)
+        s.sendall(b'{"cmd": "shutdown"}\n')
+        s.recv(4096)
+    _, stderr = proc.communicate(timeout=10)
+
+    io_stats = {}
+    for line in stderr.splitlines():
+        if "io_stats" in line:
+            io_stats = json.loads(line.split("io_stats", 1)[1])
+
+    latencies = sorted(x for lat in per_client for x in lat)
+    total = len(latencies)
+    return {
+        "backend": io_stats.get("backend", "unknown"),
+        "orders": total,
+        "throughput_ops": total / elapsed,
+        "syscalls_per_order": io_stats.get("syscalls", 0) / max(1, io_stats.get("requests", 1)),
+        "p50_us": latencies[int(total * 0.5)],
+        "p99_us": latencies[int(total * 0.99)],
+    }
+
+
+def main():
+    project_dir = Path(__file__).parent.parent
+    engine_path = project_dir / "build" / "engine" / "exchange_engine"
+    if len(sys.argv) > 1:
+        engine_path = Path(sys.argv[1])
+
+    if not engine_path.exists():
+        print(f"Engine not found at {engine_path}. Run 'make build' first.")
+        sys.exit(1)
+
+    results = [run_backend(str(engine_path), False)]
+    uring = run_backend(str(engine_path), True)
+    if uring["backend"] == "io_uring":
+        results.append(uring)
+    else:
+        print("Engine built without liburing; io_uring row skipped")
+
+    print("\n=== Socket I/O Backends (with event log) ===")
+    print(f"{'backend':<10}{'orders':>8}{'ops/sec':>10}{'sys/order':>11}{'p50 µs':>10}{'p99 µs':>10}")
+    for r in results:
+        print(
+            f"{r['backend']:<10}{r['orders']:>8}{r['throughput_ops']:>10.0f}"
+            f"{r['syscalls_per_order']:>11.2f}{r['p50_us']:>10.1f}{r['p99_us']:>10.1f}"
+        )
+    print(json.dumps(results))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+"""Round-trip latency of the pipe transport vs the shared-memory transport.
+
+Starts the engine once per transport and times request -> response for the
+same command mix. Linux only (the shared-memory transport needs /dev/shm).
+"""
+
+import json
+import os
+import subprocess
+import sys
+import time
+from pathlib import Path
+from statistics import mean
+
+sys.path.insert(0, str(Path(__file__).parent.parent / "api"))
+
+from app.shm_transport import ShmChannel  # noqa: E402
+
+
+def make_commands(num_orders: int) -> list[bytes]:
+    cmds = []
+    for i in range(num_orders):
+        if i % 4 == 3:
+            cmd = {"cmd": "get_bbo", "req_id": f"b-{i}", "symbol": "BTC-USD"}
+        else:
+            cmd = {
+                "cmd": "place_order",
+                "req_id": f"o-{i}",
+                "order": {
+                    "account_id": f"trader{i % 10}",
+                    "symbol": "BTC-USD",
+                    "side": "SELL" if i % 2 == 0 else "BUY",
+                    "type": "LIMIT",
+                    "price": (10000 + (i % 100)) * 100000000,
+                    "quantity": 100,
+                },
+            }
+        cmds.append(json.dumps(cmd).encode())
+    return cmds
+
+
+def summarize(latencies_us: list[float]) -> dict:
+    s = sorted(latencies_us)
+    n = len(s)
+    return {
+        "mean_us": mean(s),
+        "p50_us": s[int(n * 0.5)],
+        "p99_us": s[int(n * 0.99)],
+        "p999_us": s[min(n - 1, int(n * 0.999))],
+        "max_us": s[-1],
+    }
+
+
+def bench_pipe(engine_path: str, cmds: list[bytes], warmup: int) -> dict:
+    proc = subprocess.Popen(
+        [engine_path],
+        stdin=subprocess.PIPE,
+        stdout=subprocess.PIPE,
+        stderr=subprocess.DEVNULL,
+        bufsize=0,
+    )
+    latencies = []
+    for i, cmd in enumerate(cmds):
+        start = time.perf_counter_ns()
+        proc.stdin.write(cmd + b"\n")
+        proc.stdout.readline()
+        end = time.perf_counter_ns()
+        if i >= warmup:
+            latencies.append((end - start) / 1000)
+
+    proc.stdin.write(b'{"cmd": "shutdown"}\n')
+    proc.stdout.readline()
+    proc.wait(timeout=5)
+    return summarize(latencies)
+
+
+def bench_shm(engine_path: str, cmds: list[bytes], warmup: int) -> dict:
+    name = f"aztec-bench-{os.getpid()}"
+    proc = subprocess.Popen([engine_path, "--shm", name], stderr=subprocess.DEVNULL)
+    channel = ShmChannel(name)
+    channel.connect()
+
+    latencies = []
+    for i, cmd in enumerate(cmds):
+        start = time.perf_counter_ns()
+        channel.request(cmd)
+        end = time.perf_counter_ns()
+        if i >= warmup:
+            latencies.append((end - start) / 1000)
+
+    channel.request(b'{"cmd": "shutdown"}')
+    channel.close()
+    proc.wait(timeout=5)
+    return summarize(latencies)
+
+
+def main():
+    project_dir = Path(__file__).parent.parent
+    engine_path = project_dir / "build" / "engine" / "exchange_engine"
+    if len(sys.argv) > 1:
+        engine_path = Path(sys.argv[1])
+
+    if not engine_path.exists():
+        print(f"Engine not found at {engine_path}. Run 'make build' first.")
+        sys.exit(1)
+
+    warmup = 1000
+    cmds = make_commands(warmup + 20000)
+
+    results = {
+        "pipe": bench_pipe(str(engine_path), cmds, warmup),
+        "shm": bench_shm(str(engine_path), cmds, warmup),
+    }
+
+    print("\n=== IPC Round-Trip Latency (µs) ===")
+    print(f"{'transport':<10}{'mean':>10}{'p50':>10}{'p99':>10}{'p99.9':>10}{'max':>10}")
+    for name, r in results.items():
+        print(
+            f"{name:<10}{r['mean_us']:>10.2f}{r['p50_us']:>10.2f}"
+            f"{r['p99_us']:>10.2f}{r['p999_us']:>10.2f}{r['max_us']:>10.2f}"
+        )
+    print(json.dumps(results))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+"""Aggregate throughput of the engine's UNIX socket server (--listen).
+
+Runs 1, 4 and 16 concurrent client processes against one engine. Each client
+sends its own stream of orders request-by-request; the engine multiplexes all
+connections into its single matching thread. Linux only.
+"""
+
+import json
+import multiprocessing as mp
+import os
+import socket
+import subprocess
+import sys
+import tempfile
+import time
+from pathlib import Path
+
+
+def client_worker(path: str, client_id: int, num_orders: int, start_evt, out_q) -> None:
+    sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    sock.connect(path)
+    reader = sock.makefile("rb")
+
+    cmds = []
+    for i in range(num_orders):
+        cmds.append(
+            json.dumps(
+                {
+                    "cmd": "place_order",
+                    "req_id": f"{client_id}-{i}",
+                    "order": {
+                        "account_id": f"c{client_id}-t{i % 10}",
+                        "symbol": "BTC-USD",
+                        "side": "SELL" if (i + client_id) % 2 == 0 else "BUY",
+                        "type": "LIMIT",
+                        "price": (10000 + (i % 50)) * 100000000,
+                        "quantity": 100,
+                    },
+                }
+            ).encode()
+            + b"\n"
+        )
+
+    latencies = []
+    start_evt.wait()
+    for cmd in cmds:
+        t0 = time.perf_counter_ns()
+        sock.sendall(cmd)
+        reader.readline()
+        latencies.append((time.perf_counter_ns() - t0) / 1000)
+
+    sock.close()
+    out_q.put(latencies)
+
+
+def run_round(engine_path: str, num_clients: int, orders_per_client: int) -> dict:
+    path = os.path.join(tempfile.gettempdir(), f"aztec-bench-{os.getpid()}.sock")
+    proc = subprocess.Popen([engine_path, "--listen", path], stderr=subprocess.DEVNULL)
+    deadline = time.monotonic() + 5
+    while not os.path.exists(path):
+        if time.monotonic() > deadline:
+            proc.kill()
+            raise RuntimeError("Engine did not start listening")
+        time.sleep(0.01)
+
+    start_evt = mp.Event()
+    out_q = mp.Queue()
+    workers = [
+        mp.Process(target=client_worker, args=(path, c, orders_per_client, start_evt, out_q))
+        for c in range(num_clients)
+    ]
+    for w in workers:
+        w.start()
+    time.sleep(0.2)  # let every client connect and build its commands
+
+    t0 = time.perf_counter()
+    start_evt.set()
+    latencies = []
+    for _ in workers:
+        latencies.extend(out_q.get())
+    elapsed = time.perf_counter() - t0
+    for w in workers:
+        w.join()
+
+    with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as s:
+        s.connect(path)
+        s.sendall(b'{"cmd": "shutdown"}\n')
+        s.recv(4096)
+    proc.wait(timeout=5)
+
+    latencies.sort()
+    total = len(latencies)
+    return {
+        "clients": num_clients,
+        "orders": total,
+        "throughput_ops": total / elapsed,
+        "p50_us": latencies[int(total * 0.5)],
+        "p99_us": latencies[int(total * 0.99)],
+    }
+
+
+def main():
+    project_dir = Path(__file__).parent.parent
+    engine_path = project_dir / "build" / "engine" / "exchange_engine"
+    if len(sys.argv) > 1:
+        engine_path = Path(sys.argv[1])
+
+    if not engine_path.exists():
+        print(f"Engine not found at {engine_path}. Run 'make build' first.")
+        sys.exit(1)
+
+    total_orders = 32000
+    results = [run_round(str(engine_path), n, total_orders // n) for n in (1, 4, 16)]
+
+    print("\n=== UNIX Socket Server Throughput ===")
+    print(f"{'clients':>8}{'orders':>10}{'ops/sec':>12}{'p50 µs':>10}{'p99 µs':>10}")
+    for r in results:
+        print(
+            f"{r['clients']:>8}{r['orders']:>10}{r['throughput_ops']:>12.0f}"
+            f"{r['p50_us']:>10.1f}{r['p99_us']:>10.1f}"
+        )
+    print(json.dumps(results))
+
+
+if __name__ == "__main__":
+    main()